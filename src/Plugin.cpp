@@ -1,11 +1,18 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <optional>
 #include <mutex>
+#include <thread>
 #include <unordered_set>
+#include <vector>
+#include <d3d12.h>
 #include <spdlog/spdlog.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_sinks.h>
 
-#include <ppl.h>
-
 #include <utility/Scan.hpp>
 #include <utility/Module.hpp>
 #include <utility/Patch.hpp>
@@ -13,44 +20,36 @@
 
 #include "uevr/Plugin.hpp"
 
+#include "analysis/CopyDescriptorsFilter.hpp"
+#include "analysis/DescriptorCoalesce.hpp"
+#include "analysis/DescriptorHeapIndex.hpp"
+#include "analysis/EventLog.hpp"
+#include "analysis/GameResolver.hpp"
+#include "analysis/GhostingFix.hpp"
+#include "analysis/HintScan.hpp"
+#include "analysis/HookGate.hpp"
+#include "analysis/HookTrace.hpp"
+#include "analysis/JumpStub.hpp"
+#include "analysis/NullHandleScan.hpp"
+#include "analysis/ParallelScan.hpp"
+#include "analysis/ScanCache.hpp"
+#include "analysis/ScanRegion.hpp"
+#include "analysis/SharedScanState.hpp"
+#include "analysis/SimdScan.hpp"
+#include "analysis/TaskGraph.hpp"
+#include "analysis/WorkPool.hpp"
+
 using namespace uevr;
 
 class FF7Plugin;
 extern std::unique_ptr<FF7Plugin> g_plugin;
 
-class SimpleScheduler {
-public:
-    SimpleScheduler() {
-        m_evt = CreateEvent(NULL, FALSE, FALSE, NULL);
-
-        Concurrency::SchedulerPolicy policy(1, Concurrency::ContextPriority, THREAD_PRIORITY_HIGHEST);
-        m_impl = Concurrency::Scheduler::Create(policy);
-        m_impl->RegisterShutdownEvent(m_evt);
-        m_impl->Attach();
-    }
-
-    virtual ~SimpleScheduler() {
-        if (m_impl != nullptr) {
-            Concurrency::CurrentScheduler::Detach();
-            m_impl->Release();
-
-            SPDLOG_INFO("Waiting for the scheduler to shut down...");
-            if (WaitForSingleObject(m_evt, 1000) == WAIT_OBJECT_0) {
-                SPDLOG_INFO("Scheduler has shut down.");
-                CloseHandle(m_evt);
-            } else {
-                SPDLOG_ERROR("Failed to wait for the scheduler to shut down.");
-            }
-        }
-    }
-private:
-    Concurrency::Scheduler* m_impl{nullptr};
-    HANDLE m_evt{nullptr};
-};
-
 class FF7Plugin final : public uevr::Plugin {
 public:
+    // Runs from DLL_PROCESS_DETACH, under the loader lock, so it can't wait for any thread to exit.
+    // The init worker keeps the DLL loaded until it's done, so by the time this runs it's either finished or was terminated with the process.
     virtual ~FF7Plugin() {
+        stop_drain_timer();
         m_motion_blur_patch.reset();
 
         if (m_hook_id >= 0) {
@@ -73,42 +72,83 @@ public:
             API::get()->param()->functions->unregister_inline_hook(m_update_transform_hook_id);
         }
 
+        if (m_create_descriptor_heap_hook_id >= 0) {
+            API::get()->param()->functions->unregister_inline_hook(m_create_descriptor_heap_hook_id);
+        }
+
+        if (m_descriptor_heap_release_hook_id >= 0) {
+            API::get()->param()->functions->unregister_inline_hook(m_descriptor_heap_release_hook_id);
+        }
+
         if (m_copy_descriptors_hook_id >= 0) {
             API::get()->param()->functions->unregister_inline_hook(m_copy_descriptors_hook_id);
+            s_copy_descriptors_original.store(nullptr, std::memory_order_relaxed);
         }
+
+        s_trace.store(nullptr, std::memory_order_release);
     }
 
     void on_initialize() override {
-        // We manually create a scheduler because doing so with the default WinRT scheduler (which is implicitly created if no scheduler is attached)
-        // causes our DLL to fail to unload properly, which is bad for development for hot-reloading
-        // The scan functions have concurrency calls within them which is why we need to do this
-        SimpleScheduler current_thread_scheduler{};
-
-        AllocConsole();
-        freopen("CONOUT$", "w", stdout);
+        // Everything goes to a rotating file in the persistent dir, the console is opt-in (FF7PLUGIN_CONSOLE=1).
+        std::vector<spdlog::sink_ptr> sinks{};
+        sinks.push_back(std::make_shared<spdlog::sinks::rotating_file_sink_mt>(API::get()->get_persistent_dir(L"ff7rebirth_plugin.log").string(), 5 * 1024 * 1024, 3));
+
+        if (is_env_enabled("FF7PLUGIN_CONSOLE")) {
+            AllocConsole();
+            freopen("CONOUT$", "w", stdout);
+            sinks.push_back(std::make_shared<spdlog::sinks::stdout_sink_mt>());
+        }
 
-        // Set up spdlog to sink to the console
+        spdlog::set_default_logger(std::make_shared<spdlog::logger>("ff7plugin", sinks.begin(), sinks.end()));
         spdlog::set_pattern("[%H:%M:%S] [%^%l%$] [ff7plugin] %v");
         spdlog::set_level(spdlog::level::info);
-        spdlog::flush_on(spdlog::level::info);
-        spdlog::set_default_logger(spdlog::stdout_logger_mt("console"));
+
+        // Only problems get written out right away, m_event_log flushes the rest once a second (see on_drain_timer)
+        spdlog::flush_on(spdlog::level::warn);
+        m_event_log = std::make_unique<analysis::EventLog>(spdlog::default_logger());
 
         SPDLOG_INFO("FF7Plugin entry point");
 
-        const auto framenum_ref = utility::scan(utility::get_executable(), "FF 05 ? ? ? ? 48 8D 0D ? ? ? ? 48 89 9C 24 88 00 00 00");
+        if (s_coalesce_descriptors = is_env_enabled("FF7PLUGIN_COALESCE_DESCRIPTORS"); s_coalesce_descriptors) {
+            SPDLOG_INFO("Coalescing adjacent CopyDescriptors ranges");
+        }
+
+        // Capture mode for trace_replay, overwrites the previous session's trace
+        if (is_env_enabled("FF7PLUGIN_TRACE")) {
+            const auto trace_path = API::get()->get_persistent_dir(L"ff7rebirth_hooks.trace");
+            m_trace = std::make_unique<analysis::TraceRecorder>(trace_path);
+
+            if (m_trace->is_open()) {
+                s_trace.store(m_trace.get(), std::memory_order_release);
+                SPDLOG_INFO("Recording hook trace to {}", trace_path.string());
+            } else {
+                SPDLOG_ERROR("Failed to open {} for the hook trace", trace_path.string());
+                m_trace.reset();
+            }
+        }
+
+        start_drain_timer();
+
+        SPDLOG_INFO("Using {} scan kernel", analysis::simd::to_string(analysis::simd::get_isa()));
 
-        if (framenum_ref) {
-            SPDLOG_INFO("Found GFrameNumberRenderThread at 0x{:x}", *framenum_ref);
-            GFrameNumberRenderThread = (uint32_t*)utility::calculate_absolute(*framenum_ref + 2);
+        // Scanning takes a while on a cold cache, UEVR (and the game) shouldn't have to wait for it.
+        // Every hook is gated, so until it goes live it just passes through to the original.
+        // The worker holds a reference to this DLL of its own, a FreeLibrary (hot reload) can't unmap it halfway through.
+        HMODULE module{};
+
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)&initialize_hooks_thread, &module)) {
+            SPDLOG_ERROR("[Hooks] Failed to pin the plugin DLL ({}), initializing synchronously", GetLastError());
+            initialize_hooks();
+            return;
         }
 
-        hook_render_composite_layer();
-        hook_post_process_settings();
-        patch_motion_blur();
-        hook_startframe();
-        hook_update_transform();
-        hook_create_scene_renderer();
-        hook_copy_descriptors();
+        if (const auto thread = CreateThread(nullptr, 0, &initialize_hooks_thread, module, 0, nullptr); thread != nullptr) {
+            CloseHandle(thread);
+        } else {
+            SPDLOG_ERROR("[Hooks] Failed to start the init worker ({}), initializing synchronously", GetLastError());
+            FreeLibrary(module);
+            initialize_hooks();
+        }
     }
 
     void on_pre_engine_tick(API::UGameEngine* engine, float delta) override {
@@ -125,12 +165,285 @@ public:
         m_is_hmd_active = API::VR::is_hmd_active();
     }
 
+    void on_post_engine_tick(API::UGameEngine* engine, float delta) override {
+        if (m_descriptor_heap_tracking_pending.load(std::memory_order_acquire)) [[unlikely]] {
+            start_descriptor_heap_tracking();
+        }
+    }
+
 private:
+    static bool is_env_enabled(const char* name) {
+        char value[8]{};
+        return GetEnvironmentVariableA(name, value, sizeof(value)) > 0 && value[0] != '0';
+    }
+
+    // Nothing waits for this thread. It drops its reference to the DLL on the way out, only then can the DLL actually get unloaded.
+    static DWORD WINAPI initialize_hooks_thread(LPVOID module) {
+        g_plugin->initialize_hooks();
+        FreeLibraryAndExitThread((HMODULE)module, 0);
+    }
+
+    // For anything logged from the game's render or driver threads. Destroyed after every hook is gone, writing out what's left.
+    std::unique_ptr<analysis::EventLog> m_event_log{};
+
+    // Drains m_event_log and writes out m_trace on a thread pool thread, so the file writes stay off the game's threads.
+    // A thread of our own couldn't be stopped: the destructor runs under the loader lock, and a thread needs it to exit.
+    // A pool callback doesn't, and SetThreadpoolCallbackLibrary keeps the DLL loaded while one runs, so the destructor
+    // can cancel the timer and wait out a callback in flight before anything it touches goes away.
+    static constexpr std::chrono::milliseconds DRAIN_INTERVAL{10};
+    TP_CALLBACK_ENVIRON m_drain_environment{};
+    PTP_TIMER m_drain_timer{};
+
+    static VOID CALLBACK on_drain_timer(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+        const auto plugin = (FF7Plugin*)context;
+
+        if (plugin->m_event_log != nullptr) {
+            plugin->m_event_log->poll();
+        }
+
+        if (plugin->m_trace != nullptr) {
+            plugin->m_trace->poll();
+        }
+    }
+
+    void start_drain_timer() {
+        HMODULE module{};
+
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCWSTR)&on_drain_timer, &module)) {
+            SPDLOG_ERROR("[Drain] Failed to get the plugin module ({}), events and the hook trace only get written at unload", GetLastError());
+            return;
+        }
+
+        InitializeThreadpoolEnvironment(&m_drain_environment);
+        SetThreadpoolCallbackLibrary(&m_drain_environment, module);
+
+        if (m_drain_timer = CreateThreadpoolTimer(&on_drain_timer, this, &m_drain_environment); m_drain_timer == nullptr) {
+            SPDLOG_ERROR("[Drain] Failed to create the drain timer ({}), events and the hook trace only get written at unload", GetLastError());
+            DestroyThreadpoolEnvironment(&m_drain_environment);
+            return;
+        }
+
+        // Relative due times are negative, in 100ns units
+        ULARGE_INTEGER due{};
+        due.QuadPart = (ULONGLONG)(-(LONGLONG)DRAIN_INTERVAL.count() * 10'000);
+
+        FILETIME due_time{due.LowPart, due.HighPart};
+        SetThreadpoolTimer(m_drain_timer, &due_time, (DWORD)DRAIN_INTERVAL.count(), 0);
+    }
+
+    // Before any hook goes away. Every other thread is already gone when the process is exiting, including one that
+    // may have been in the middle of a callback, so there's nothing to wait for then (and the wait would never end).
+    void stop_drain_timer() {
+        if (m_drain_timer == nullptr) {
+            return;
+        }
+
+        SetThreadpoolTimer(m_drain_timer, nullptr, 0, 0);
+
+        if (is_process_exiting()) {
+            return;
+        }
+
+        WaitForThreadpoolTimerCallbacks(m_drain_timer, TRUE);
+        CloseThreadpoolTimer(m_drain_timer);
+        DestroyThreadpoolEnvironment(&m_drain_environment);
+        m_drain_timer = nullptr;
+    }
+
+    static bool is_process_exiting() {
+        using RtlDllShutdownInProgressFn = BOOLEAN (NTAPI*)();
+        static const auto shutdown_in_progress = (RtlDllShutdownInProgressFn)GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "RtlDllShutdownInProgress");
+
+        return shutdown_in_progress != nullptr && shutdown_in_progress();
+    }
+
+    // Only with FF7PLUGIN_TRACE=1. The hooks go through s_trace, which is null whenever this is. Set before the drain timer starts.
+    std::unique_ptr<analysis::TraceRecorder> m_trace{};
+    static inline std::atomic<analysis::TraceRecorder*> s_trace{nullptr};
+
+    // Runs on initialize_hooks_thread.
+    void initialize_hooks() {
+        // Module-wide scans get split into chunks across every core. Only lives as long as the scanning does,
+        // nothing of it is left by the time the DLL could get unloaded for a hot reload.
+        analysis::WorkPool pool{};
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto scan_cache_path = API::get()->get_persistent_dir(L"ff7rebirth_scan_cache.bin");
+        m_scan_cache.load(scan_cache_path);
+
+        // After a hot reload, whatever the previous instance in this process resolved is still in shared memory.
+        // Everything in there is still valid unless the game itself got swapped out, which attach checks for.
+        const auto game = (uintptr_t)utility::get_executable();
+        m_shared_state = analysis::SharedScanState::attach(game);
+
+        if (m_shared_state != nullptr) {
+            if (const auto modules = m_shared_state->get("ScanCache"); !modules || !m_scan_cache.merge_modules(*modules)) {
+                SPDLOG_WARN("[SharedScanState] No usable scan results in generation {}", m_shared_state->get_generation());
+            }
+        }
+
+        m_game = std::make_unique<analysis::GameResolver>(game, &m_scan_cache, m_shared_state.get(), &pool);
+
+        // The scans are independent of each other (aside from the explicit dependencies), so resolve them all at once
+        // and only install the hooks afterwards, in order.
+
+        analysis::TaskGraph graph{};
+        graph.add("GFrameNumberRenderThread", {}, [this]() { return resolve_frame_number(); });
+        graph.add("FEndMenuRenderer::OnRenderCompositeLayerEx", {}, [this]() { return resolve_render_composite_layer(); }, [this]() { hook_render_composite_layer(); });
+        graph.add("FPostProcessSettings::FPostProcessSettings", {}, [this]() { return resolve_post_process_settings(); }, [this]() { hook_post_process_settings(); });
+        graph.add("MotionBlurIntermediate", {}, [this]() { return resolve_motion_blur(); }, [this]() { patch_motion_blur(); });
+        graph.add("FScene::StartFrame", {"GFrameNumberRenderThread"}, [this]() { return resolve_startframe(); }, [this]() { hook_startframe(); });
+        graph.add("FVelocityData::UpdateTransform", {"GFrameNumberRenderThread"}, [this]() { return resolve_update_transform(); }, [this]() { hook_update_transform(); });
+        graph.add("FScene::UpdateAllPrimitiveSceneInfos", {"FVelocityData::UpdateTransform"}, [this]() { return resolve_update_all_primitive_scene_infos(); }, [this]() { hook_update_all_primitive_scene_infos(); });
+        graph.add("CDevice::CopyDescriptors", {}, [this]() { return resolve_copy_descriptors(); }, [this]() { hook_copy_descriptors(); });
+
+        graph.resolve(&pool);
+        graph.install();
+        graph.report();
+
+        // Needs the D3D12 device, which usually isn't up yet this early. on_post_engine_tick takes it from here.
+        m_descriptor_heap_tracking_pending.store(true, std::memory_order_release);
+
+        for (const auto& hint : m_game->get_hint_results()) {
+            SPDLOG_INFO("[Hints] {}: 0x{:x} -> 0x{:x}, {}", hint.name, hint.hint, hint.rva, analysis::to_string(hint.window));
+        }
+
+        const auto disasm = m_game->get_instructions().get_stats();
+        SPDLOG_INFO("[Disassembly] {} instruction(s) decoded in {:.3f}ms, {} served from cache (~{:.3f}ms saved)",
+            disasm.decoded,
+            std::chrono::duration<double, std::milli>(disasm.decode_time).count(),
+            disasm.served,
+            std::chrono::duration<double, std::milli>(disasm.get_time_saved()).count());
+
+        hook_create_scene_renderer();
+
+        SPDLOG_INFO("[ScanCache] {} hit(s), {} miss(es)", m_scan_cache.get_hits(), m_scan_cache.get_misses());
+
+        // Every miss got rescanned, which the next instance shouldn't have to do again
+        if (m_shared_state == nullptr || m_scan_cache.get_misses() > 0) {
+            auto blobs = m_game->serialize_indexes();
+            blobs.push_back({"ScanCache", m_scan_cache.serialize_modules()});
+
+            analysis::SharedScanState::publish(game, blobs);
+        }
+
+        if (m_scan_cache.is_dirty()) {
+            m_scan_cache.save(scan_cache_path);
+        }
+
+        // The indexes are only needed to resolve, and the resolver would be left pointing at the pool otherwise
+        m_game.reset();
+
+        const auto pool_shutdown = std::chrono::duration<double, std::milli>(pool.shutdown()).count();
+
+        // Same budget the ConcRT scheduler used to get for shutting down
+        if (pool_shutdown > 1000.0) {
+            SPDLOG_ERROR("[WorkPool] {} thread(s) took {:.3f}ms to shut down", pool.get_thread_count(), pool_shutdown);
+        } else {
+            SPDLOG_INFO("[WorkPool] {} thread(s) shut down in {:.3f}ms", pool.get_thread_count(), pool_shutdown);
+        }
+
+        SPDLOG_INFO("[Hooks] Background initialization finished in {:.3f}ms, {:.3f}ms after process start",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+            std::chrono::duration<double, std::milli>(analysis::get_process_uptime()).count());
+    }
+
+    // The gate only goes live once register_inline_hook has stored the trampoline, everything the detour
+    // reads has been resolved by then as all installs happen after resolution.
+    template <typename Fn>
+    int install_hook(std::string_view name, uintptr_t target, Fn detour, analysis::HookGate<Fn>& gate) {
+        gate.set_state(analysis::HookState::INSTALLING);
+
+        const auto id = API::get()->param()->functions->register_inline_hook((void*)target, (void*)detour, gate.get_original_slot());
+
+        if (id < 0) {
+            gate.set_state(analysis::HookState::FAILED);
+            SPDLOG_ERROR("[Hooks] Failed to hook {} at 0x{:x}", name, target);
+            return id;
+        }
+
+        gate.set_state(analysis::HookState::LIVE);
+        SPDLOG_INFO("[Hooks] {} live {:.3f}ms after process start", name, std::chrono::duration<double, std::milli>(gate.get_live_time()).count());
+
+        return id;
+    }
+
+    analysis::ScanCache m_scan_cache{};
+
+    // Returns the cached address for name if it's still valid, otherwise runs scan and caches the result.
+    template <typename T>
+    std::optional<uintptr_t> resolve_cached(HMODULE module, std::string_view name, T&& scan) {
+        if (const auto cached = m_scan_cache.get_address((uintptr_t)module, name)) {
+            SPDLOG_INFO("[ScanCache] {} at 0x{:x} (cached)", name, *cached);
+            return cached;
+        }
+
+        const auto result = scan();
+
+        if (result) {
+            m_scan_cache.set_address((uintptr_t)module, name, *result);
+        }
+
+        return result;
+    }
+
+    // resolve_cached for functions in the game executable. Every resolved function gets fingerprinted,
+    // and when the scan comes up empty after an update, the fingerprint from the previous build gets matched instead.
+    template <typename T>
+    std::optional<uintptr_t> resolve_function(HMODULE module, std::string_view name, T&& scan) {
+        auto result = resolve_cached(module, name, std::forward<T>(scan));
+
+        if (!result) {
+            result = m_game->find_function_by_fingerprint(name);
+
+            if (result) {
+                m_scan_cache.set_address((uintptr_t)module, name, *result);
+            }
+        }
+
+        if (result) {
+            m_game->remember_function(name, *result);
+        }
+
+        return result;
+    }
+
+    // Published by the previous instance in this process, if any. Has to outlive m_game, which reads indexes from it.
+    std::unique_ptr<analysis::SharedScanState> m_shared_state{};
+
+    // Owns the indexes every game scan goes through, only alive during initialize_hooks.
+    std::unique_ptr<analysis::GameResolver> m_game{};
+
     uint32_t* GFrameNumberRenderThread{nullptr};
+
+    bool resolve_frame_number() {
+        const auto framenum_ref = resolve_cached(utility::get_executable(), "GFrameNumberRenderThread", [this]() {
+            return m_game->find_frame_number_increment();
+        });
+
+        if (!framenum_ref) {
+            SPDLOG_ERROR("Failed to find GFrameNumberRenderThread");
+            return false;
+        }
+
+        SPDLOG_INFO("Found GFrameNumberRenderThread at 0x{:x}", *framenum_ref);
+        GFrameNumberRenderThread = (uint32_t*)utility::calculate_absolute(*framenum_ref + 2);
+
+        return true;
+    }
+
     bool m_ghosting_fix_enabled{false};
     bool m_using_native_stereo{false};
     bool m_is_hmd_active{false};
 
+    analysis::GhostingFixState get_ghosting_fix_state() const {
+        return {m_is_hmd_active, m_using_native_stereo, m_ghosting_fix_enabled};
+    }
+
+    analysis::TraceFrame get_trace_frame() const {
+        return {GFrameNumberRenderThread != nullptr ? *GFrameNumberRenderThread : 0, get_ghosting_fix_state()};
+    }
+
     struct FEndMenuRenderer {
         uint8_t& counter() {
             return *(uint8_t*)((uintptr_t)this + 0x69);
@@ -156,7 +469,7 @@ private:
     };
 
     using OnRenderCompositeLayerFn = void* (*)(FEndMenuRenderer* self, FEndMenuRenderContext* context);
-    OnRenderCompositeLayerFn m_orig_render_composite_layer{nullptr};
+    analysis::HookGate<OnRenderCompositeLayerFn> m_render_composite_layer_gate{};
     int m_hook_id{-1};
     FEndMenuRenderer* m_last_menu_renderer{nullptr};
     API::FRHITexture2D* m_last_stereo_texture{nullptr};
@@ -196,6 +509,12 @@ private:
     }
 
     static void* on_render_composite_layer(FEndMenuRenderer* self, FEndMenuRenderContext* context) {
+        const auto& gate = g_plugin->m_render_composite_layer_gate;
+
+        if (!gate.is_live()) {
+            return gate.call_original(self, context);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -203,98 +522,76 @@ private:
             once = false;
         }
 
-        auto res = g_plugin->on_render_composite_layer_internal(self, context, g_plugin->m_orig_render_composite_layer);
+        auto res = g_plugin->on_render_composite_layer_internal(self, context, gate.get_original());
 
         return res;
     }
 
-    void hook_render_composite_layer() {
+    std::optional<uintptr_t> m_render_composite_layer_fn{};
+
+    bool resolve_render_composite_layer() {
         const auto game = utility::get_executable();
-        const auto ref = utility::find_function_from_string_ref(game, L"FEndMenuRenderer::OnRenderCompositeLayerEx", true);
+        m_render_composite_layer_fn = resolve_function(game, "FEndMenuRenderer::OnRenderCompositeLayerEx", [this]() {
+            return m_game->find_render_composite_layer();
+        });
 
-        if (!ref) {
-            API::get()->log_error("Failed to find FEndMenuRenderer::OnRenderCompositeLayer");
-            return;
+        if (!m_render_composite_layer_fn) {
+            API::get()->log_error("Failed to find FEndMenuRenderer::OnRenderCompositeLayer function start");
         }
 
-        const auto fn = utility::find_function_start_with_call(*ref);
+        return m_render_composite_layer_fn.has_value();
+    }
 
-        if (!fn) {
-            API::get()->log_error("Failed to find FEndMenuRenderer::OnRenderCompositeLayer function start");
-            return;
-        }
+    void hook_render_composite_layer() {
+        const auto fn = *m_render_composite_layer_fn;
 
-        m_hook_id = API::get()->param()->functions->register_inline_hook((void*)*fn, &on_render_composite_layer, (void**)&m_orig_render_composite_layer);
+        m_hook_id = install_hook("FEndMenuRenderer::OnRenderCompositeLayerEx", fn, &on_render_composite_layer, m_render_composite_layer_gate);
 
-        API::get()->log_info("FEndMenuRenderer::OnRenderCompositeLayerEx hooked at 0x%p", (void*)*fn);
+        API::get()->log_info("FEndMenuRenderer::OnRenderCompositeLayerEx hooked at 0x%p", (void*)fn);
     }
 
     Patch::Ptr m_motion_blur_patch{nullptr};
+    std::optional<uintptr_t> m_motion_blur_jmp{};
 
-    void patch_motion_blur() {
+    bool resolve_motion_blur() {
         SPDLOG_INFO("Scanning for MotionBlurIntermediate");
 
         const auto game = utility::get_executable();
-        const auto motion_blur_intermediate_ref = utility::find_function_from_string_ref(game, L"MotionBlurIntermediate", true);
-
-        if (!motion_blur_intermediate_ref) {
-            API::get()->log_error("Failed to find MotionBlurIntermediate");
-            SPDLOG_INFO("Failed to find MotionBlurIntermediate");
-            return;
-        }
-
-        const auto fn = utility::find_function_start_with_call(*motion_blur_intermediate_ref);
-
-        if (!fn) {
-            API::get()->log_error("Failed to find MotionBlurIntermediate function start");
-            SPDLOG_INFO("Failed to find MotionBlurIntermediate function start");
-            return;
-        }
-
-        const auto fn_callsite = utility::scan_displacement_reference(game, *fn, [](uintptr_t addr) -> bool {
-            return *(uint8_t*)(addr - 1) == 0xE8;
+        m_motion_blur_jmp = resolve_cached(game, "MotionBlurIntermediate.jmp", [this]() {
+            return m_game->find_motion_blur_jcc();
         });
 
-        if (!fn_callsite) {
-            API::get()->log_error("Failed to find MotionBlurIntermediate callsite");
-            SPDLOG_INFO("Failed to find MotionBlurIntermediate callsite");
-            return;
+        if (!m_motion_blur_jmp) {
+            API::get()->log_error("Failed to find conditional jmp for MotionBlurIntermediate");
         }
 
-        auto preceding_insns = utility::get_disassembly_behind(*fn_callsite);
+        return m_motion_blur_jmp.has_value();
+    }
 
-        if (preceding_insns.empty()) {
-            API::get()->log_error("Failed to disassemble preceding instructions for MotionBlurIntermediate");
-            SPDLOG_INFO("Failed to disassemble preceding instructions for MotionBlurIntermediate");
-            return;
-        }
+    void patch_motion_blur() {
+        const auto jmp_addr = m_motion_blur_jmp;
 
-        std::reverse(preceding_insns.begin(), preceding_insns.end());
+        SPDLOG_INFO("Found conditional jmp at 0x{:x}", *jmp_addr);
 
-        // Find first conditional jmp
-        auto jmp_insn = std::find_if(preceding_insns.begin(), preceding_insns.end(), [](const utility::Resolved& insn) {
-            auto& ix = insn.instrux;
-            return ix.BranchInfo.IsBranch && ix.BranchInfo.IsConditional;
-        });
+        // Re-decode it here, the cache only stores the address
+        const auto jmp_insn = utility::decode_one((uint8_t*)*jmp_addr);
 
-        if (jmp_insn == preceding_insns.end()) {
-            API::get()->log_error("Failed to find conditional jmp for MotionBlurIntermediate");
-            SPDLOG_INFO("Failed to find conditional jmp for MotionBlurIntermediate");
+        if (!jmp_insn || !jmp_insn->BranchInfo.IsBranch || !jmp_insn->BranchInfo.IsConditional) {
+            API::get()->log_error("Failed to decode conditional jmp for MotionBlurIntermediate");
+            SPDLOG_INFO("Failed to decode conditional jmp for MotionBlurIntermediate");
             return;
         }
 
-        SPDLOG_INFO("Found conditional jmp at 0x{:x}", jmp_insn->addr);
-
         // Modify to always jmp
         //if (*(uint8_t*)(jmp_insn->addr) == 0x0F) {
-        if (jmp_insn->instrux.RelOffsLength == 4) {
+        if (jmp_insn->RelOffsLength == 4) {
             SPDLOG_INFO("Patching conditional far jmp to always jmp");
 
-            if (jmp_insn->instrux.Length == 6) {
-                m_motion_blur_patch = Patch::create(jmp_insn->addr, { 0x90, 0xE9 });
+            if (jmp_insn->Length == 6) {
+                m_motion_blur_patch = Patch::create(*jmp_addr, { 0x90, 0xE9 });
                 SPDLOG_INFO("Patched MotionBlurIntermediate (6 bytes)");
-            } else if (jmp_insn->instrux.Length == 5) {
-                m_motion_blur_patch = Patch::create(jmp_insn->addr, { 0xE9 });
+            } else if (jmp_insn->Length == 5) {
+                m_motion_blur_patch = Patch::create(*jmp_addr, { 0xE9 });
                 SPDLOG_INFO("Patched MotionBlurIntermediate (5 bytes)");
             } else {
                 API::get()->log_error("Failed to patch MotionBlurIntermediate: unexpected instruction length");
@@ -302,7 +599,7 @@ private:
             }
         } else {
             SPDLOG_INFO("Patching conditional jmp to always jmp");
-            m_motion_blur_patch = Patch::create(jmp_insn->addr, { 0xEB });
+            m_motion_blur_patch = Patch::create(*jmp_addr, { 0xEB });
         }
 
         SPDLOG_INFO("Patched MotionBlurIntermediate");
@@ -310,10 +607,10 @@ private:
 
     int m_post_process_settings_hook_id{-1};
     using PostProcessSettingsFn = void* (*)(void* self, void* a2, void* a3, void* a4);
-    PostProcessSettingsFn m_orig_post_process_settings{nullptr};
+    analysis::HookGate<PostProcessSettingsFn> m_post_process_settings_gate{};
 
     void* on_post_process_settings_internal(void* self, void* a2, void* a3, void* a4) {
-        auto res = m_orig_post_process_settings(self, a2, a3, a4);
+        auto res = m_post_process_settings_gate.call_original(self, a2, a3, a4);
 
         static const auto post_process_settings_t = API::get()->find_uobject<API::UScriptStruct>(L"ScriptStruct /Script/Engine.PostProcessSettings");
 
@@ -336,6 +633,11 @@ private:
     }
 
     static void* on_post_process_settings(void* self, void* a2, void* a3, void* a4) {
+        // Constructors return this
+        if (const auto& gate = g_plugin->m_post_process_settings_gate; !gate.is_live()) {
+            return gate.call_original(self, a2, a3, a4);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -346,46 +648,31 @@ private:
         return g_plugin->on_post_process_settings_internal(self, a2, a3, a4);
     }
 
-    void hook_post_process_settings() {
+    std::optional<uintptr_t> m_post_process_settings_fn{};
+
+    bool resolve_post_process_settings() {
         const auto game = utility::get_executable();
-        const auto str = utility::scan_string(game, L"r.DefaultFeature.AutoExposure.Bias");
+        m_post_process_settings_fn = resolve_function(game, "FPostProcessSettings::FPostProcessSettings", [this]() {
+            return m_game->find_post_process_settings();
+        });
 
-        if (!str) {
-            API::get()->log_error("Failed to find r.DefaultFeature.AutoExposure.Bias");
-            return;
+        if (!m_post_process_settings_fn) {
+            API::get()->log_error("Failed to find FPostProcessSettings::FPostProcessSettings");
         }
 
-        std::optional<uintptr_t> func_start{};
-
-        const auto ref = utility::scan_displacement_reference(game, *str, [&](uintptr_t addr) -> bool {
-            func_start = utility::find_function_start_with_call(addr);
-
-            if (!func_start) {
-                return false;
-            }
-
-            size_t refs{};
-            utility::scan_displacement_reference(game, *func_start, [&](uintptr_t addr2) -> bool {
-                ++refs;
-                return false;
-            });
-
-            return refs > 3;
-        });
+        return m_post_process_settings_fn.has_value();
+    }
 
-        if (!ref) {
-            API::get()->log_error("Failed to find r.DefaultFeature.AutoExposure.Bias callsite");
-            return;
-        }
+    void hook_post_process_settings() {
+        const auto func_start = m_post_process_settings_fn;
 
-        SPDLOG_INFO("r.DefaultFeature.AutoExposure.Bias callsite at 0x{:x}", *ref);
         SPDLOG_INFO("FPostProcessSettings::FPostProcessSettings at 0x{:x}", *func_start);
 
-        m_post_process_settings_hook_id = API::get()->param()->functions->register_inline_hook((void*)*func_start, &on_post_process_settings, (void**)&m_orig_post_process_settings);
+        m_post_process_settings_hook_id = install_hook("FPostProcessSettings::FPostProcessSettings", *func_start, &on_post_process_settings, m_post_process_settings_gate);
     }
 
     using FScene_StartFrame = void* (*)(void* self, void* a2, void* a3, void* a4);
-    FScene_StartFrame m_orig_startframe{nullptr};
+    analysis::HookGate<FScene_StartFrame> m_startframe_gate{};
     int m_startframe_hook_id{-1};
     uint32_t m_last_frame_count{0};
     size_t m_last_real_frame_count{0};
@@ -402,23 +689,33 @@ private:
 
         m_last_real_frame_count = internal_frame_count;
 
+        if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) [[unlikely]] {
+            trace->record_start_frame(get_trace_frame(), self, a2, a3, a4);
+        }
+
+        const auto state = get_ghosting_fix_state();
+
         // We don't care to do anything with this function if we're running in native stereo.
-        if (!m_is_hmd_active || m_using_native_stereo || !m_ghosting_fix_enabled) {
-            return m_orig_startframe(self, a2, a3, a4);
+        if (!analysis::is_ghosting_fix_active(state)) {
+            return m_startframe_gate.call_original(self, a2, a3, a4);
         }
 
         auto scene_frame_count = m_scene_frame_counts[(uintptr_t)self];
 
         void* res = nullptr;
         // Only update velocity stuff every other frame
-        if ((*GFrameNumberRenderThread % 2) == 0) {
-            res = m_orig_startframe(self, a2, a3, a4);
+        if (analysis::should_start_frame(state, *GFrameNumberRenderThread)) {
+            res = m_startframe_gate.call_original(self, a2, a3, a4);
         }
 
         return res;
     }
 
     static void* on_startframe(void* self, void* a2, void* a3, void* a4) {
+        if (const auto& gate = g_plugin->m_startframe_gate; !gate.is_live()) {
+            return gate.call_original(self, a2, a3, a4);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -455,7 +752,7 @@ private:
     }
 
     using FVelocityData_UpdateTransform = void* (*)(void* self, void* a2, void* a3, void* a4);
-    FVelocityData_UpdateTransform m_orig_update_transform{nullptr};
+    analysis::HookGate<FVelocityData_UpdateTransform> m_update_transform_gate{};
     int m_update_transform_hook_id{-1};
 
     std::unordered_map<uintptr_t, uint32_t> m_velocity_to_scene_frame_counts{};
@@ -466,17 +763,25 @@ private:
         const auto scene_frame_count = *(uint32_t*)(scene + m_scene_frame_count_offset);
         const auto velocity_frame_count = *(size_t*)self;
 
+        if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) [[unlikely]] {
+            trace->record_update_transform(get_trace_frame(), self, a2, a3, a4);
+        }
+
         if (m_is_hmd_active && !m_using_native_stereo) {
             // Don't update velocity transform on odd frames
-            if ((*GFrameNumberRenderThread % 2) == 1) {
+            if (!analysis::should_update_transform(get_ghosting_fix_state(), *GFrameNumberRenderThread)) {
                 return nullptr;
             }
         }
 
-        return m_orig_update_transform(self, a2, a3, a4);
+        return m_update_transform_gate.call_original(self, a2, a3, a4);
     }
 
     static void* on_update_transform(void* self, void* a2, void* a3, void* a4) {
+        if (const auto& gate = g_plugin->m_update_transform_gate; !gate.is_live()) {
+            return gate.call_original(self, a2, a3, a4);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -488,7 +793,7 @@ private:
     }
 
     using FScene_UpdateAllPrimitiveSceneInfos = void* (*)(void* self, void* a2, void* a3, void* a4);
-    FScene_UpdateAllPrimitiveSceneInfos m_orig_update_all_primitive_scene_infos{nullptr};
+    analysis::HookGate<FScene_UpdateAllPrimitiveSceneInfos> m_update_all_primitive_scene_infos_gate{};
     int m_update_all_primitive_scene_infos_hook_id{-1};
 
     std::unordered_set<uintptr_t> m_scenes{};
@@ -500,12 +805,16 @@ private:
             SPDLOG_INFO("FScene::UpdateAllPrimitiveSceneInfos: scene = 0x{:x}", (uintptr_t)scene);
         }
 
-        auto res = m_orig_update_all_primitive_scene_infos(scene, a2, a3, a4);
+        auto res = m_update_all_primitive_scene_infos_gate.call_original(scene, a2, a3, a4);
 
         return res;
     }
 
     static void* update_all_primitive_scene_infos(void* self, void* a2, void* a3, void* a4) {
+        if (const auto& gate = g_plugin->m_update_all_primitive_scene_infos_gate; !gate.is_live()) {
+            return gate.call_original(self, a2, a3, a4);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -521,7 +830,7 @@ private:
     };
 
     using FScene_GetPrimitiveUniformShaderParameters_RenderThread = void* (*)(void* self, void* primitive_scene_info, void* a3, FMatrix* a4, int32_t& single_capture_index, bool& output_velocity);
-    FScene_GetPrimitiveUniformShaderParameters_RenderThread m_orig_get_primitive_uniform_shader_parameters_render_thread{nullptr};
+    analysis::HookGate<FScene_GetPrimitiveUniformShaderParameters_RenderThread> m_get_primitive_uniform_shader_parameters_render_thread_gate{};
     int m_get_primitive_uniform_shader_parameters_render_thread_hook_id{-1};
 
     std::unordered_map<uint32_t, FMatrix> m_previous_local_to_worlds{};
@@ -532,13 +841,17 @@ private:
         auto& velocity_frame_count = *(size_t*)velocity_data;
         uint32_t prim_id = *(uint32_t*)((uintptr_t)primitive_scene_info + 0x10);
 
+        if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) [[unlikely]] {
+            trace->record_primitive_uniform_shader_parameters(get_trace_frame(), scene, primitive_scene_info, a3, previous_local_to_world, prim_id, scene_frame_count);
+        }
+
         if (scene_frame_count != m_scene_frame_counts[(uintptr_t)scene]) {
             m_scene_frame_counts[(uintptr_t)scene] = scene_frame_count;
             m_velocity_to_scene_frame_counts[velocity_data] = scene_frame_count;
         }
 
         if (true) {
-            auto res = m_orig_get_primitive_uniform_shader_parameters_render_thread(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
+            auto res = m_get_primitive_uniform_shader_parameters_render_thread_gate.call_original(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
 
             return res;
         }
@@ -550,7 +863,7 @@ private:
 
             if (proxy != nullptr) {
                 //memcpy(previous_local_to_world, (FMatrix*)((uintptr_t)proxy + 0x80), sizeof(FMatrix));
-                m_orig_get_primitive_uniform_shader_parameters_render_thread(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
+                m_get_primitive_uniform_shader_parameters_render_thread_gate.call_original(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
                 if (output_velocity) {
                     auto real_last = *previous_local_to_world;
                     *previous_local_to_world = m_previous_local_to_worlds[prim_id];
@@ -559,13 +872,13 @@ private:
                     single_capture_index = *(int32_t*)((uintptr_t)primitive_scene_info + 0x80);
                 }
             } else {
-                auto res = m_orig_get_primitive_uniform_shader_parameters_render_thread(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
+                auto res = m_get_primitive_uniform_shader_parameters_render_thread_gate.call_original(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
                 m_previous_local_to_worlds[prim_id] = *previous_local_to_world;
 
                 return res;
             }
         } else {
-            auto res = m_orig_get_primitive_uniform_shader_parameters_render_thread(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
+            auto res = m_get_primitive_uniform_shader_parameters_render_thread_gate.call_original(scene, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
             m_previous_local_to_worlds[prim_id] = *previous_local_to_world;
 
             return res;
@@ -576,6 +889,10 @@ private:
     }
 
     static void* get_primitive_uniform_shader_parameters_render_thread(void* self, void* primitive_scene_info, void* a3, FMatrix* previous_local_to_world, int32_t& single_capture_index, bool& output_velocity) {
+        if (const auto& gate = g_plugin->m_get_primitive_uniform_shader_parameters_render_thread_gate; !gate.is_live()) {
+            return gate.call_original(self, primitive_scene_info, a3, previous_local_to_world, single_capture_index, output_velocity);
+        }
+
         static bool once = true;
 
         if (once) {
@@ -607,118 +924,146 @@ private:
         return g_plugin->create_scene_renderer_internal(self, a2, a3, a4);
     }
 
-    void hook_startframe() {
-        SPDLOG_INFO("Scanning for FScene::StartFrame");
+    // The vtable slot and both offsets are derived from StartFrame, so they're only trusted if StartFrame itself is still valid.
+    std::optional<uintptr_t> load_startframe_from_cache() {
         const auto game = utility::get_executable();
-        const auto game_size = utility::get_module_size(game).value_or(0);
-        const auto game_end = (uintptr_t)game + game_size;
+        const auto fn = m_scan_cache.get_address((uintptr_t)game, "FScene::StartFrame");
+        const auto vtable_rva = m_scan_cache.get_value((uintptr_t)game, "FScene::StartFrame.vtable");
+        const auto velocity_data_offset = m_scan_cache.get_value((uintptr_t)game, "FScene::VelocityData.offset");
+        const auto scene_frame_count_offset = m_scan_cache.get_value((uintptr_t)game, "FScene::FrameCount.offset");
 
-        std::optional<uintptr_t> fn{};
+        if (!fn || !vtable_rva || !velocity_data_offset || !scene_frame_count_offset) {
+            return std::nullopt;
+        }
 
-        uint64_t magic_constant = 0x47AE147AE147AE15;
-        for (auto magic_constant_ref  = utility::scan_data(game, (uint8_t*)&magic_constant, sizeof(magic_constant));
-            magic_constant_ref;
-            magic_constant_ref = utility::scan_data(*magic_constant_ref + 1, game_end - (*magic_constant_ref + 1), (uint8_t*)&magic_constant, sizeof(magic_constant))) 
-        {
-            // There's a quirk with this function where it uses a tail jmp
-            // optimization which causes us to unwind to something other than the basic block
-            // found by find_function_start. This is useful for us because it's very obvious
-            const auto fn_start_unwind = utility::find_function_start_unwind(*magic_constant_ref);
+        if (*vtable_rva + sizeof(void*) > utility::get_module_size(game).value_or(0)) {
+            return std::nullopt;
+        }
 
-            if (!fn_start_unwind) {
-                continue;
-            }
+        const auto vtable_addr = (uintptr_t)game + *vtable_rva;
 
-            const auto fn_jmp = utility::scan_displacement_reference(game, *fn_start_unwind, [](uintptr_t addr) -> bool {
-                return *(uint8_t*)(addr - 1) == 0xE9; // JMP
-            });
+        if (*(uintptr_t*)vtable_addr != *fn) {
+            SPDLOG_WARN("[ScanCache] FScene::StartFrame vtable slot no longer matches, rescanning");
+            return std::nullopt;
+        }
 
-            if (!fn_jmp) {
-                continue;
-            }
+        m_start_frame_vtable_addr = vtable_addr;
+        m_velocity_data_offset = (uint32_t)*velocity_data_offset;
+        m_scene_frame_count_offset = (uint32_t)*scene_frame_count_offset;
 
-            const auto fn_start = utility::find_function_start_unwind(*fn_jmp);
+        SPDLOG_INFO("[ScanCache] FScene::StartFrame at 0x{:x} (cached)", *fn);
 
-            if (!fn_start) {
-                continue;
-            }
+        return fn;
+    }
 
-            // Means it's a virtual function which is what we want
-            if (auto vtable_addr = utility::scan_ptr(game, *fn_start)) {
-                m_start_frame_vtable_addr = *vtable_addr;
+    std::optional<uintptr_t> scan_startframe() {
+        const auto game = utility::get_executable();
+        const auto result = m_game->find_startframe();
+
+        if (!result) {
+            return std::nullopt;
+        }
 
-                const auto get_frame_count_fn = *(uintptr_t*)(m_start_frame_vtable_addr + sizeof(void*)); // + 1
-                m_scene_frame_count_offset = *(uint32_t*)(get_frame_count_fn + 2);
+        m_start_frame_vtable_addr = result->vtable;
+        m_scene_frame_count_offset = result->frame_count_offset;
 
 #if 0
-                const auto increment_frame_count_fn = *(uintptr_t*)(m_start_frame_vtable_addr + (sizeof(void*) * 2));
-                m_increment_frame_count_hook_id = API::get()->param()->functions->register_inline_hook((void*)increment_frame_count_fn, &on_increment_frame_count, (void**)&m_orig_increment_frame_count);
+        const auto increment_frame_count_fn = *(uintptr_t*)(m_start_frame_vtable_addr + (sizeof(void*) * 2));
+        m_increment_frame_count_hook_id = API::get()->param()->functions->register_inline_hook((void*)increment_frame_count_fn, &on_increment_frame_count, (void**)&m_orig_increment_frame_count);
 #endif
 
-                SPDLOG_INFO("FScene::StartFrame vtable func at 0x{:x}", *vtable_addr);
-                SPDLOG_INFO("FScene::StartFrame frame count offset at 0x{:x}", m_scene_frame_count_offset);
+        if (result->velocity_data_offset) {
+            m_velocity_data_offset = *result->velocity_data_offset;
 
-                const auto get_primitive_uniform_shader_parameters_render_thread_fn = *(uintptr_t*)(m_start_frame_vtable_addr - (sizeof(void*) * 48));
+            m_scan_cache.set_address((uintptr_t)game, "FScene::StartFrame", result->fn);
+            m_scan_cache.set_value((uintptr_t)game, "FScene::StartFrame.vtable", m_start_frame_vtable_addr - (uintptr_t)game);
+            m_scan_cache.set_value((uintptr_t)game, "FScene::VelocityData.offset", m_velocity_data_offset);
+            m_scan_cache.set_value((uintptr_t)game, "FScene::FrameCount.offset", m_scene_frame_count_offset);
+        }
 
-                m_get_primitive_uniform_shader_parameters_render_thread_hook_id = API::get()->param()->functions->register_inline_hook((void*)get_primitive_uniform_shader_parameters_render_thread_fn, &get_primitive_uniform_shader_parameters_render_thread, (void**)&m_orig_get_primitive_uniform_shader_parameters_render_thread);
+        return result->fn;
+    }
 
-                SPDLOG_INFO("FScene::GetPrimitiveUniformShaderParameters_RenderThread hooked at 0x{:x}", get_primitive_uniform_shader_parameters_render_thread_fn);
+    std::optional<uintptr_t> m_startframe_fn{};
 
+    bool resolve_startframe() {
+        SPDLOG_INFO("Scanning for FScene::StartFrame");
 
-                fn = fn_start;
+        m_startframe_fn = load_startframe_from_cache();
 
-                const auto add_rcx = utility::scan_disasm(*fn, 20, "48 81 C1 ? ? ? ?");
-                if (add_rcx) {
-                    m_velocity_data_offset = *(uint32_t*)(*add_rcx + 3);
-                    SPDLOG_INFO("FScene::StartFrame velocity data offset = 0x{:x}", m_velocity_data_offset);
-                }
-
-                break;
-            }
+        if (!m_startframe_fn) {
+            m_startframe_fn = scan_startframe();
         }
 
-        if (!fn) {
+        if (!m_startframe_fn) {
             SPDLOG_ERROR("Failed to find FScene::StartFrame");
-            return;
+            return false;
         }
 
-        m_startframe_hook_id = API::get()->param()->functions->register_inline_hook((void*)*fn, &on_startframe, (void**)&m_orig_startframe);
+        return true;
+    }
+
+    void hook_startframe() {
+        const auto fn = m_startframe_fn;
+
+        const auto get_primitive_uniform_shader_parameters_render_thread_fn = *(uintptr_t*)(m_start_frame_vtable_addr - (sizeof(void*) * 48));
+
+        m_get_primitive_uniform_shader_parameters_render_thread_hook_id = install_hook("FScene::GetPrimitiveUniformShaderParameters_RenderThread", get_primitive_uniform_shader_parameters_render_thread_fn, &get_primitive_uniform_shader_parameters_render_thread, m_get_primitive_uniform_shader_parameters_render_thread_gate);
+
+        SPDLOG_INFO("FScene::GetPrimitiveUniformShaderParameters_RenderThread hooked at 0x{:x}", get_primitive_uniform_shader_parameters_render_thread_fn);
+
+        m_startframe_hook_id = install_hook("FScene::StartFrame", *fn, &on_startframe, m_startframe_gate);
 
         SPDLOG_INFO("FScene::StartFrame hooked at 0x{:x}", *fn);
     }
 
-    void hook_update_transform() {
+    std::optional<uintptr_t> m_update_transform_fn{};
+    std::optional<uintptr_t> m_update_all_primitive_scene_infos_fn{};
+
+    bool resolve_update_transform() {
         SPDLOG_INFO("Scanning for FVelocityData::UpdateTransform");
 
         const auto game = utility::get_executable();
-        const auto fn = utility::scan(game, "48 89 5C 24 10 48 89 6C 24 18 56 57 41 55 41 56 41 57 B8 ? ? ? ? E8 ? ? ? ? 48 2B E0 8B 41 10");
+        m_update_transform_fn = resolve_function(game, "FVelocityData::UpdateTransform", [this]() {
+            return m_game->find_update_transform();
+        });
 
-        if (!fn) {
+        if (!m_update_transform_fn) {
             API::get()->log_error("Failed to find FVelocityData::UpdateTransform");
-            return;
+            return false;
         }
 
-        m_update_transform_hook_id = API::get()->param()->functions->register_inline_hook((void*)*fn, &on_update_transform, (void**)&m_orig_update_transform);
+        return true;
+    }
+
+    void hook_update_transform() {
+        const auto fn = m_update_transform_fn;
+
+        m_update_transform_hook_id = install_hook("FVelocityData::UpdateTransform", *fn, &on_update_transform, m_update_transform_gate);
 
         SPDLOG_INFO("FVelocityData::UpdateTransform hooked at 0x{:x}", *fn);
+    }
+
+    bool resolve_update_all_primitive_scene_infos() {
+        const auto game = utility::get_executable();
+        const auto fn = m_update_transform_fn;
 
-        const auto call_ref = utility::scan_displacement_reference(game, *fn, [](uintptr_t addr) -> bool {
-            return *(uint8_t*)(addr - 1) == 0xE8; // CALL
+        m_update_all_primitive_scene_infos_fn = resolve_function(game, "FScene::UpdateAllPrimitiveSceneInfos", [&]() {
+            return m_game->find_update_all_primitive_scene_infos(*fn);
         });
 
-        if (!call_ref) {
+        if (!m_update_all_primitive_scene_infos_fn) {
             API::get()->log_error("Failed to find FScene::UpdateAllPrimitiveSceneInfos");
-            return;
+            return false;
         }
 
-        const auto update_all_primitive_scene_infos_fn = utility::find_function_start_unwind(*call_ref);
+        return true;
+    }
 
-        if (!update_all_primitive_scene_infos_fn) {
-            API::get()->log_error("Failed to find FScene::UpdateAllPrimitiveSceneInfos");
-            return;
-        }
+    void hook_update_all_primitive_scene_infos() {
+        const auto update_all_primitive_scene_infos_fn = m_update_all_primitive_scene_infos_fn;
 
-        m_update_all_primitive_scene_infos_hook_id = API::get()->param()->functions->register_inline_hook((void*)*update_all_primitive_scene_infos_fn, &update_all_primitive_scene_infos, (void**)&m_orig_update_all_primitive_scene_infos);
+        m_update_all_primitive_scene_infos_hook_id = install_hook("FScene::UpdateAllPrimitiveSceneInfos", *update_all_primitive_scene_infos_fn, &update_all_primitive_scene_infos, m_update_all_primitive_scene_infos_gate);
 
         SPDLOG_INFO("FScene::UpdateAllPrimitiveSceneInfos hooked at 0x{:x}", *update_all_primitive_scene_infos_fn);
     }
@@ -743,9 +1088,29 @@ private:
     }
 
     using CDevice_CopyDescriptorsFn = void* (*)(void* self, UINT NumDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts, const UINT* pDestDescriptorRangeSizes, UINT NumSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts, const UINT* pSrcDescriptorRangeSizes, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType);
-    CDevice_CopyDescriptorsFn m_orig_copy_descriptors{nullptr};
+    analysis::HookGate<CDevice_CopyDescriptorsFn> m_copy_descriptors_gate{};
     int m_copy_descriptors_hook_id{-1};
 
+    // Everything copy_descriptors needs on every call, so the steady state never goes through g_plugin.
+    // The trampoline gets cached on the first call after the hook went in, see copy_descriptors_original_cold.
+    static inline std::atomic<CDevice_CopyDescriptorsFn> s_copy_descriptors_original{nullptr};
+    static inline const analysis::simd::FindNullHandleFn s_find_null_handle{analysis::simd::get_find_null_handle()};
+
+    // Every descriptor heap created since hook_descriptor_heap_tracking, by CPU address.
+    static inline analysis::DescriptorHeapIndex s_descriptor_heaps{};
+
+    // GetDescriptorHandleIncrementSize for every D3D12_DESCRIPTOR_HEAP_TYPE, fixed for the lifetime of the device. 0 until resolved.
+    static inline std::array<std::atomic<uint32_t>, D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES> s_descriptor_increments{};
+
+    // Opt-in (FF7PLUGIN_COALESCE_DESCRIPTORS=1), set once in on_initialize. Merges adjacent ranges before they reach the driver.
+    static inline bool s_coalesce_descriptors{false};
+
+    // On the stack of every coalesced call, anything that doesn't merge down to this many ranges just passes through
+    static constexpr uint32_t MAX_COALESCED_RANGES = 64;
+
+    // Source handles remembered when a call faults. Only the first few, so one bad call can't flush everything else out of the fault cache.
+    static constexpr UINT MAX_FAULT_SUSPECTS = analysis::DescriptorHeapIndex::FAULT_CACHE_SIZE / 4;
+
     // D3D12Core.dll!CDevice::CopyDescriptors(unsigned int,struct D3D12_CPU_DESCRIPTOR_HANDLE const *,unsigned int const *,unsigned int,struct D3D12_CPU_DESCRIPTOR_HANDLE const *,unsigned int const *,enum D3D12_DESCRIPTOR_HEAP_TYPE)	Unknown
     static void* copy_descriptors(
         void* self,
@@ -768,29 +1133,177 @@ private:
         // The times we actually catch the exception, we'll just literally not do anything and stop the game from crashing... usually.
         // But still, this is probably the most unholy thing ever.
 
-        // Wait for m_orig_copy_descriptors to be set. This function is called quite often so this can actually happen during initial hooking.
-        while (g_plugin->m_orig_copy_descriptors == nullptr) {
-            SPDLOG_INFO("Waiting for m_orig_copy_descriptors to be set...");
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // This gets called thousands of times per frame, so the steady state is two loads (trampoline, trace) and a vectorized scan of the handles.
+        // Relaxed is enough, the trampoline was written long before it got published and x64 doesn't reorder the loads anyway.
+        auto orig = s_copy_descriptors_original.load(std::memory_order_relaxed);
+
+        // Only until the first call after the hook went in, it can run while it's still being hooked
+        if (orig == nullptr) [[unlikely]] {
+            orig = copy_descriptors_original_cold();
         }
 
+        static_assert(sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) == sizeof(uint64_t));
+        static_assert(sizeof(UINT) == sizeof(uint32_t));
+
+        // The first few source handles, copied right before the call goes out. The caller's arrays may well be
+        // what faulted, so the handler only ever looks at this copy.
+        uint64_t suspects[MAX_FAULT_SUSPECTS];
+        UINT num_suspects = 0;
+
+        // x64 SEH is table based, the __try doesn't cost anything until something actually faults.
+        // Everything that reads the caller's arrays goes in here, not just the driver.
         __try {
-            if (pSrcDescriptorRangeStarts != nullptr && NumSrcDescriptorRanges > 0) {
-                using DescriptorHandlePtr = decltype(D3D12_CPU_DESCRIPTOR_HANDLE::ptr);
-                const auto ranges_uintptr_t_start = (DescriptorHandlePtr*)pSrcDescriptorRangeStarts;
-                const auto ranges_uintptr_t_end = ranges_uintptr_t_start + NumSrcDescriptorRanges;
-                if (auto it = std::find(ranges_uintptr_t_start, ranges_uintptr_t_end, 0); it != ranges_uintptr_t_end) {
-                    const auto i = std::distance(ranges_uintptr_t_start, it);
-                    SPDLOG_CRITICAL("Bad read on pSrcDescriptorRangeStarts[{}], skipping", i);
-                    std::this_thread::yield();
-                    return nullptr;
-                }
+            // Every call as it came in, before anything gets filtered out
+            if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) [[unlikely]] {
+                trace->record_copy_descriptors(self,
+                    NumDestDescriptorRanges, (const uint64_t*)pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
+                    NumSrcDescriptorRanges, (const uint64_t*)pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
+                    (uint32_t)DescriptorHeapsType);
             }
 
-            auto res = g_plugin->m_orig_copy_descriptors(self, NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes, NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes, DescriptorHeapsType);
-            return res;
+            // Null source handles, then stale, out of bounds or recently faulting ranges. Doesn't depend on the gate being live.
+            // Handles in heaps that were created before the tracking hooks went in only get the null check and the __try.
+            if (const auto decision = analysis::filter_copy_descriptors(s_find_null_handle, s_descriptor_heaps,
+                    NumDestDescriptorRanges, (const uint64_t*)pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
+                    NumSrcDescriptorRanges, (const uint64_t*)pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
+                    (uint32_t)DescriptorHeapsType);
+                decision.verdict != analysis::CopyDescriptorsVerdict::FORWARD) [[unlikely]]
+            {
+                return decision.verdict == analysis::CopyDescriptorsVerdict::NULL_HANDLE ? reject_copy_descriptors(decision.null_index) : reject_invalid_copy_descriptors(decision.check);
+            }
+
+            // Already in cache from the null scan. Only counted once they're all copied, in case the copy is what faults.
+            if (pSrcDescriptorRangeStarts != nullptr) {
+                const auto n = std::min<UINT>(NumSrcDescriptorRanges, MAX_FAULT_SUSPECTS);
+                std::memcpy(suspects, pSrcDescriptorRangeStarts, n * sizeof(uint64_t));
+                num_suspects = n;
+            }
+
+            if (s_coalesce_descriptors) {
+                return copy_descriptors_coalesced(orig, self, NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes, NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes, DescriptorHeapsType);
+            }
+
+            return orig(self, NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes, NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes, DescriptorHeapsType);
         } __except (EXCEPTION_EXECUTE_HANDLER) {
-            SPDLOG_CRITICAL("Failed to call CDevice::CopyDescriptors, but who cares? We won't crash anyways!");
+            return on_copy_descriptors_fault(NumSrcDescriptorRanges, suspects, num_suspects);
+        }
+    }
+
+    // Forwards the call with each side's adjacent ranges merged, which saves the driver per range work.
+    // Falls back to passing the call through as is when nothing merges or the result doesn't fit on the stack.
+    static void* copy_descriptors_coalesced(
+        CDevice_CopyDescriptorsFn orig,
+        void* self,
+        UINT                              NumDestDescriptorRanges,
+        const D3D12_CPU_DESCRIPTOR_HANDLE *pDestDescriptorRangeStarts,
+        const UINT                        *pDestDescriptorRangeSizes,
+        UINT                              NumSrcDescriptorRanges,
+        const D3D12_CPU_DESCRIPTOR_HANDLE *pSrcDescriptorRangeStarts,
+        const UINT                        *pSrcDescriptorRangeSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE        DescriptorHeapsType
+    )
+    {
+        const auto increment = (size_t)DescriptorHeapsType < s_descriptor_increments.size() ? s_descriptor_increments[DescriptorHeapsType].load(std::memory_order_relaxed) : 0;
+
+        uint64_t dest_starts[MAX_COALESCED_RANGES];
+        uint32_t dest_sizes[MAX_COALESCED_RANGES];
+        uint64_t src_starts[MAX_COALESCED_RANGES];
+        uint32_t src_sizes[MAX_COALESCED_RANGES];
+        analysis::CoalescedRanges dest{dest_starts, dest_sizes, MAX_COALESCED_RANGES};
+        analysis::CoalescedRanges src{src_starts, src_sizes, MAX_COALESCED_RANGES};
+
+        if (!analysis::coalesce_copy_descriptors(
+                NumDestDescriptorRanges, (const uint64_t*)pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
+                NumSrcDescriptorRanges, (const uint64_t*)pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
+                increment, dest, src))
+        {
+            return orig(self, NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes, NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes, DescriptorHeapsType);
+        }
+
+        return orig(self,
+            dest.count, (const D3D12_CPU_DESCRIPTOR_HANDLE*)dest_starts, (const UINT*)dest_sizes,
+            src.count, (const D3D12_CPU_DESCRIPTOR_HANDLE*)src_starts, (const UINT*)src_sizes,
+            DescriptorHeapsType);
+    }
+
+    __declspec(noinline) static CDevice_CopyDescriptorsFn copy_descriptors_original_cold() {
+        const auto orig = g_plugin->m_copy_descriptors_gate.get_original();
+        s_copy_descriptors_original.store(orig, std::memory_order_relaxed);
+
+        return orig;
+    }
+
+    // These come in bursts of hundreds per frame, exactly when the game is already hitching. Never log them synchronously.
+    static constexpr analysis::EventType COPY_DESCRIPTORS_REJECTED{
+        spdlog::level::critical,
+        "Bad read on pSrcDescriptorRangeStarts[{}], skipping",
+        "Rejected {} CopyDescriptors call(s) in last {}ms, first index {}",
+    };
+
+    static constexpr analysis::EventType COPY_DESCRIPTORS_FAULTED{
+        spdlog::level::critical,
+        "Failed to call CDevice::CopyDescriptors (source ranges: {}), but who cares? We won't crash anyways!",
+        "Failed to call CDevice::CopyDescriptors {} time(s) in last {}ms, first one had {} source range(s). We didn't crash anyways!",
+    };
+
+    __declspec(noinline) static void* reject_copy_descriptors(size_t i) {
+        if (const auto& log = g_plugin->m_event_log; log != nullptr) {
+            log->post(COPY_DESCRIPTORS_REJECTED, (int64_t)i);
+        }
+
+        std::this_thread::yield();
+
+        return nullptr;
+    }
+
+    static constexpr analysis::EventType COPY_DESCRIPTORS_STALE{
+        spdlog::level::critical,
+        "pSrcDescriptorRangeStarts[{}] is in a destroyed descriptor heap, skipping",
+        "Rejected {} CopyDescriptors call(s) with stale source ranges in last {}ms, first index {}",
+    };
+
+    static constexpr analysis::EventType COPY_DESCRIPTORS_OUT_OF_BOUNDS{
+        spdlog::level::critical,
+        "pSrcDescriptorRangeStarts[{}] doesn't fit its descriptor heap, skipping",
+        "Rejected {} CopyDescriptors call(s) with source ranges out of bounds, misaligned or of the wrong type in last {}ms, first index {}",
+    };
+
+    static constexpr analysis::EventType COPY_DESCRIPTORS_FAULTED_BEFORE{
+        spdlog::level::critical,
+        "pSrcDescriptorRangeStarts[{}] made the driver fault before, skipping",
+        "Rejected {} CopyDescriptors call(s) with previously faulting source ranges in last {}ms, first index {}",
+    };
+
+    static constexpr analysis::EventType COPY_DESCRIPTORS_BAD_DEST{
+        spdlog::level::critical,
+        "pDestDescriptorRangeStarts[{}] doesn't fit a live descriptor heap, skipping",
+        "Rejected {} CopyDescriptors call(s) with bad destination ranges in last {}ms, first index {}",
+    };
+
+    __declspec(noinline) static void* reject_invalid_copy_descriptors(const analysis::DescriptorHeapIndex::CopyCheck& check) {
+        if (const auto& log = g_plugin->m_event_log; log != nullptr) {
+            const auto& type = !check.source ? COPY_DESCRIPTORS_BAD_DEST :
+                check.result == analysis::DescriptorCheck::STALE ? COPY_DESCRIPTORS_STALE :
+                check.result == analysis::DescriptorCheck::FAULTED ? COPY_DESCRIPTORS_FAULTED_BEFORE :
+                COPY_DESCRIPTORS_OUT_OF_BOUNDS;
+
+            log->post(type, check.index);
+        }
+
+        std::this_thread::yield();
+
+        return nullptr;
+    }
+
+    // Never touches the caller's arrays, suspects is copy_descriptors' own copy of the first few source handles.
+    __declspec(noinline) static void* on_copy_descriptors_fault(UINT num_src_ranges, const uint64_t* suspects, UINT num_suspects) {
+        if (const auto& log = g_plugin->m_event_log; log != nullptr) {
+            log->post(COPY_DESCRIPTORS_FAULTED, num_src_ranges);
+        }
+
+        // No telling which one it was
+        for (UINT i = 0; i < num_suspects; ++i) {
+            s_descriptor_heaps.remember_fault(suspects[i]);
         }
 
         std::this_thread::yield();
@@ -799,25 +1312,259 @@ private:
         return nullptr;
     }
 
-    void hook_copy_descriptors() {
+    std::optional<uintptr_t> m_copy_descriptors_fn{};
+
+    // IUnknown (3) + ID3D12Object (4) + ID3D12Device::GetNodeCount..CreateSampler (16)
+    static constexpr uint32_t ID3D12DEVICE_COPY_DESCRIPTORS_INDEX = 23;
+
+    // The device UEVR hands us is a CDevice, so its vtable already points at CopyDescriptors
+    // (or a stub in front of it). One pointer read instead of scanning D3D12Core.dll.
+    std::optional<uintptr_t> resolve_copy_descriptors_from_device(HMODULE d3d12core) {
+        const auto renderer = API::get()->param()->renderer;
+
+        if (renderer == nullptr || renderer->renderer_type != UEVR_RENDERER_D3D12 || renderer->device == nullptr) {
+            SPDLOG_INFO("No D3D12 device yet, can't resolve CDevice::CopyDescriptors from its vtable");
+            return std::nullopt;
+        }
+
+        const auto chain = analysis::resolve_virtual(renderer->device, ID3D12DEVICE_COPY_DESCRIPTORS_INDEX);
+
+        if (!chain) {
+            SPDLOG_WARN("ID3D12Device::CopyDescriptors slot is a stub loop or empty");
+            return std::nullopt;
+        }
+
+        // Overlays and debug layers can wrap the device, only trust it if it lands in D3D12Core.dll
+        const auto in_core = std::ranges::any_of(analysis::get_scan_regions((uintptr_t)d3d12core, analysis::RegionKind::CODE), [&](const analysis::ScanRegion& r) {
+            return chain->target >= (uintptr_t)r.begin && chain->target < (uintptr_t)r.begin + r.size;
+        });
+
+        if (!in_core) {
+            SPDLOG_WARN("ID3D12Device::CopyDescriptors slot points outside of D3D12Core.dll (0x{:x})", chain->target);
+            return std::nullopt;
+        }
+
+        SPDLOG_INFO("CDevice::CopyDescriptors from the device vtable at 0x{:x} ({} stub(s) followed, this adjusted by {})",
+            chain->target, chain->hops, chain->this_adjustment);
+
+        m_scan_cache.set_address((uintptr_t)d3d12core, "CDevice::CopyDescriptors", chain->target);
+        return chain->target;
+    }
+
+    bool resolve_copy_descriptors() {
         const auto d3d12core = GetModuleHandleW(L"D3D12Core.dll");
         if (d3d12core == nullptr) {
             SPDLOG_ERROR("Failed to find D3D12Core.dll");
-            return;
+            return false;
         }
 
-        const auto fn = utility::scan(d3d12core, "48 89 5C 24 08 57 48 83 ec 40 48 8b d9 8b bc 24 88 00 00 00");
+        m_copy_descriptors_fn = resolve_copy_descriptors_from_device(d3d12core);
 
-        if (!fn) {
+        // Scan as a fallback when the device isn't up yet or has been wrapped by something
+        if (!m_copy_descriptors_fn) {
+            m_copy_descriptors_fn = resolve_cached(d3d12core, "CDevice::CopyDescriptors", [&]() -> std::optional<uintptr_t> {
+                static constexpr analysis::StaticPattern pattern{"48 89 5C 24 08 57 48 83 ec 40 48 8b d9 8b bc 24 88 00 00 00"};
+
+                const auto regions = analysis::get_scan_regions((uintptr_t)d3d12core, analysis::RegionKind::CODE);
+
+                // D3D12Core.dll gets updated with the Agility SDK/Windows, start where it was last time
+                if (const auto hint = m_scan_cache.get_hint("CDevice::CopyDescriptors")) {
+                    if (const auto match = analysis::find_near_hint((uintptr_t)d3d12core, regions, *hint, pattern.anchored())) {
+                        SPDLOG_INFO("[Hints] CDevice::CopyDescriptors found near its previous RVA 0x{:x} ({})", *hint, analysis::to_string(match->window));
+                        return match->address;
+                    }
+                }
+
+                const analysis::ScanMeter meter{};
+                size_t bytes_scanned = 0;
+                std::optional<uintptr_t> fn{};
+
+                for (const auto& region : regions) {
+                    bytes_scanned += region.size;
+
+                    if (fn = analysis::parallel_find_first(*m_game->get_work_pool(), region.begin, region.size, pattern.anchored()); fn) {
+                        break;
+                    }
+                }
+
+                const auto stats = meter.stop(bytes_scanned);
+                SPDLOG_INFO("Scanned {:.1f} MiB of D3D12Core.dll in {:.3f}ms, {} page fault(s)",
+                    stats.bytes_scanned / (1024.0 * 1024.0),
+                    std::chrono::duration<double, std::milli>(stats.elapsed).count(),
+                    stats.page_faults);
+
+                return fn;
+            });
+        }
+
+        if (!m_copy_descriptors_fn) {
             SPDLOG_ERROR("Failed to find CDevice::CopyDescriptors");
+            return false;
+        }
+
+        SPDLOG_INFO("CDevice::CopyDescriptors at 0x{:x}", *m_copy_descriptors_fn);
+
+        return true;
+    }
+
+    void hook_copy_descriptors() {
+        const auto fn = m_copy_descriptors_fn;
+
+        m_copy_descriptors_hook_id = install_hook("CDevice::CopyDescriptors", *fn, &copy_descriptors, m_copy_descriptors_gate);
+    }
+
+    using CDevice_CreateDescriptorHeapFn = HRESULT (*)(void* self, const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap);
+    analysis::HookGate<CDevice_CreateDescriptorHeapFn> m_create_descriptor_heap_gate{};
+    int m_create_descriptor_heap_hook_id{-1};
+
+    using CDescriptorHeap_ReleaseFn = ULONG (*)(void* self);
+    analysis::HookGate<CDescriptorHeap_ReleaseFn> m_descriptor_heap_release_gate{};
+    int m_descriptor_heap_release_hook_id{-1};
+
+    std::optional<analysis::JumpChain> m_create_descriptor_heap_fn{};
+    std::optional<analysis::JumpChain> m_descriptor_heap_release_fn{};
+
+    // Whether the heap's Release is the same function as a fence's, so every other device child goes through the hook too.
+    // Assumed to be unless proven otherwise.
+    bool m_descriptor_heap_release_shared{true};
+
+    // Set once initialize_hooks is done, cleared by the first engine tick that finds the device.
+    std::atomic<bool> m_descriptor_heap_tracking_pending{false};
+
+
+    // IUnknown (3) + ID3D12Object (4) + ID3D12Device::GetNodeCount, CreateCommandQueue..CreateRootSignature (7)
+    static constexpr uint32_t ID3D12DEVICE_CREATE_DESCRIPTOR_HEAP_INDEX = 14;
+    static constexpr uint32_t IUNKNOWN_RELEASE_INDEX = 2;
+
+    static HRESULT create_descriptor_heap(void* self, const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap) {
+        const auto& gate = g_plugin->m_create_descriptor_heap_gate;
+
+        const auto result = gate.call_original(self, pDescriptorHeapDesc, riid, ppvHeap);
+
+        if (!gate.is_live() || FAILED(result) || ppvHeap == nullptr || *ppvHeap == nullptr || pDescriptorHeapDesc == nullptr || riid != __uuidof(ID3D12DescriptorHeap)) {
+            return result;
+        }
+
+        if ((size_t)pDescriptorHeapDesc->Type >= s_descriptor_increments.size()) {
+            return result;
+        }
+
+        const auto heap = (ID3D12DescriptorHeap*)*ppvHeap;
+
+        analysis::DescriptorHeapRange range{};
+        range.base = heap->GetCPUDescriptorHandleForHeapStart().ptr;
+        range.count = pDescriptorHeapDesc->NumDescriptors;
+        range.increment = s_descriptor_increments[pDescriptorHeapDesc->Type].load(std::memory_order_relaxed);
+        range.type = (uint32_t)pDescriptorHeapDesc->Type;
+        range.heap = heap;
+
+        s_descriptor_heaps.add(range);
+
+        if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) {
+            trace->record_descriptor_heap_created(range);
+        }
+
+        return result;
+    }
+
+    // Probably shared with every other device child, so this has to stay cheap for anything that isn't a tracked heap.
+    static ULONG descriptor_heap_release(void* self) {
+        const auto& plugin = *g_plugin;
+        const auto& gate = plugin.m_descriptor_heap_release_gate;
+
+        // self is what the thunk in front of the target made of the heap pointer
+        const auto heap = (const void*)((uintptr_t)self - plugin.m_descriptor_heap_release_fn->this_adjustment);
+
+        // One load for every resource, fence or command list that was never a heap, without registering as an index reader
+        if (plugin.m_descriptor_heap_release_shared && !s_descriptor_heaps.may_be_tracked(heap)) {
+            return gate.call_original(self);
+        }
+
+        // Before the original, once the count hits zero another heap may show up at the same address any moment
+        const auto serial = s_descriptor_heaps.get_serial(heap);
+        const auto result = gate.call_original(self);
+
+        if (result == 0 && serial != 0) {
+            s_descriptor_heaps.remove(heap, serial);
+
+            if (const auto trace = s_trace.load(std::memory_order_acquire); trace != nullptr) {
+                trace->record_descriptor_heap_released(heap);
+            }
+        }
+
+        return result;
+    }
+
+    // On the game thread, every tick until UEVR has the device. Without tracking, CopyDescriptors only gets its
+    // null handles rejected, stale or out of bounds ranges go straight to the driver and coalescing never merges anything.
+    void start_descriptor_heap_tracking() {
+        const auto renderer = API::get()->param()->renderer;
+
+        if (renderer == nullptr || renderer->device == nullptr) {
             return;
         }
 
-        SPDLOG_INFO("CDevice::CopyDescriptors at 0x{:x}", *fn);
+        m_descriptor_heap_tracking_pending.store(false, std::memory_order_relaxed);
+
+        if (renderer->renderer_type != UEVR_RENDERER_D3D12) {
+            SPDLOG_WARN("Not running on D3D12, descriptor heap tracking is off: only null CopyDescriptors handles get rejected, and nothing gets coalesced");
+            return;
+        }
+
+        if (!resolve_descriptor_heap_tracking((ID3D12Device*)renderer->device)) {
+            SPDLOG_WARN("Descriptor heap tracking is off: only null CopyDescriptors handles get rejected, and nothing gets coalesced");
+            return;
+        }
+
+        hook_descriptor_heap_tracking();
+    }
+
+    // Both come from the device's and a throwaway heap's vtables, there's nothing to scan for.
+    // Has to happen before any of the hooks go in, or the probe heap would stay tracked forever.
+    bool resolve_descriptor_heap_tracking(ID3D12Device* device) {
+        for (size_t i = 0; i < s_descriptor_increments.size(); ++i) {
+            s_descriptor_increments[i].store(device->GetDescriptorHandleIncrementSize((D3D12_DESCRIPTOR_HEAP_TYPE)i), std::memory_order_relaxed);
+        }
+
+        m_create_descriptor_heap_fn = analysis::resolve_virtual(device, ID3D12DEVICE_CREATE_DESCRIPTOR_HEAP_INDEX);
+
+        D3D12_DESCRIPTOR_HEAP_DESC desc{};
+        desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        desc.NumDescriptors = 1;
+        desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 
-        m_copy_descriptors_hook_id = API::get()->param()->functions->register_inline_hook((void*)*fn, &copy_descriptors, (void**)&m_orig_copy_descriptors);
+        if (ID3D12DescriptorHeap* probe{}; SUCCEEDED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&probe)))) {
+            m_descriptor_heap_release_fn = analysis::resolve_virtual(probe, IUNKNOWN_RELEASE_INDEX);
+            probe->Release();
+        }
+
+        if (!m_create_descriptor_heap_fn || !m_descriptor_heap_release_fn) {
+            SPDLOG_ERROR("Failed to resolve CDevice::CreateDescriptorHeap or CDescriptorHeap::Release");
+            return false;
+        }
+
+        if (ID3D12Fence* fence{}; SUCCEEDED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+            const auto fence_release = analysis::resolve_virtual(fence, IUNKNOWN_RELEASE_INDEX);
+            m_descriptor_heap_release_shared = !fence_release || fence_release->target == m_descriptor_heap_release_fn->target;
+            fence->Release();
+        }
+
+        SPDLOG_INFO("CDevice::CreateDescriptorHeap at 0x{:x}, CDescriptorHeap::Release at 0x{:x} (this adjusted by {}, {})",
+            m_create_descriptor_heap_fn->target, m_descriptor_heap_release_fn->target, m_descriptor_heap_release_fn->this_adjustment,
+            m_descriptor_heap_release_shared ? "shared with other device children" : "heaps only");
+
+        return true;
+    }
+
+    // Release first, so nothing gets tracked that we wouldn't see going away.
+    void hook_descriptor_heap_tracking() {
+        m_descriptor_heap_release_hook_id = install_hook("CDescriptorHeap::Release", m_descriptor_heap_release_fn->target, &descriptor_heap_release, m_descriptor_heap_release_gate);
+
+        if (m_descriptor_heap_release_hook_id < 0) {
+            return;
+        }
 
-        SPDLOG_INFO("CDevice::CopyDescriptors hooked!");
+        m_create_descriptor_heap_hook_id = install_hook("CDevice::CreateDescriptorHeap", m_create_descriptor_heap_fn->target, &create_descriptor_heap, m_create_descriptor_heap_gate);
     }
 };
 
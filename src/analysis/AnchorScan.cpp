@@ -0,0 +1,68 @@
+#include <cstring>
+
+#include "AnchorScan.hpp"
+
+namespace analysis {
+namespace detail {
+// Calls cb for every verified match until it returns false.
+template <typename T>
+void scan_anchored(const uint8_t* begin, size_t size, const AnchoredPattern& pattern, T&& cb) {
+    if (pattern.size == 0 || size < pattern.size) {
+        return;
+    }
+
+    const auto last = begin + (size - pattern.size);
+
+    // Only wildcards, every position is a match
+    if (pattern.anchor >= pattern.size) {
+        for (auto p = begin; p <= last; ++p) {
+            if (!cb(p)) {
+                return;
+            }
+        }
+
+        return;
+    }
+
+    const auto needle = pattern.bytes[pattern.anchor];
+
+    // The anchor is only interesting where the whole pattern still fits around it
+    auto p = begin + pattern.anchor;
+    const auto end = last + pattern.anchor + 1;
+
+    while (p < end) {
+        p = (const uint8_t*)std::memchr(p, needle, (size_t)(end - p));
+
+        if (p == nullptr) {
+            return;
+        }
+
+        const auto candidate = p - pattern.anchor;
+
+        if (pattern.matches(candidate) && !cb(candidate)) {
+            return;
+        }
+
+        ++p;
+    }
+}
+}
+
+std::optional<uintptr_t> find_first(const uint8_t* begin, size_t size, const AnchoredPattern& pattern) {
+    std::optional<uintptr_t> result{};
+
+    detail::scan_anchored(begin, size, pattern, [&](const uint8_t* p) {
+        result = (uintptr_t)p;
+        return false;
+    });
+
+    return result;
+}
+
+void find_all(const uint8_t* begin, size_t size, const AnchoredPattern& pattern, std::vector<uintptr_t>& out) {
+    detail::scan_anchored(begin, size, pattern, [&](const uint8_t* p) {
+        out.push_back((uintptr_t)p);
+        return true;
+    });
+}
+}
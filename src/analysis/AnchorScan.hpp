@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace analysis {
+// Non-owning view of a pattern plus the index of the byte to search for first.
+// With a rare anchor byte most of the memory gets skipped by memchr and only a handful of
+// candidates ever get compared against the whole pattern.
+struct AnchoredPattern {
+    const uint8_t* bytes{};
+    const uint8_t* mask{};
+    size_t size{};
+    size_t anchor{}; // == size if there are no fixed bytes
+
+    bool matches(const uint8_t* p) const {
+        for (size_t i = 0; i < size; ++i) {
+            if ((p[i] & mask[i]) != bytes[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+std::optional<uintptr_t> find_first(const uint8_t* begin, size_t size, const AnchoredPattern& pattern);
+void find_all(const uint8_t* begin, size_t size, const AnchoredPattern& pattern, std::vector<uintptr_t>& out);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace analysis {
+// How often each byte value shows up in x64 code, in occurrences per 100k bytes (never 0).
+// Measured over the .text of a few large optimized x64 binaries, with 0xCC raised to the level of 0x90
+// because MSVC pads between functions with int3 where other compilers use nops.
+inline constexpr std::array<uint16_t, 256> X64_BYTE_FREQUENCY{
+    11863,  2078,   625,   366,   718,   415,   196,   224,  1175,   118,   100,    86,   159,   164,   112,  3170, // 0_
+      879,   262,    88,    87,   141,   129,    74,    73,   476,    91,    68,    66,    89,    85,    57,   727, // 1_
+      547,    78,    55,    56,  2857,   132,    52,    54,   349,   303,    64,    96,    83,    84,   153,    56, // 2_
+      386,   536,    49,    62,   113,   170,    59,    54,   254,   702,    65,   135,   238,   263,    68,    94, // 3_
+      671,  1211,   111,   270,  1206,   443,   125,   167,  7629,   986,    75,    83,  1743,   388,    66,    75, // 4_
+      352,    66,    71,   228,   343,   289,   130,   123,   205,    61,    56,   245,   261,   308,   128,   118, // 5_
+      252,    44,    47,   103,   145,    65,   788,    56,   202,    55,    75,    81,   174,    80,   114,   171, // 6_
+      435,    56,    81,   122,   893,   464,   120,    88,   182,    64,    63,   145,   351,   155,    98,   191, // 7_
+      472,   189,    83,  1205,  1656,  1585,    95,   111,   203,  3989,    49,  3433,   100,  1238,    68,    74, // 8_
+      410,    52,    80,    63,   144,   100,    69,    54,   123,   187,    52,    60,    92,    92,    56,    47, // 9_
+      152,    45,    45,    60,    73,    58,    78,    50,   111,    55,    72,    55,   111,    57,    48,    80, // A_
+      146,    48,    46,    56,   113,    97,   215,   252,   278,   149,   278,    88,   217,   180,   346,   312, // B_
+     1052,   299,   201,   498,   251,   216,   406,   683,   164,   147,    86,    62,   410,    75,    86,   101, // C_
+      273,   104,   259,   120,    88,    93,    93,    83,   169,    76,   109,   141,    71,    88,   145,   318, // D_
+      241,    94,   146,    80,   124,    87,   145,   200,  2104,   877,   147,   252,   189,   177,   190,   339, // E_
+      236,   103,   138,   178,   106,   120,   361,   235,   342,   170,   251,   231,   246,   354,   571,  6376, // F_
+};
+
+// Index of the fixed byte least likely to show up in code, or size if every byte is a wildcard.
+// Ties go to the earlier byte. Works on std::array (at compile time) as well as std::vector.
+template <typename Bytes, typename Mask>
+constexpr size_t find_rarest_fixed_byte(const Bytes& bytes, const Mask& mask, size_t size) {
+    size_t best = size;
+
+    for (size_t i = 0; i < size; ++i) {
+        if (mask[i] != 0xFF) {
+            continue;
+        }
+
+        if (best == size || X64_BYTE_FREQUENCY[bytes[i]] < X64_BYTE_FREQUENCY[bytes[best]]) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+}
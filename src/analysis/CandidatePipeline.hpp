@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WorkPool.hpp"
+
+namespace analysis {
+// Runs a list of candidates through a chain of filters, spread across a WorkPool.
+// A stage fills in whatever it finds on the candidate and returns false to drop it.
+//
+// The result is the first candidate (in input order) that passes every stage, same as a sequential loop.
+// Once one has, candidates after it are abandoned as soon as a worker notices, including ones mid-way through.
+template <typename T>
+class CandidatePipeline {
+public:
+    using Filter = std::function<bool(T&)>;
+
+    struct StageStats {
+        std::string name{};
+        size_t passed{};
+    };
+
+    struct Stats {
+        size_t candidates{};
+        size_t cancelled{};
+        std::vector<StageStats> stages{};
+        std::chrono::nanoseconds elapsed{};
+    };
+
+    void add_stage(std::string_view name, Filter filter) {
+        m_stages.push_back(Stage{std::string{name}, std::move(filter)});
+    }
+
+    // nullptr runs the candidates one after another on the calling thread.
+    std::optional<T> run(std::vector<T> candidates, WorkPool* pool = nullptr) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto num_stages = m_stages.size();
+
+        const auto passed = std::make_unique<std::atomic<size_t>[]>(num_stages);
+        std::atomic<size_t> cancelled{0};
+        std::atomic<size_t> winner{SIZE_MAX};
+
+        const auto evaluate = [&](size_t i) {
+            bool ok = true;
+
+            for (size_t s = 0; s < num_stages && ok; ++s) {
+                if (i > winner.load()) {
+                    ++cancelled;
+                    ok = false;
+                    break;
+                }
+
+                ok = m_stages[s].filter(candidates[i]);
+
+                if (ok) {
+                    ++passed[s];
+                }
+            }
+
+            // Keep the earliest candidate if several make it through
+            for (auto current = winner.load(); ok && i < current && !winner.compare_exchange_weak(current, i);) {
+            }
+        };
+
+        if (pool != nullptr) {
+            pool->parallel_for(candidates.size(), evaluate);
+        } else {
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                evaluate(i);
+            }
+        }
+
+        m_stats = Stats{};
+        m_stats.candidates = candidates.size();
+        m_stats.cancelled = cancelled;
+
+        for (size_t s = 0; s < num_stages; ++s) {
+            m_stats.stages.push_back(StageStats{m_stages[s].name, passed[s]});
+        }
+
+        m_stats.elapsed = std::chrono::steady_clock::now() - start;
+
+        if (winner == SIZE_MAX) {
+            return std::nullopt;
+        }
+
+        return std::move(candidates[winner]);
+    }
+
+    const Stats& get_stats() const {
+        return m_stats;
+    }
+
+    // e.g. "12 candidates -> unwind 10 -> jmp 3 -> vtable 1, 7 cancelled"
+    std::string describe() const {
+        auto result = std::to_string(m_stats.candidates) + " candidates";
+
+        for (const auto& stage : m_stats.stages) {
+            result += " -> " + stage.name + " " + std::to_string(stage.passed);
+        }
+
+        return result + ", " + std::to_string(m_stats.cancelled) + " cancelled";
+    }
+
+private:
+    struct Stage {
+        std::string name{};
+        Filter filter{};
+    };
+
+    std::vector<Stage> m_stages{};
+    Stats m_stats{};
+};
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DescriptorHeapIndex.hpp"
+#include "NullHandleScan.hpp"
+
+namespace analysis {
+enum class CopyDescriptorsVerdict : uint8_t {
+    FORWARD,        // goes through to the driver
+    NULL_HANDLE,    // null source handle, what the game's race ends up passing
+    INVALID_RANGE,  // see DescriptorHeapIndex::check_copy
+};
+
+inline const char* to_string(CopyDescriptorsVerdict verdict) {
+    switch (verdict) {
+    case CopyDescriptorsVerdict::FORWARD:
+        return "forward";
+    case CopyDescriptorsVerdict::NULL_HANDLE:
+        return "null handle";
+    case CopyDescriptorsVerdict::INVALID_RANGE:
+        return "invalid range";
+    default:
+        return "?";
+    }
+}
+
+struct CopyDescriptorsDecision {
+    CopyDescriptorsVerdict verdict{CopyDescriptorsVerdict::FORWARD};
+    size_t null_index{};                    // NULL_HANDLE only
+    DescriptorHeapIndex::CopyCheck check{}; // INVALID_RANGE only
+};
+
+// Everything a CopyDescriptors call gets checked for before it may reach the driver. Shared by the plugin's detour
+// and trace_replay, so recorded calls get replayed through exactly the same filters. Runs thousands of times per frame.
+inline CopyDescriptorsDecision filter_copy_descriptors(simd::FindNullHandleFn find_null, const DescriptorHeapIndex& heaps,
+    uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t type)
+{
+    // The null descriptor filter doesn't depend on anything being resolved, so it applies whether the hook is live or not.
+    if (src_starts != nullptr && num_src > 0) {
+        const auto i = num_src < 4 ? simd::find_null_handle_short(src_starts, num_src) : find_null(src_starts, num_src);
+
+        if (i != num_src) [[unlikely]] {
+            return {CopyDescriptorsVerdict::NULL_HANDLE, i};
+        }
+    }
+
+    // Stale (destroyed heap), out of bounds or recently faulting ranges. Handles in heaps that were created
+    // before the tracking hooks went in aren't known, those only have the null check.
+    if (const auto check = heaps.check_copy(num_dest, dest_starts, dest_sizes, num_src, src_starts, src_sizes, type);
+        check.result != DescriptorCheck::OK) [[unlikely]]
+    {
+        return {CopyDescriptorsVerdict::INVALID_RANGE, 0, check};
+    }
+
+    return {};
+}
+}
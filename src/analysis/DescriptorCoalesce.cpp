@@ -0,0 +1,63 @@
+#include "DescriptorCoalesce.hpp"
+
+namespace analysis {
+bool coalesce_descriptor_ranges(uint32_t num, const uint64_t* starts, const uint32_t* sizes, uint32_t increment, CoalescedRanges& out) {
+    out.count = 0;
+
+    if (num == 0) {
+        return true;
+    }
+
+    if (starts == nullptr || increment == 0 || out.capacity == 0) {
+        return false;
+    }
+
+    uint64_t start = starts[0];
+    uint64_t size = sizes != nullptr ? sizes[0] : 1;
+
+    for (uint32_t i = 1; i < num; ++i) {
+        const uint64_t next_size = sizes != nullptr ? sizes[i] : 1;
+
+        // Empty ranges copy nothing, they can go wherever
+        if (next_size == 0) {
+            continue;
+        }
+
+        if (size == 0 || (starts[i] == start + size * increment && size + next_size <= UINT32_MAX)) {
+            start = size == 0 ? starts[i] : start;
+            size += next_size;
+            continue;
+        }
+
+        if (out.count == out.capacity) {
+            return false;
+        }
+
+        out.starts[out.count] = start;
+        out.sizes[out.count] = (uint32_t)size;
+        ++out.count;
+
+        start = starts[i];
+        size = next_size;
+    }
+
+    if (out.count == out.capacity) {
+        return false;
+    }
+
+    out.starts[out.count] = start;
+    out.sizes[out.count] = (uint32_t)size;
+    ++out.count;
+
+    return true;
+}
+
+bool coalesce_copy_descriptors(uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t increment, CoalescedRanges& dest, CoalescedRanges& src)
+{
+    return increment != 0 && (num_dest > 1 || num_src > 1) &&
+        coalesce_descriptor_ranges(num_dest, dest_starts, dest_sizes, increment, dest) &&
+        coalesce_descriptor_ranges(num_src, src_starts, src_sizes, increment, src) &&
+        (dest.count < num_dest || src.count < num_src);
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace analysis {
+// Descriptor ranges of one side of a CopyDescriptors call, merged where a range starts exactly where the previous one ended.
+// CopyDescriptors treats both sides as one flat stream of descriptors (start + i * increment), so merging each side on its
+// own touches exactly the same slots in the same order, just in fewer and longer ranges.
+struct CoalescedRanges {
+    uint64_t* starts{};
+    uint32_t* sizes{};
+    uint32_t capacity{};
+    uint32_t count{};
+};
+
+// Null sizes mean one descriptor per range, like in CopyDescriptors. Returns false if the merged ranges don't fit
+// into out's capacity (out is left in an unspecified state then), which can only happen when nothing much merges.
+bool coalesce_descriptor_ranges(uint32_t num, const uint64_t* starts, const uint32_t* sizes, uint32_t increment, CoalescedRanges& out);
+
+// Both sides of a CopyDescriptors call. Only true if merging leaves fewer ranges on at least one of them,
+// which is when dest and src get forwarded instead of the original ranges. An increment of 0 (not resolved yet) never merges.
+bool coalesce_copy_descriptors(uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t increment, CoalescedRanges& dest, CoalescedRanges& src);
+}
@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <bit>
+
+#include "DescriptorHeapIndex.hpp"
+
+namespace analysis {
+const char* to_string(DescriptorCheck check) {
+    switch (check) {
+    case DescriptorCheck::OK:
+        return "ok";
+    case DescriptorCheck::UNKNOWN:
+        return "unknown";
+    case DescriptorCheck::STALE:
+        return "stale";
+    case DescriptorCheck::OUT_OF_BOUNDS:
+        return "out of bounds";
+    case DescriptorCheck::MISALIGNED:
+        return "misaligned";
+    case DescriptorCheck::WRONG_TYPE:
+        return "wrong type";
+    case DescriptorCheck::FAULTED:
+        return "faulted";
+    default:
+        return "?";
+    }
+}
+
+namespace {
+// Threads get their reader slot round robin the first time they look something up
+size_t get_reader_slot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % DescriptorHeapIndex::READER_SLOTS;
+
+    return slot;
+}
+}
+
+// Registers before loading the snapshot, everything seq_cst to pair with publish storing the new snapshot before
+// reclaim() reads the counters. The epoch read here can be out of date by the time the counter goes up,
+// which is why a snapshot has to wait for both parities to drain (see reclaim).
+class DescriptorHeapIndex::ReadGuard {
+public:
+    explicit ReadGuard(const DescriptorHeapIndex& index)
+        : m_count{index.m_readers[get_reader_slot()].count[index.m_epoch.load(std::memory_order_seq_cst) & 1]}
+    {
+        m_count.fetch_add(1, std::memory_order_seq_cst);
+        m_snapshot = index.m_current.load(std::memory_order_seq_cst);
+    }
+
+    ~ReadGuard() {
+        m_count.fetch_sub(1, std::memory_order_release);
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    const Snapshot& operator*() const {
+        return *m_snapshot;
+    }
+
+    const Snapshot* operator->() const {
+        return m_snapshot;
+    }
+
+private:
+    std::atomic<uint32_t>& m_count;
+    const Snapshot* m_snapshot{};
+};
+
+DescriptorHeapIndex::DescriptorHeapIndex() {
+    publish(std::make_unique<Snapshot>());
+}
+
+// Nothing can be looking anything up anymore at this point, every snapshot can go.
+DescriptorHeapIndex::~DescriptorHeapIndex() = default;
+
+uint64_t DescriptorHeapIndex::add(DescriptorHeapRange range) {
+    if (range.count == 0 || range.increment == 0) {
+        return 0;
+    }
+
+    range.live = true;
+
+    std::scoped_lock _{m_write_mutex};
+
+    range.serial = m_next_serial++;
+
+    // A new heap means new descriptors, whatever faulted at these addresses before doesn't say anything about them
+    for (auto& fault : m_faults) {
+        auto handle = fault.handle.load(std::memory_order_relaxed);
+
+        if (handle >= range.base && handle < range.end()) {
+            fault.handle.compare_exchange_strong(handle, 0, std::memory_order_relaxed);
+        }
+    }
+
+    auto next = std::make_unique<Snapshot>();
+    next->ranges.reserve(m_owned->ranges.size() + 1);
+
+    for (const auto& r : m_owned->ranges) {
+        if (r.end() <= range.base || r.base >= range.end()) {
+            next->ranges.push_back(r);
+
+            // Same object somewhere else, it must have been destroyed without us seeing it
+            if (auto& kept = next->ranges.back(); kept.live && kept.heap != nullptr && kept.heap == range.heap) {
+                kept.live = false;
+                kept.heap = nullptr;
+            }
+        }
+    }
+
+    next->ranges.insert(std::upper_bound(next->ranges.begin(), next->ranges.end(), range.base, [](uint64_t base, const DescriptorHeapRange& r) {
+        return base < r.base;
+    }), range);
+
+    publish(std::move(next));
+    return range.serial;
+}
+
+size_t DescriptorHeapIndex::find_heap(const Snapshot& snapshot, const void* heap) {
+    if (heap == nullptr || snapshot.heaps.empty()) {
+        return snapshot.ranges.size();
+    }
+
+    const auto mask = snapshot.heaps.size() - 1;
+
+    // Never more than half full, there's always an empty slot to stop at
+    for (auto slot = get_heap_slot(heap, mask); snapshot.heaps[slot] != 0; slot = (slot + 1) & mask) {
+        if (const auto i = snapshot.heaps[slot] - 1; snapshot.ranges[i].heap == heap) {
+            return i;
+        }
+    }
+
+    return snapshot.ranges.size();
+}
+
+uint64_t DescriptorHeapIndex::get_serial(const void* heap) const {
+    const ReadGuard snapshot{*this};
+    const auto i = find_heap(*snapshot, heap);
+
+    return i < snapshot->ranges.size() ? snapshot->ranges[i].serial : 0;
+}
+
+bool DescriptorHeapIndex::remove(const void* heap, uint64_t serial) {
+    const auto matches = [&](const DescriptorHeapRange& r) {
+        return r.live && r.heap == heap && (serial == 0 || r.serial == serial);
+    };
+
+    // Cheap checks first, most calls are for objects that aren't descriptor heaps at all
+    if (!may_be_tracked(heap)) {
+        return false;
+    }
+
+    if (const ReadGuard current{*this}; find_heap(*current, heap) == current->ranges.size()) {
+        return false;
+    }
+
+    std::scoped_lock _{m_write_mutex};
+
+    auto next = std::make_unique<Snapshot>(*m_owned);
+    bool found = false;
+
+    for (auto& r : next->ranges) {
+        if (matches(r)) {
+            r.live = false;
+            r.heap = nullptr;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    // Forget the oldest stale ranges if there are too many. Order of destruction isn't tracked,
+    // so the ones with the lowest addresses have to do.
+    auto dead = (size_t)std::count_if(next->ranges.begin(), next->ranges.end(), [](const DescriptorHeapRange& r) { return !r.live; });
+
+    if (dead > MAX_DEAD_RANGES) {
+        std::erase_if(next->ranges, [&](const DescriptorHeapRange& r) {
+            return !r.live && dead-- > MAX_DEAD_RANGES;
+        });
+    }
+
+    publish(std::move(next));
+    return true;
+}
+
+void DescriptorHeapIndex::publish(std::unique_ptr<Snapshot> snapshot) {
+    snapshot->bases.resize(snapshot->ranges.size());
+    std::transform(snapshot->ranges.begin(), snapshot->ranges.end(), snapshot->bases.begin(), [](const DescriptorHeapRange& r) { return r.base; });
+
+    const auto live = (size_t)std::count_if(snapshot->ranges.begin(), snapshot->ranges.end(), [](const DescriptorHeapRange& r) { return r.live && r.heap != nullptr; });
+    snapshot->heaps.assign(std::bit_ceil(std::max<size_t>(live * 2, 8)), 0);
+
+    const auto mask = snapshot->heaps.size() - 1;
+    std::array<uint64_t, HEAP_FILTER_BITS / 64> filter{};
+
+    for (size_t i = 0; i < snapshot->ranges.size(); ++i) {
+        if (const auto& r = snapshot->ranges[i]; r.live && r.heap != nullptr) {
+            auto slot = get_heap_slot(r.heap, mask);
+
+            while (snapshot->heaps[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+
+            snapshot->heaps[slot] = (uint32_t)i + 1;
+
+            const auto bit = get_heap_filter_bit(r.heap);
+            filter[bit / 64] |= 1ull << (bit % 64);
+        }
+    }
+
+    for (size_t i = 0; i < filter.size(); ++i) {
+        m_heap_filter[i].store(filter[i], std::memory_order_relaxed);
+    }
+
+    m_current.store(snapshot.get(), std::memory_order_seq_cst);
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_owned != nullptr) {
+        m_owned->retired = m_epoch.load(std::memory_order_relaxed);
+        m_retired.push_back(std::move(m_owned));
+    }
+
+    m_owned = std::move(snapshot);
+    reclaim();
+}
+
+void DescriptorHeapIndex::reclaim() {
+    // New readers only register under the current parity, so the other one is just stragglers and drains quickly.
+    // Counters are read one at a time, that's enough: a straggler has been registered since before the epoch
+    // moved on, so its counter can't read zero anywhere in between.
+    const auto drained = [&](uint64_t parity) {
+        return std::all_of(m_readers.begin(), m_readers.end(), [&](const ReaderSlot& reader) {
+            return reader.count[parity].load(std::memory_order_seq_cst) == 0;
+        });
+    };
+
+    for (size_t i = 0; i < 3 && !m_retired.empty(); ++i) {
+        const auto epoch = m_epoch.load(std::memory_order_relaxed);
+
+        if (!drained((epoch & 1) ^ 1)) {
+            break;
+        }
+
+        m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+    }
+
+    // A reader holding a snapshot replaced in epoch e registered before that, under e's parity or, if it read the
+    // epoch just before e started, under e - 1's. The drains that let e + 2 and e + 3 start cover both.
+    const auto epoch = m_epoch.load(std::memory_order_relaxed);
+
+    std::erase_if(m_retired, [&](const std::unique_ptr<Snapshot>& s) {
+        return s->retired + 3 <= epoch;
+    });
+}
+
+DescriptorCheck DescriptorHeapIndex::check(uint64_t handle, uint32_t count, uint32_t type) const {
+    const ReadGuard snapshot{*this};
+    return check(*snapshot, handle, count, type);
+}
+
+DescriptorCheck DescriptorHeapIndex::check(const Snapshot& snapshot, uint64_t handle, uint32_t count, uint32_t type) const {
+    if (has_faulted(handle)) {
+        return DescriptorCheck::FAULTED;
+    }
+
+    const auto& bases = snapshot.bases;
+
+    // Last range starting at or below handle
+    const auto it = std::upper_bound(bases.begin(), bases.end(), handle);
+
+    if (it == bases.begin()) {
+        return DescriptorCheck::UNKNOWN;
+    }
+
+    const auto& r = snapshot.ranges[(size_t)(it - bases.begin()) - 1];
+
+    if (handle >= r.end()) {
+        return DescriptorCheck::UNKNOWN;
+    }
+
+    if (!r.live) {
+        return DescriptorCheck::STALE;
+    }
+
+    if (r.type != type) {
+        return DescriptorCheck::WRONG_TYPE;
+    }
+
+    if ((handle - r.base) % r.increment != 0) {
+        return DescriptorCheck::MISALIGNED;
+    }
+
+    if ((handle - r.base) / r.increment + count > r.count) {
+        return DescriptorCheck::OUT_OF_BOUNDS;
+    }
+
+    return DescriptorCheck::OK;
+}
+
+DescriptorHeapIndex::CopyCheck DescriptorHeapIndex::check_copy(uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t type) const
+{
+    const auto check_side = [&](uint32_t num, const uint64_t* starts, const uint32_t* sizes, bool source) -> CopyCheck {
+        if (starts == nullptr) {
+            return {};
+        }
+
+        for (uint32_t first = 0; first < num; first += COPY_BATCH) {
+            const auto batch = std::min(num - first, COPY_BATCH);
+            uint64_t batch_starts[COPY_BATCH];
+            uint32_t batch_sizes[COPY_BATCH];
+
+            for (uint32_t i = 0; i < batch; ++i) {
+                batch_starts[i] = starts[first + i];
+                batch_sizes[i] = sizes != nullptr ? sizes[first + i] : 1;
+            }
+
+            const ReadGuard snapshot{*this};
+
+            for (uint32_t i = 0; i < batch; ++i) {
+                const auto result = check(*snapshot, batch_starts[i], batch_sizes[i], type);
+
+                if (result != DescriptorCheck::OK && result != DescriptorCheck::UNKNOWN) {
+                    return {result, source, first + i};
+                }
+            }
+        }
+
+        return {};
+    };
+
+    // The sources are where the stale handles show up
+    if (const auto result = check_side(num_src, src_starts, src_sizes, true); result.result != DescriptorCheck::OK) {
+        return result;
+    }
+
+    return check_side(num_dest, dest_starts, dest_sizes, false);
+}
+
+void DescriptorHeapIndex::remember_fault(uint64_t handle, std::chrono::steady_clock::time_point now) {
+    if (handle == 0) {
+        return;
+    }
+
+    auto& fault = m_faults[get_fault_slot(handle)];
+    fault.time.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+    fault.handle.store(handle, std::memory_order_release);
+}
+
+bool DescriptorHeapIndex::has_faulted(uint64_t handle) const {
+    // Almost never in the cache, the clock only gets read if it is
+    if (m_faults[get_fault_slot(handle)].handle.load(std::memory_order_relaxed) != handle || handle == 0) [[likely]] {
+        return false;
+    }
+
+    return has_faulted(handle, std::chrono::steady_clock::now());
+}
+
+bool DescriptorHeapIndex::has_faulted(uint64_t handle, std::chrono::steady_clock::time_point now) const {
+    const auto& fault = m_faults[get_fault_slot(handle)];
+
+    if (fault.handle.load(std::memory_order_acquire) != handle || handle == 0) {
+        return false;
+    }
+
+    const std::chrono::steady_clock::time_point time{std::chrono::steady_clock::duration{fault.time.load(std::memory_order_relaxed)}};
+    return now - time < FAULT_LIFETIME;
+}
+
+size_t DescriptorHeapIndex::get_heap_count() const {
+    const ReadGuard snapshot{*this};
+    const auto& ranges = snapshot->ranges;
+
+    return (size_t)std::count_if(ranges.begin(), ranges.end(), [](const DescriptorHeapRange& r) { return r.live; });
+}
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace analysis {
+// CPU side of one descriptor heap, as seen when it was created.
+struct DescriptorHeapRange {
+    uint64_t base{};        // GetCPUDescriptorHandleForHeapStart
+    uint32_t count{};       // NumDescriptors
+    uint32_t increment{};   // GetDescriptorHandleIncrementSize for its type
+    uint32_t type{};        // D3D12_DESCRIPTOR_HEAP_TYPE
+    bool live{true};        // false once the heap got destroyed, kept around to recognize stale handles
+    const void* heap{};     // the ID3D12DescriptorHeap, only used to find it again on destruction
+    uint64_t serial{};      // assigned by add, tells apart heaps that got created at the same address
+
+    uint64_t end() const {
+        return base + (uint64_t)count * increment;
+    }
+};
+
+enum class DescriptorCheck : uint8_t {
+    OK,
+    UNKNOWN,        // not in any heap we know of, which includes every heap created before we started tracking
+    STALE,          // inside a heap that has been destroyed since
+    OUT_OF_BOUNDS,  // starts in a live heap, but runs past its end
+    MISALIGNED,     // not on a descriptor boundary
+    WRONG_TYPE,     // heap type doesn't match the copy's DescriptorHeapsType
+    FAULTED,        // recently made the driver fault
+};
+
+const char* to_string(DescriptorCheck check);
+
+// Live descriptor heaps by CPU address, for validating CopyDescriptors ranges before they reach the driver.
+// Lookups are lock free and O(log heaps): readers binary search an immutable sorted snapshot.
+// Creating or destroying a heap builds a new snapshot and swaps it in (RCU style). Readers register in one of
+// READER_SLOTS counters for the current epoch's parity while they hold a snapshot. Swaps move the epoch on whenever
+// the other parity has drained, and a replaced snapshot gets freed once both have drained since. Writers never wait
+// for readers, replaced snapshots just stay around until a later swap.
+// Heaps we never saw being created are unknown rather than invalid, so they pass.
+class DescriptorHeapIndex {
+public:
+    static constexpr size_t READER_SLOTS = 16;
+    static constexpr size_t MAX_DEAD_RANGES = 256;
+    static constexpr size_t FAULT_CACHE_SIZE = 64;
+    static constexpr size_t HEAP_FILTER_BITS = 4096;
+    static constexpr std::chrono::seconds FAULT_LIFETIME{5};
+
+    struct CopyCheck {
+        DescriptorCheck result{DescriptorCheck::OK};
+        bool source{};      // which side failed
+        uint32_t index{};   // range index on that side
+    };
+
+    DescriptorHeapIndex();
+    ~DescriptorHeapIndex();
+
+    DescriptorHeapIndex(const DescriptorHeapIndex&) = delete;
+    DescriptorHeapIndex& operator=(const DescriptorHeapIndex&) = delete;
+
+    // Replaces anything the range overlaps, a live heap there would mean we missed its destruction.
+    // Faulted handles inside it are forgotten. Returns the serial it was given.
+    uint64_t add(DescriptorHeapRange range);
+
+    // Serial of the live heap, 0 if it isn't tracked. Lock free and O(1), for checking before the object can go away.
+    uint64_t get_serial(const void* heap) const;
+
+    // False if the heap definitely isn't tracked, true if it may be. A single relaxed load without registering as a reader,
+    // for filtering out calls that are mostly about other objects. A heap's bit is set before add() returns, so anyone
+    // who got the pointer from the creating thread sees it.
+    bool may_be_tracked(const void* heap) const {
+        const auto bit = get_heap_filter_bit(heap);
+        return (m_heap_filter[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+    }
+
+    // Marks the heap's range as stale, only if it still has the given serial (0 = any). Returns false if it wasn't tracked,
+    // which is the common case when this is called for every final Release of any device child.
+    bool remove(const void* heap, uint64_t serial = 0);
+
+    // Whether [handle, handle + count descriptors) lies within one live heap of the given type.
+    DescriptorCheck check(uint64_t handle, uint32_t count, uint32_t type) const;
+
+    // Every destination and source range of a CopyDescriptors call, sources first. Null sizes mean one descriptor per range.
+    CopyCheck check_copy(uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+        uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t type) const;
+
+    // Handles passed to a call that faulted get rejected for FAULT_LIFETIME, unless something else hashes into their slot first.
+    void remember_fault(uint64_t handle, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    bool has_faulted(uint64_t handle) const;
+
+    // Only reads the clock for a handle that's in the cache at all.
+    bool has_faulted(uint64_t handle, std::chrono::steady_clock::time_point now) const;
+
+    // Live heaps only.
+    size_t get_heap_count() const;
+
+    // Snapshots swapped in so far, for benchmarks.
+    size_t get_generation() const {
+        return m_generation.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Snapshot {
+        std::vector<DescriptorHeapRange> ranges{}; // sorted by base, non-overlapping
+        std::vector<uint64_t> bases{};              // ranges[i].base, what lookups binary search
+        std::vector<uint32_t> heaps{};              // index + 1 into ranges of every live heap by heap pointer, open addressed, 0 = empty
+        uint64_t retired{};                         // m_epoch when it got replaced
+    };
+
+    // Holds the current snapshot, registered in the calling thread's reader slot.
+    class ReadGuard;
+
+    // Ranges check_copy reads out of the caller's arrays at a time. Those can fault, so they're copied
+    // before registering as a reader, a fault must never leave a reader slot counted.
+    static constexpr uint32_t COPY_BATCH = 32;
+
+    void publish(std::unique_ptr<Snapshot> snapshot);
+
+    // Moves the epoch on as far as readers allow, then frees the retired snapshots no reader can still be holding.
+    void reclaim();
+
+    DescriptorCheck check(const Snapshot& snapshot, uint64_t handle, uint32_t count, uint32_t type) const;
+
+    // Index into ranges of the live heap, ranges.size() if there's none. Release gets called for every device child,
+    // so this mustn't depend on the number of heaps.
+    static size_t find_heap(const Snapshot& snapshot, const void* heap);
+
+    static size_t get_heap_slot(const void* heap, size_t mask) {
+        return (size_t)(((uint64_t)(uintptr_t)heap * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+
+    static size_t get_heap_filter_bit(const void* heap) {
+        static_assert(HEAP_FILTER_BITS == 1 << 12);
+        return (size_t)(((uint64_t)(uintptr_t)heap * 0x9E3779B97F4A7C15ull) >> 52);
+    }
+
+    static size_t get_fault_slot(uint64_t handle) {
+        return (size_t)((handle * 0x9E3779B97F4A7C15ull) >> 58) % FAULT_CACHE_SIZE;
+    }
+
+    std::atomic<const Snapshot*> m_current{nullptr};
+    std::atomic<size_t> m_generation{0};
+
+    // Writers only
+    std::mutex m_write_mutex{};
+    std::unique_ptr<Snapshot> m_owned{};
+    uint64_t m_next_serial{1};
+    std::vector<std::unique_ptr<Snapshot>> m_retired{};
+
+    // Readers in flight by epoch parity, spread over cache lines so threads looking things up at once don't share one
+    struct alignas(64) ReaderSlot {
+        std::array<std::atomic<uint32_t>, 2> count{};
+    };
+
+    std::atomic<uint64_t> m_epoch{0};
+    mutable std::array<ReaderSlot, READER_SLOTS> m_readers{};
+
+    // Handle and when it faulted, as steady_clock ticks. The two are stored separately, a reader racing
+    // remember_fault can pair a handle with the previous time for that slot, which only shifts when it expires.
+    struct Fault {
+        std::atomic<uint64_t> handle{0};
+        std::atomic<std::chrono::steady_clock::rep> time{0};
+    };
+
+    std::array<Fault, FAULT_CACHE_SIZE> m_faults{};
+
+    // Bit get_heap_filter_bit of every live heap, rebuilt by every publish. A live heap's bit is set in every version
+    // of its word, so rebuilding never hides it from a concurrent may_be_tracked.
+    std::array<std::atomic<uint64_t>, HEAP_FILTER_BITS / 64> m_heap_filter{};
+};
+}
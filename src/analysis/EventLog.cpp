@@ -0,0 +1,100 @@
+#include "EventLog.hpp"
+
+namespace analysis {
+EventLog::EventLog(std::shared_ptr<spdlog::logger> logger, std::chrono::milliseconds window)
+    : m_logger{std::move(logger)},
+    m_window{window}
+{
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+// Runs in DLL_PROCESS_DETACH in the plugin, where the drain may have been terminated with the process halfway through a poll.
+EventLog::~EventLog() {
+    if (std::unique_lock lock{m_drain_mutex, std::try_to_lock}; lock.owns_lock()) {
+        drain();
+        write_pending();
+    }
+}
+
+void EventLog::poll() {
+    std::scoped_lock _{m_drain_mutex};
+
+    drain();
+
+    if (const auto now = std::chrono::steady_clock::now(); now - m_window_start >= m_window) {
+        write_pending();
+        m_window_start = now;
+    }
+}
+
+void EventLog::flush() {
+    std::scoped_lock _{m_drain_mutex};
+
+    drain();
+    write_pending();
+    m_window_start = std::chrono::steady_clock::now();
+}
+
+// Moves everything published so far out of the ring buffer into m_pending.
+void EventLog::drain() {
+    while (true) {
+        auto& slot = m_slots[m_head % CAPACITY];
+
+        if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+            break;
+        }
+
+        const auto type = slot.type;
+        const auto value = slot.value;
+        slot.sequence.store(m_head + CAPACITY, std::memory_order_release);
+        ++m_head;
+
+        Pending* pending = nullptr;
+
+        for (size_t i = 0; i < m_pending_count; ++i) {
+            if (m_pending[i].type == type) {
+                pending = &m_pending[i];
+                break;
+            }
+        }
+
+        if (pending == nullptr) {
+            // More distinct types than we have room for in one window, make room for the new one
+            if (m_pending_count == MAX_TYPES) {
+                write_pending();
+            }
+
+            pending = &m_pending[m_pending_count++];
+            *pending = {type, 0, value};
+        }
+
+        ++pending->count;
+    }
+}
+
+void EventLog::write_pending() {
+    for (size_t i = 0; i < m_pending_count; ++i) {
+        const auto& pending = m_pending[i];
+
+        if (pending.count == 1) {
+            m_logger->log(pending.type->level, fmt::runtime(pending.type->single), pending.first);
+        } else {
+            m_logger->log(pending.type->level, fmt::runtime(pending.type->summary), pending.count, m_window.count(), pending.first);
+        }
+    }
+
+    const auto dropped = m_dropped.load(std::memory_order_relaxed);
+
+    if (dropped != m_reported_dropped) {
+        m_logger->warn("[EventLog] Dropped {} event(s), the buffer was full", dropped - m_reported_dropped);
+        m_reported_dropped = dropped;
+    }
+
+    m_pending_count = 0;
+
+    // Once per window, which also covers whatever got logged to the same logger outside of the event log
+    m_logger->flush();
+}
+}
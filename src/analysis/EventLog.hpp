@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <spdlog/spdlog.h>
+
+namespace analysis {
+// What a hot path event turns into once it reaches the log.
+// single is used when it only happened once in a window, with the value as its only argument.
+// summary gets the count, the window length in ms and the first value of the window, in that order.
+struct EventType {
+    spdlog::level::level_enum level{spdlog::level::info};
+    const char* single{};
+    const char* summary{};
+};
+
+// Logging for hooks that run in the game's render and driver threads, where formatting and writing a line
+// synchronously is exactly the kind of stall we're trying to get rid of.
+// post() only claims a slot in a fixed size ring buffer (lock free, any number of producers) and never blocks.
+// The owner drains it through poll() every few ms, from a background thread of its choosing. That collapses repeats of the
+// same event type within a window into one counted summary ("Rejected 412 copies in last 1000ms, first index 3") and writes
+// those to the logger. There's no thread in here: the plugin stops its drain from DLL_PROCESS_DETACH, where no thread
+// can be joined, and uses a thread pool timer for it.
+class EventLog {
+public:
+    static constexpr size_t CAPACITY = 4096;
+    static constexpr size_t MAX_TYPES = 32;
+
+    explicit EventLog(std::shared_ptr<spdlog::logger> logger, std::chrono::milliseconds window = std::chrono::seconds{1});
+
+    // Writes out whatever is still pending, on the calling thread, unless a poll() never got to finish.
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    // type has to outlive the log. Returns false (and counts it as dropped) if the buffer is full.
+    bool post(const EventType& type, int64_t value = 0) {
+        auto pos = m_tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& slot = m_slots[pos % CAPACITY];
+            const auto seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = (intptr_t)seq - (intptr_t)pos;
+
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.type = &type;
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+
+                    return true;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Events that didn't fit into the buffer since the log was created.
+    size_t get_dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    // Drains the buffer, and writes the summaries once the window is over. Has to be called regularly
+    // (CAPACITY events have to fit in between), from a thread that can afford the occasional write.
+    void poll();
+
+    // Drains the buffer and writes everything pending right away, without waiting for the window to end.
+    void flush();
+
+private:
+    // Bounded MPMC queue slot (Vyukov), only ever consumed by the drain thread.
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence{};
+        const EventType* type{};
+        int64_t value{};
+    };
+
+    struct Pending {
+        const EventType* type{};
+        size_t count{};
+        int64_t first{};
+    };
+
+    void drain();
+    void write_pending();
+
+    std::shared_ptr<spdlog::logger> m_logger{};
+    std::chrono::milliseconds m_window{};
+
+    std::unique_ptr<std::array<Slot, CAPACITY>> m_slots_storage{std::make_unique<std::array<Slot, CAPACITY>>()};
+    std::array<Slot, CAPACITY>& m_slots{*m_slots_storage};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    alignas(64) size_t m_head{0};
+    std::atomic<size_t> m_dropped{0};
+    size_t m_reported_dropped{0};
+
+    // Only touched by whoever holds m_drain_mutex
+    std::mutex m_drain_mutex{};
+    std::array<Pending, MAX_TYPES> m_pending{};
+    size_t m_pending_count{0};
+    std::chrono::steady_clock::time_point m_window_start{std::chrono::steady_clock::now()};
+};
+}
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cstring>
+
+#include <bddisasm.h>
+
+#include "Fingerprint.hpp"
+#include "FunctionTable.hpp"
+#include "Hash.hpp"
+#include "WorkPool.hpp"
+
+namespace analysis {
+namespace detail {
+// Skipped when looking up candidates, a key shared by this many functions doesn't narrow anything down.
+constexpr size_t MAX_BUCKET_SIZE = 1024;
+
+enum class FlowKind : uint8_t {
+    NONE,
+    CALL,
+    RET,
+    JMP,
+    JCC,
+};
+
+struct DecodedInstruction {
+    uint32_t offset{}; // from the start of the function
+    uint32_t token{};  // hash of the bytes with displacements, immediates and branch offsets zeroed
+    int64_t target{-1}; // offset of a relative branch target, -1 if none
+    FlowKind kind{};
+};
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void mask(uint8_t* bytes, size_t offset, size_t length) {
+    if (length != 0 && offset + length <= 16) {
+        std::memset(bytes + offset, 0, length);
+    }
+}
+
+std::vector<DecodedInstruction> decode(uintptr_t begin, uintptr_t end) {
+    std::vector<DecodedInstruction> result{};
+
+    for (auto ip = begin; ip < end && result.size() < Fingerprint::MAX_INSTRUCTIONS;) {
+        INSTRUX ix{};
+
+        if (!ND_SUCCESS(NdDecodeEx(&ix, (const ND_UINT8*)ip, 16, ND_CODE_64, ND_DATA_64))) {
+            break;
+        }
+
+        uint8_t bytes[16]{};
+        std::memcpy(bytes, (const void*)ip, ix.Length);
+        mask(bytes, ix.DispOffset, ix.DispLength);
+        mask(bytes, ix.Imm1Offset, ix.Imm1Length);
+        mask(bytes, ix.RelOffsOffset, ix.RelOffsLength);
+
+        DecodedInstruction insn{};
+        insn.offset = (uint32_t)(ip - begin);
+        insn.token = (uint32_t)fnv1a(bytes, ix.Length);
+
+        switch (ix.Category) {
+        case ND_CAT_CALL:
+            insn.kind = FlowKind::CALL;
+            break;
+        case ND_CAT_RET:
+            insn.kind = FlowKind::RET;
+            break;
+        case ND_CAT_UNCOND_BR:
+            insn.kind = FlowKind::JMP;
+            break;
+        case ND_CAT_COND_BR:
+            insn.kind = FlowKind::JCC;
+            break;
+        default:
+            break;
+        }
+
+        if (ix.RelOffsLength == 1 || ix.RelOffsLength == 4) {
+            const auto rel = ix.RelOffsLength == 1 ? (int64_t)*(const int8_t*)(ip + ix.RelOffsOffset) : (int64_t)*(const int32_t*)(ip + ix.RelOffsOffset);
+            insn.target = (int64_t)(ip - begin) + ix.Length + rel;
+        }
+
+        result.push_back(insn);
+        ip += ix.Length;
+    }
+
+    return result;
+}
+
+bool is_instruction_start(const std::vector<DecodedInstruction>& insns, uint32_t offset) {
+    const auto it = std::lower_bound(insns.begin(), insns.end(), offset, [](const DecodedInstruction& insn, uint32_t o) {
+        return insn.offset < o;
+    });
+
+    return it != insns.end() && it->offset == offset;
+}
+
+// Hashes the basic block layout: how many instructions each block has and which blocks it flows into,
+// relative to itself so the hash doesn't care where the function is.
+void hash_cfg(const std::vector<DecodedInstruction>& insns, Fingerprint& out) {
+    const auto function_size = insns.back().offset + 1;
+    std::vector<uint32_t> leaders{0};
+
+    for (size_t i = 0; i < insns.size(); ++i) {
+        const auto& insn = insns[i];
+
+        if ((insn.kind == FlowKind::JMP || insn.kind == FlowKind::JCC) && insn.target >= 0 && insn.target < (int64_t)function_size) {
+            leaders.push_back((uint32_t)insn.target);
+        }
+
+        if ((insn.kind == FlowKind::JMP || insn.kind == FlowKind::JCC || insn.kind == FlowKind::RET) && i + 1 < insns.size()) {
+            leaders.push_back(insns[i + 1].offset);
+        }
+    }
+
+    std::sort(leaders.begin(), leaders.end());
+    leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+
+    // Branches into the middle of an instruction don't start a block
+    leaders.erase(std::remove_if(leaders.begin(), leaders.end(), [&](uint32_t offset) {
+        return !is_instruction_start(insns, offset);
+    }), leaders.end());
+
+    const auto block_of = [&](int64_t offset) -> int64_t {
+        const auto it = std::lower_bound(leaders.begin(), leaders.end(), (uint32_t)offset);
+        return it != leaders.end() && *it == offset ? it - leaders.begin() : -1;
+    };
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t edges = 0;
+    size_t block = 0;
+    uint32_t count = 0;
+
+    for (size_t i = 0; i < insns.size(); ++i) {
+        ++count;
+
+        const auto is_last = i + 1 == insns.size() || (block + 1 < leaders.size() && insns[i + 1].offset == leaders[block + 1]);
+
+        if (!is_last) {
+            continue;
+        }
+
+        const auto& insn = insns[i];
+        int32_t successors[2]{};
+        uint32_t num_successors = 0;
+
+        if (insn.kind == FlowKind::JMP || insn.kind == FlowKind::JCC) {
+            if (const auto target = block_of(insn.target); target >= 0) {
+                successors[num_successors++] = (int32_t)(target - (int64_t)block);
+            }
+        }
+
+        if (insn.kind != FlowKind::JMP && insn.kind != FlowKind::RET && block + 1 < leaders.size()) {
+            successors[num_successors++] = 1;
+        }
+
+        hash = fnv1a_value(count, hash);
+        hash = fnv1a_value(num_successors, hash);
+        hash = fnv1a(successors, num_successors * sizeof(int32_t), hash);
+
+        edges += num_successors;
+        count = 0;
+        ++block;
+    }
+
+    out.shape = hash;
+    out.block_count = (uint16_t)std::min<size_t>(leaders.size(), UINT16_MAX);
+    out.edge_count = (uint16_t)std::min<size_t>(edges, UINT16_MAX);
+}
+}
+
+std::optional<Fingerprint> Fingerprint::compute(uintptr_t begin, uintptr_t end) {
+    const auto insns = detail::decode(begin, end);
+
+    if (insns.empty()) {
+        return std::nullopt;
+    }
+
+    Fingerprint result{};
+    result.instruction_count = (uint32_t)insns.size();
+    result.minhash.fill(UINT32_MAX);
+
+    // Trigrams keep some of the ordering, single instructions for functions too short for that
+    const auto gram_size = std::min<size_t>(insns.size(), 3);
+
+    for (size_t i = 0; i + gram_size <= insns.size(); ++i) {
+        uint64_t gram = 0;
+
+        for (size_t j = 0; j < gram_size; ++j) {
+            gram = detail::mix(gram ^ insns[i + j].token);
+        }
+
+        for (size_t k = 0; k < NUM_HASHES; ++k) {
+            const auto h = (uint32_t)detail::mix(gram ^ ((k + 1) * 0x9E3779B97F4A7C15ULL));
+            result.minhash[k] = std::min(result.minhash[k], h);
+        }
+    }
+
+    uint64_t prologue = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < std::min(insns.size(), PROLOGUE_INSTRUCTIONS); ++i) {
+        prologue = fnv1a_value(insns[i].token, prologue);
+    }
+
+    result.prologue = prologue;
+
+    detail::hash_cfg(insns, result);
+
+    return result;
+}
+
+std::vector<uint8_t> Fingerprint::serialize() const {
+    std::vector<uint8_t> result(sizeof(Fingerprint));
+    std::memcpy(result.data(), this, sizeof(Fingerprint));
+    return result;
+}
+
+std::optional<Fingerprint> Fingerprint::deserialize(std::span<const uint8_t> data) {
+    if (data.size() != sizeof(Fingerprint)) {
+        return std::nullopt;
+    }
+
+    Fingerprint result{};
+    std::memcpy(&result, data.data(), sizeof(Fingerprint));
+    return result;
+}
+
+float Fingerprint::similarity(const Fingerprint& a, const Fingerprint& b) {
+    size_t equal = 0;
+
+    for (size_t k = 0; k < NUM_HASHES; ++k) {
+        equal += a.minhash[k] == b.minhash[k];
+    }
+
+    const auto ratio = [](uint32_t x, uint32_t y) {
+        return std::max(x, y) == 0 ? 1.0f : (float)std::min(x, y) / (float)std::max(x, y);
+    };
+
+    // Estimated Jaccard similarity of the trigram sets does most of the work, CFG and size break ties
+    const auto jaccard = (float)equal / NUM_HASHES;
+    const auto shape = a.shape == b.shape ? 1.0f : 0.5f * ratio(a.block_count, b.block_count);
+    const auto size = ratio(a.instruction_count, b.instruction_count);
+
+    return 0.6f * jaccard + 0.25f * shape + 0.15f * size;
+}
+
+std::vector<uint64_t> FingerprintIndex::get_keys(const Fingerprint& fingerprint) {
+    std::vector<uint64_t> keys{};
+    keys.push_back(detail::mix(fingerprint.shape ^ 1));
+    keys.push_back(detail::mix(fingerprint.prologue ^ 2));
+
+    for (size_t band = 0; band < Fingerprint::NUM_HASHES / Fingerprint::BAND_SIZE; ++band) {
+        const auto hash = fnv1a(&fingerprint.minhash[band * Fingerprint::BAND_SIZE], Fingerprint::BAND_SIZE * sizeof(uint32_t), band + 3);
+        keys.push_back(hash);
+    }
+
+    return keys;
+}
+
+void FingerprintIndex::build(uintptr_t module, const FunctionTable& functions, WorkPool* pool) {
+    const auto start = std::chrono::steady_clock::now();
+
+    m_module = module;
+    m_entries.clear();
+    m_buckets.clear();
+
+    // Only primary fragments, chained ones are part of a function that's already in here
+    std::vector<const FunctionTable::Entry*> primaries{};
+
+    for (const auto& entry : functions.get_entries()) {
+        if (entry.begin == entry.function) {
+            primaries.push_back(&entry);
+        }
+    }
+
+    std::vector<std::optional<Fingerprint>> results(primaries.size());
+
+    const auto compute = [&](size_t i) {
+        results[i] = Fingerprint::compute(module + primaries[i]->begin, module + primaries[i]->end);
+    };
+
+    if (pool != nullptr) {
+        pool->parallel_for(primaries.size(), compute);
+    } else {
+        for (size_t i = 0; i < primaries.size(); ++i) {
+            compute(i);
+        }
+    }
+
+    m_entries.reserve(primaries.size());
+
+    for (size_t i = 0; i < primaries.size(); ++i) {
+        if (!results[i]) {
+            continue;
+        }
+
+        const auto index = (uint32_t)m_entries.size();
+        m_entries.push_back(Entry{primaries[i]->begin, *results[i]});
+
+        for (const auto key : get_keys(*results[i])) {
+            m_buckets[key].push_back(index);
+        }
+    }
+
+    m_build_time = std::chrono::steady_clock::now() - start;
+}
+
+std::optional<FingerprintIndex::Match> FingerprintIndex::find(const Fingerprint& fingerprint) const {
+    std::vector<uint32_t> candidates{};
+
+    for (const auto key : get_keys(fingerprint)) {
+        const auto it = m_buckets.find(key);
+
+        if (it != m_buckets.end() && it->second.size() <= detail::MAX_BUCKET_SIZE) {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+
+    float best = -1.0f;
+    float runner_up = 0.0f;
+    uint32_t best_index = 0;
+
+    for (const auto index : candidates) {
+        const auto score = Fingerprint::similarity(fingerprint, m_entries[index].fingerprint);
+
+        if (score > best) {
+            runner_up = std::max(runner_up, best);
+            best = score;
+            best_index = index;
+        } else {
+            runner_up = std::max(runner_up, score);
+        }
+    }
+
+    return Match{m_module + m_entries[best_index].rva, best, best - runner_up, candidates.size()};
+}
+}
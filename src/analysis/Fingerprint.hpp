@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace analysis {
+class FunctionTable;
+class WorkPool;
+
+// Summary of what a function does rather than its exact bytes, so it survives a rebuild of the game.
+// Every instruction is reduced to its bytes with displacements, immediates and branch offsets masked out,
+// which hides moved data and code. Trigrams of those go into a MinHash, and the control flow graph
+// gets its own hash on top.
+struct Fingerprint {
+    static constexpr size_t NUM_HASHES = 16;
+    static constexpr size_t BAND_SIZE = 4; // minhashes per candidate index key
+    static constexpr size_t PROLOGUE_INSTRUCTIONS = 8;
+    static constexpr size_t MAX_INSTRUCTIONS = 0x10000;
+
+    std::array<uint32_t, NUM_HASHES> minhash{};
+    uint64_t shape{};    // instructions per basic block and where each block goes
+    uint64_t prologue{}; // the first PROLOGUE_INSTRUCTIONS normalized instructions
+    uint32_t instruction_count{};
+    uint16_t block_count{};
+    uint16_t edge_count{};
+
+    // The function in [begin, end), nullopt if it doesn't decode.
+    static std::optional<Fingerprint> compute(uintptr_t begin, uintptr_t end);
+
+    std::vector<uint8_t> serialize() const;
+    static std::optional<Fingerprint> deserialize(std::span<const uint8_t> data);
+
+    // 0 (nothing in common) to 1 (same code modulo addresses and constants).
+    static float similarity(const Fingerprint& a, const Fingerprint& b);
+};
+
+// Fingerprints of every function in an image, hashed by CFG shape, prologue and MinHash bands.
+// Looking a fingerprint up only scores the functions sharing at least one of those keys with it.
+class FingerprintIndex {
+public:
+    struct Match {
+        uintptr_t function{};
+        float confidence{}; // similarity of the best candidate
+        float margin{};     // how far ahead of the runner-up it is
+        size_t candidates{};
+    };
+
+    // Fingerprints the functions across the pool, or on the calling thread if it's nullptr.
+    void build(uintptr_t module, const FunctionTable& functions, WorkPool* pool = nullptr);
+
+    std::optional<Match> find(const Fingerprint& fingerprint) const;
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    std::chrono::nanoseconds get_build_time() const {
+        return m_build_time;
+    }
+
+private:
+    struct Entry {
+        uint32_t rva{};
+        Fingerprint fingerprint{};
+    };
+
+    static std::vector<uint64_t> get_keys(const Fingerprint& fingerprint);
+
+    uintptr_t m_module{};
+    std::vector<Entry> m_entries{};
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_buckets{}; // key -> indices into m_entries
+    std::chrono::nanoseconds m_build_time{};
+};
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "FunctionTable.hpp"
+#include "Pe.hpp"
+
+namespace analysis {
+void FunctionTable::build(uintptr_t module) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto base = (const uint8_t*)module;
+    const auto image_size = pe::get_image_size(base);
+    const auto runtime_functions = pe::get_runtime_functions(base);
+
+    m_module = module;
+    m_entries.clear();
+    m_entries.reserve(runtime_functions.size());
+
+    for (const auto& rf : runtime_functions) {
+        if (rf.begin_address >= rf.end_address || rf.end_address > image_size) {
+            continue;
+        }
+
+        auto primary = rf;
+
+        for (size_t depth = 0; depth < MAX_CHAIN_DEPTH; ++depth) {
+            const auto unwind = primary.unwind_data;
+
+            // Low bit set means UnwindData is the RVA of another RUNTIME_FUNCTION that shares its unwind info
+            if ((unwind & 1) != 0) {
+                const auto next = unwind & ~1u;
+
+                if (next + sizeof(pe::RuntimeFunction) > image_size) {
+                    break;
+                }
+
+                primary = *(const pe::RuntimeFunction*)(base + next);
+                continue;
+            }
+
+            if (unwind + offsetof(pe::UnwindInfo, unwind_codes) > image_size) {
+                break;
+            }
+
+            const auto info = (const pe::UnwindInfo*)(base + unwind);
+
+            if (((info->version_and_flags >> 3) & pe::UNW_FLAG_CHAININFO) == 0) {
+                break;
+            }
+
+            // The parent RUNTIME_FUNCTION follows the unwind codes, which are padded to an even count
+            const auto chained = unwind + offsetof(pe::UnwindInfo, unwind_codes) + ((info->count_of_codes + 1) & ~1) * sizeof(uint16_t);
+
+            if (chained + sizeof(pe::RuntimeFunction) > image_size) {
+                break;
+            }
+
+            primary = *(const pe::RuntimeFunction*)(base + chained);
+        }
+
+        m_entries.push_back(Entry{rf.begin_address, rf.end_address, primary.begin_address, primary.unwind_data});
+    }
+
+    // The linker already emits them sorted, this is just so a malformed table can't break the search.
+    if (!std::is_sorted(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.begin < b.begin; })) {
+        std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.begin < b.begin; });
+    }
+
+    m_build_time = std::chrono::steady_clock::now() - start;
+}
+
+// Layout: u32 entry count, followed by the entries as-is.
+std::vector<uint8_t> FunctionTable::serialize() const {
+    const auto count = (uint32_t)m_entries.size();
+    std::vector<uint8_t> data(sizeof(count) + m_entries.size() * sizeof(Entry));
+
+    std::memcpy(data.data(), &count, sizeof(count));
+    std::memcpy(data.data() + sizeof(count), m_entries.data(), m_entries.size() * sizeof(Entry));
+
+    return data;
+}
+
+bool FunctionTable::deserialize(uintptr_t module, std::span<const uint8_t> data) {
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t count{};
+
+    if (data.size() < sizeof(count)) {
+        return false;
+    }
+
+    std::memcpy(&count, data.data(), sizeof(count));
+
+    if (data.size() != sizeof(count) + (size_t)count * sizeof(Entry)) {
+        return false;
+    }
+
+    std::vector<Entry> entries(count);
+    std::memcpy(entries.data(), data.data() + sizeof(count), count * sizeof(Entry));
+
+    const auto image_size = pe::get_image_size((const uint8_t*)module);
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+
+        if (e.begin >= e.end || e.end > image_size || e.function >= image_size || (i > 0 && entries[i - 1].begin > e.begin)) {
+            return false;
+        }
+    }
+
+    m_module = module;
+    m_entries = std::move(entries);
+    m_build_time = std::chrono::steady_clock::now() - start;
+
+    return true;
+}
+
+const FunctionTable::Entry* FunctionTable::find(uintptr_t addr) const {
+    if (m_entries.empty() || addr < m_module || addr - m_module > UINT32_MAX) {
+        return nullptr;
+    }
+
+    const auto rva = (uint32_t)(addr - m_module);
+
+    // Branch-free upper bound - 1, the comparison compiles down to a cmov.
+    auto first = m_entries.data();
+    auto n = m_entries.size();
+
+    while (n > 1) {
+        const auto half = n / 2;
+        first = first[half].begin <= rva ? first + half : first;
+        n -= half;
+    }
+
+    if (rva < first->begin || rva >= first->end) {
+        return nullptr;
+    }
+
+    return first;
+}
+
+std::optional<uintptr_t> FunctionTable::find_function_start(uintptr_t addr) const {
+    const auto entry = find(addr);
+
+    if (entry == nullptr) {
+        return std::nullopt;
+    }
+
+    return m_module + entry->function;
+}
+
+std::optional<uintptr_t> FunctionTable::find_function_end(uintptr_t addr) const {
+    const auto entry = find(addr);
+
+    if (entry == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto primary = entry->begin == entry->function ? entry : find(m_module + entry->function);
+
+    if (primary == nullptr) {
+        return std::nullopt;
+    }
+
+    return m_module + primary->end;
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace analysis {
+// Function boundaries from the exception directory (.pdata), parsed once.
+// Chained unwind info (functions split into multiple fragments by the compiler) is resolved up front,
+// so every fragment already knows the primary function it belongs to, like utility::find_function_start_unwind.
+class FunctionTable {
+public:
+    // All RVAs. begin/end are the fragment's range, function/unwind belong to the primary function.
+    struct Entry {
+        uint32_t begin{};
+        uint32_t end{};
+        uint32_t function{};
+        uint32_t unwind{};
+    };
+
+    static constexpr size_t MAX_CHAIN_DEPTH = 32;
+
+    void build(uintptr_t module);
+
+    // Counterpart of serialize(), used to restore the table from the scan cache.
+    bool deserialize(uintptr_t module, std::span<const uint8_t> data);
+    std::vector<uint8_t> serialize() const;
+
+    // Fragment containing addr, or nullptr if addr isn't covered by unwind info (e.g. leaf functions).
+    const Entry* find(uintptr_t addr) const;
+
+    std::span<const Entry> get_entries() const {
+        return m_entries;
+    }
+
+    std::optional<uintptr_t> find_function_start(uintptr_t addr) const;
+
+    // End of the primary function's own fragment, not of any chained fragments.
+    std::optional<uintptr_t> find_function_end(uintptr_t addr) const;
+
+    bool empty() const {
+        return m_entries.empty();
+    }
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    size_t get_memory_usage() const {
+        return m_entries.capacity() * sizeof(Entry);
+    }
+
+    std::chrono::nanoseconds get_build_time() const {
+        return m_build_time;
+    }
+
+private:
+    uintptr_t m_module{};
+    std::vector<Entry> m_entries{};
+    std::chrono::nanoseconds m_build_time{};
+};
+}
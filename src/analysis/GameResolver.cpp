@@ -0,0 +1,524 @@
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include "CandidatePipeline.hpp"
+#include "GameResolver.hpp"
+#include "HintScan.hpp"
+#include "ParallelScan.hpp"
+#include "ScanCache.hpp"
+#include "ScanRegion.hpp"
+#include "SimdScan.hpp"
+#include "StaticPattern.hpp"
+
+namespace analysis {
+namespace detail {
+constexpr StaticPattern FRAME_NUMBER_INCREMENT{"FF 05 ? ? ? ? 48 8D 0D ? ? ? ? 48 89 9C 24 88 00 00 00"};
+constexpr StaticPattern UPDATE_TRANSFORM{"48 89 5C 24 10 48 89 6C 24 18 56 57 41 55 41 56 41 57 B8 ? ? ? ? E8 ? ? ? ? 48 2B E0 8B 41 10"};
+constexpr uint64_t STARTFRAME_MAGIC = 0x47AE147AE147AE15;
+
+// What find_startframe has figured out about one use of STARTFRAME_MAGIC so far.
+struct StartFrameCandidate {
+    uintptr_t magic_ref{};
+    uintptr_t fn_start_unwind{};
+    uintptr_t fn_jmp{};
+    uintptr_t fn_start{};
+    uintptr_t vtable{};
+};
+
+void log_scan(std::string_view what, const ScanStats& stats) {
+    SPDLOG_INFO("Scanned {:.1f} MiB for {} in {:.3f}ms, {} page fault(s)",
+        stats.bytes_scanned / (1024.0 * 1024.0),
+        what,
+        std::chrono::duration<double, std::milli>(stats.elapsed).count(),
+        stats.page_faults);
+}
+}
+
+const MultiScanner& GameResolver::get_signatures() {
+    std::call_once(m_signatures_once, [this]() {
+        const ScanMeter meter{};
+        auto& s = m_signatures;
+
+        s.add("GFrameNumberRenderThread", detail::FRAME_NUMBER_INCREMENT.to_pattern(), MultiScanner::Target::CODE);
+        s.add("FVelocityData::UpdateTransform", detail::UPDATE_TRANSFORM.to_pattern(), MultiScanner::Target::CODE);
+
+        s.scan_module(m_module, m_pool);
+
+        for (const auto name : {"GFrameNumberRenderThread", "FVelocityData::UpdateTransform"}) {
+            if (const auto count = s.get_matches(name).size(); count != 1) {
+                SPDLOG_WARN("{} matched {} times, expected 1", name, count);
+            }
+        }
+
+        detail::log_scan("game signatures", meter.stop(s.get_bytes_scanned()));
+    });
+
+    return m_signatures;
+}
+
+const XrefIndex& GameResolver::get_xrefs() {
+    std::call_once(m_xrefs_once, [this]() {
+        const auto shared = m_shared != nullptr ? m_shared->get("XrefIndex") : std::nullopt;
+
+        if (shared && m_xrefs.deserialize(m_module, *shared)) {
+            SPDLOG_INFO("[SharedScanState] Xref index: {} references, {:.3f}ms", m_xrefs.size(), std::chrono::duration<double, std::milli>(m_xrefs.get_build_time()).count());
+            return;
+        }
+
+        const ScanMeter meter{};
+        m_xrefs.build(m_module, m_pool);
+        detail::log_scan("xref index", meter.stop(m_xrefs.get_bytes_scanned()));
+
+        SPDLOG_INFO("Built xref index: {} references, {:.1f} MiB", m_xrefs.size(), m_xrefs.get_memory_usage() / (1024.0 * 1024.0));
+    });
+
+    return m_xrefs;
+}
+
+const StringIndex& GameResolver::get_strings() {
+    std::call_once(m_strings_once, [this]() {
+        const auto shared = m_shared != nullptr ? m_shared->get("StringIndex") : std::nullopt;
+
+        if (shared && m_strings.deserialize(m_module, *shared)) {
+            SPDLOG_INFO("[SharedScanState] String index: {} strings, {:.3f}ms", m_strings.size(), std::chrono::duration<double, std::milli>(m_strings.get_build_time()).count());
+            return;
+        }
+
+        const ScanMeter meter{};
+        m_strings.build(m_module);
+        detail::log_scan("string index", meter.stop(m_strings.get_bytes_scanned()));
+
+        SPDLOG_INFO("Built string index: {} strings, {:.1f} MiB", m_strings.size(), m_strings.get_memory_usage() / (1024.0 * 1024.0));
+    });
+
+    return m_strings;
+}
+
+const FunctionTable& GameResolver::get_functions() {
+    std::call_once(m_functions_once, [this]() {
+        const auto shared = m_shared != nullptr ? m_shared->get("FunctionTable") : std::nullopt;
+
+        if (shared && m_functions.deserialize(m_module, *shared)) {
+            SPDLOG_INFO("[SharedScanState] Function table");
+        } else if (const auto cached = m_cache != nullptr ? m_cache->get_blob(m_module, "FunctionTable") : std::nullopt; cached && m_functions.deserialize(m_module, *cached)) {
+            SPDLOG_INFO("[ScanCache] Function table (cached)");
+        } else {
+            m_functions.build(m_module);
+
+            if (m_cache != nullptr) {
+                m_cache->set_blob(m_module, "FunctionTable", m_functions.serialize());
+            }
+        }
+
+        SPDLOG_INFO("Function table: {} entries, {:.1f} MiB, {:.3f}ms",
+            m_functions.size(),
+            m_functions.get_memory_usage() / (1024.0 * 1024.0),
+            std::chrono::duration<double, std::milli>(m_functions.get_build_time()).count());
+    });
+
+    return m_functions;
+}
+
+const RttiIndex& GameResolver::get_rtti() {
+    std::call_once(m_rtti_once, [this]() {
+        const ScanMeter meter{};
+        m_rtti.build(m_module);
+        detail::log_scan("RTTI", meter.stop(m_rtti.get_bytes_scanned()));
+
+        SPDLOG_INFO("Built RTTI index: {} classes, {} vtables", m_rtti.size(), m_rtti.get_vtable_count());
+    });
+
+    return m_rtti;
+}
+
+const FingerprintIndex& GameResolver::get_fingerprints() {
+    std::call_once(m_fingerprints_once, [this]() {
+        m_fingerprints.build(m_module, get_functions(), m_pool);
+
+        SPDLOG_INFO("Built fingerprint index: {} functions, {:.3f}ms",
+            m_fingerprints.size(),
+            std::chrono::duration<double, std::milli>(m_fingerprints.get_build_time()).count());
+    });
+
+    return m_fingerprints;
+}
+
+std::vector<SharedScanState::Blob> GameResolver::serialize_indexes() const {
+    std::vector<SharedScanState::Blob> blobs{};
+
+    if (!m_functions.empty()) {
+        blobs.push_back({"FunctionTable", m_functions.serialize()});
+    }
+
+    if (!m_xrefs.empty()) {
+        blobs.push_back({"XrefIndex", m_xrefs.serialize()});
+    }
+
+    if (m_strings.size() > 0) {
+        blobs.push_back({"StringIndex", m_strings.serialize()});
+    }
+
+    return blobs;
+}
+
+std::optional<uintptr_t> GameResolver::find_function_start(uintptr_t addr) {
+    if (const auto fn = get_functions().find_function_start(addr)) {
+        return fn;
+    }
+
+    return get_xrefs().find_call_target_before(addr);
+}
+
+std::optional<uintptr_t> GameResolver::find_string_ref(std::wstring_view str) {
+    for (const auto addr : get_strings().find(str)) {
+        if (const auto ref = get_xrefs().find_reference(addr)) {
+            return ref;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<uintptr_t> GameResolver::find_function_from_string(std::wstring_view str) {
+    const auto ref = find_string_ref(str);
+
+    if (!ref) {
+        return std::nullopt;
+    }
+
+    return find_function_start(*ref);
+}
+
+std::vector<uintptr_t> GameResolver::find_all_code(std::string_view what, const simd::CompiledPattern& pattern) {
+    const ScanMeter meter{};
+    const auto regions = get_scan_regions(m_module, RegionKind::CODE);
+    std::vector<uintptr_t> result{};
+
+    for (const auto& region : regions) {
+        if (m_pool != nullptr) {
+            parallel_find_all(*m_pool, region.begin, region.size, pattern, result);
+        } else {
+            simd::find_all(region.begin, region.size, pattern, result);
+        }
+    }
+
+    detail::log_scan(what, meter.stop(get_total_size(regions)));
+    return result;
+}
+
+std::optional<uintptr_t> GameResolver::find_pointer(uintptr_t value) {
+    static_assert(sizeof(value) == sizeof(uint64_t));
+
+    const auto pattern = simd::CompiledPattern::compile(Pattern::from_bytes(&value, sizeof(value)));
+    const ScanMeter meter{};
+    size_t bytes_scanned = 0;
+
+    // Vtables only ever live in .rdata
+    for (const auto& region : get_scan_regions(m_module, RegionKind::RDATA)) {
+        bytes_scanned += region.size;
+
+        const auto result = m_pool != nullptr ? parallel_find_first(*m_pool, region.begin, region.size, pattern) : simd::find_first(region.begin, region.size, pattern);
+
+        if (result) {
+            detail::log_scan("pointer", meter.stop(bytes_scanned));
+            return result;
+        }
+    }
+
+    detail::log_scan("pointer", meter.stop(bytes_scanned));
+    return std::nullopt;
+}
+
+std::optional<uintptr_t> GameResolver::find_signature(std::string_view name, const AnchoredPattern& pattern) {
+    const auto hint = m_cache != nullptr ? m_cache->get_hint(name) : std::nullopt;
+
+    if (hint) {
+        const ScanMeter meter{};
+        const auto regions = get_scan_regions(m_module, RegionKind::CODE);
+
+        if (const auto match = find_near_hint(m_module, regions, *hint, pattern)) {
+            const auto elapsed = meter.stop(0).elapsed;
+            record_hint(HintResult{std::string{name}, *hint, (uint32_t)(match->address - m_module), match->window, elapsed});
+
+            return match->address;
+        }
+    }
+
+    // Either there's no hint yet or the surrounding section didn't have exactly one match
+    const ScanMeter meter{};
+    const auto result = get_signatures().get_first(name);
+
+    if (hint && result) {
+        record_hint(HintResult{std::string{name}, *hint, (uint32_t)(*result - m_module), HintWindow::MODULE, meter.stop(0).elapsed});
+    }
+
+    return result;
+}
+
+void GameResolver::record_hint(HintResult result) {
+    SPDLOG_INFO("[Hints] {} moved by {}0x{:x} ({}) in {:.3f}ms",
+        result.name,
+        result.rva < result.hint ? "-" : "+",
+        result.rva < result.hint ? result.hint - result.rva : result.rva - result.hint,
+        to_string(result.window),
+        std::chrono::duration<double, std::milli>(result.elapsed).count());
+
+    std::scoped_lock _{m_hint_results_mutex};
+    m_hint_results.push_back(std::move(result));
+}
+
+std::vector<GameResolver::HintResult> GameResolver::get_hint_results() const {
+    std::scoped_lock _{m_hint_results_mutex};
+    return m_hint_results;
+}
+
+std::optional<Fingerprint> GameResolver::fingerprint_function(uintptr_t fn) {
+    const auto end = get_functions().find_function_end(fn);
+
+    if (!end) {
+        return std::nullopt;
+    }
+
+    return Fingerprint::compute(fn, *end);
+}
+
+void GameResolver::remember_function(std::string_view name, uintptr_t fn) {
+    if (m_cache == nullptr) {
+        return;
+    }
+
+    if (const auto fingerprint = fingerprint_function(fn)) {
+        m_cache->set_function_fingerprint(name, fingerprint->serialize());
+    }
+}
+
+std::optional<uintptr_t> GameResolver::find_function_by_fingerprint(std::string_view name) {
+    const auto blob = m_cache != nullptr ? m_cache->get_function_fingerprint(name) : std::nullopt;
+    const auto fingerprint = blob ? Fingerprint::deserialize(*blob) : std::nullopt;
+
+    if (!fingerprint) {
+        return std::nullopt;
+    }
+
+    const auto match = get_fingerprints().find(*fingerprint);
+
+    if (!match) {
+        SPDLOG_WARN("[Fingerprint] No candidates for {}", name);
+        return std::nullopt;
+    }
+
+    SPDLOG_INFO("[Fingerprint] {} best match 0x{:x}, confidence {:.2f}, margin {:.2f}, {} candidate(s)",
+        name, match->function, match->confidence, match->margin, match->candidates);
+
+    if (match->confidence < MIN_FINGERPRINT_CONFIDENCE || match->margin < MIN_FINGERPRINT_MARGIN) {
+        SPDLOG_WARN("[Fingerprint] Match for {} isn't convincing enough, ignoring it", name);
+        return std::nullopt;
+    }
+
+    return match->function;
+}
+
+std::optional<uintptr_t> GameResolver::find_frame_number_increment() {
+    return find_signature("GFrameNumberRenderThread", detail::FRAME_NUMBER_INCREMENT.anchored());
+}
+
+std::optional<uintptr_t> GameResolver::find_render_composite_layer() {
+    const auto fn = find_function_from_string(L"FEndMenuRenderer::OnRenderCompositeLayerEx");
+
+    if (!fn) {
+        SPDLOG_ERROR("Failed to find FEndMenuRenderer::OnRenderCompositeLayer function start");
+        return std::nullopt;
+    }
+
+    return fn;
+}
+
+std::optional<uintptr_t> GameResolver::find_post_process_settings() {
+    const auto strs = get_strings().find(L"r.DefaultFeature.AutoExposure.Bias");
+
+    if (strs.empty()) {
+        SPDLOG_ERROR("Failed to find r.DefaultFeature.AutoExposure.Bias");
+        return std::nullopt;
+    }
+
+    std::optional<uintptr_t> func_start{};
+    std::optional<uintptr_t> ref{};
+
+    // The constructor is the function referencing the cvar name that gets called from a bunch of places
+    for (auto it = strs.begin(); it != strs.end() && !ref; ++it) {
+        ref = get_xrefs().find_reference(*it, [&](uintptr_t addr) -> bool {
+            func_start = find_function_start(addr);
+
+            if (!func_start) {
+                return false;
+            }
+
+            return get_xrefs().count_references(*func_start) > 3;
+        });
+    }
+
+    if (!ref) {
+        SPDLOG_ERROR("Failed to find r.DefaultFeature.AutoExposure.Bias callsite");
+        return std::nullopt;
+    }
+
+    SPDLOG_INFO("r.DefaultFeature.AutoExposure.Bias callsite at 0x{:x}", *ref);
+    return func_start;
+}
+
+std::optional<uintptr_t> GameResolver::find_motion_blur_jcc() {
+    const auto motion_blur_intermediate_ref = find_string_ref(L"MotionBlurIntermediate");
+
+    if (!motion_blur_intermediate_ref) {
+        SPDLOG_ERROR("Failed to find MotionBlurIntermediate");
+        return std::nullopt;
+    }
+
+    const auto fn = find_function_start(*motion_blur_intermediate_ref);
+
+    if (!fn) {
+        SPDLOG_ERROR("Failed to find MotionBlurIntermediate function start");
+        return std::nullopt;
+    }
+
+    const auto fn_callsite = get_xrefs().find_reference(*fn, XrefIndex::Kind::CALL);
+
+    if (!fn_callsite) {
+        SPDLOG_ERROR("Failed to find MotionBlurIntermediate callsite");
+        return std::nullopt;
+    }
+
+    // Linear sweep from the start of whatever function fragment the call lives in,
+    // the last conditional branch before the call is the one guarding it.
+    const auto fragment = get_functions().find(*fn_callsite);
+    const auto caller = fragment != nullptr ? std::optional<uintptr_t>{m_module + fragment->begin} : find_function_start(*fn_callsite);
+
+    if (!caller) {
+        SPDLOG_ERROR("Failed to find MotionBlurIntermediate caller");
+        return std::nullopt;
+    }
+
+    const auto call_insn = *fn_callsite - 1;
+    const auto instructions = m_instructions.get(*caller, call_insn);
+
+    if (instructions.empty() || instructions.back().end() < call_insn) {
+        SPDLOG_ERROR("Failed to disassemble preceding instructions for MotionBlurIntermediate at 0x{:x}", instructions.empty() ? *caller : instructions.back().end());
+        return std::nullopt;
+    }
+
+    std::optional<uintptr_t> jcc{};
+
+    for (const auto& ix : instructions_before(instructions, call_insn)) {
+        if (ix.is_conditional_branch()) {
+            jcc = ix.address;
+            break;
+        }
+    }
+
+    if (!jcc) {
+        SPDLOG_ERROR("Failed to find conditional jmp for MotionBlurIntermediate");
+        return std::nullopt;
+    }
+
+    return jcc;
+}
+
+std::optional<GameResolver::StartFrame> GameResolver::find_startframe() {
+    static const auto add_rcx = *Pattern::parse("48 81 C1 ? ? ? ?");
+    static const auto magic = simd::CompiledPattern::compile(Pattern::from_bytes(&detail::STARTFRAME_MAGIC, sizeof(detail::STARTFRAME_MAGIC)));
+
+    std::vector<detail::StartFrameCandidate> candidates{};
+
+    for (const auto ref : find_all_code("FScene::StartFrame.magic", magic)) {
+        candidates.push_back(detail::StartFrameCandidate{ref});
+    }
+
+    // Built up front, otherwise the first candidates would all just wait on the same call_once
+    get_functions();
+    get_xrefs();
+
+    CandidatePipeline<detail::StartFrameCandidate> pipeline{};
+
+    // There's a quirk with this function where it uses a tail jmp
+    // optimization which causes us to unwind to something other than the basic block
+    // found by find_function_start. This is useful for us because it's very obvious
+    pipeline.add_stage("unwind", [this](auto& c) {
+        const auto fn = get_functions().find_function_start(c.magic_ref);
+        c.fn_start_unwind = fn.value_or(0);
+        return fn.has_value();
+    });
+
+    pipeline.add_stage("jmp", [this](auto& c) {
+        const auto jmp = get_xrefs().find_reference(c.fn_start_unwind, XrefIndex::Kind::JMP);
+        c.fn_jmp = jmp.value_or(0);
+        return jmp.has_value();
+    });
+
+    pipeline.add_stage("function", [this](auto& c) {
+        const auto fn = get_functions().find_function_start(c.fn_jmp);
+        c.fn_start = fn.value_or(0);
+        return fn.has_value();
+    });
+
+    // Means it's a virtual function which is what we want.
+    // With RTTI the slot comes straight out of FScene's vtable, otherwise look for any pointer to it in .rdata
+    pipeline.add_stage("vtable", [this](auto& c) {
+        std::optional<uintptr_t> vtable_addr{};
+
+        if (const auto slot = get_rtti().find_slot("FScene", c.fn_start)) {
+            vtable_addr = *get_rtti().find_vtable("FScene") + *slot * sizeof(void*);
+            SPDLOG_INFO("FScene::StartFrame is slot {} of the FScene vtable", *slot);
+        } else {
+            vtable_addr = find_pointer(c.fn_start);
+        }
+
+        c.vtable = vtable_addr.value_or(0);
+        return vtable_addr.has_value();
+    });
+
+    const auto candidate = pipeline.run(std::move(candidates), m_pool);
+
+    SPDLOG_INFO("[Pipeline] FScene::StartFrame: {} in {:.3f}ms",
+        pipeline.describe(),
+        std::chrono::duration<double, std::milli>(pipeline.get_stats().elapsed).count());
+
+    if (!candidate) {
+        return std::nullopt;
+    }
+
+    StartFrame result{};
+    result.fn = candidate->fn_start;
+    result.vtable = candidate->vtable;
+
+    const auto get_frame_count_fn = *(uintptr_t*)(result.vtable + sizeof(void*)); // + 1
+    result.frame_count_offset = *(uint32_t*)(get_frame_count_fn + 2);
+
+    SPDLOG_INFO("FScene::StartFrame vtable func at 0x{:x}", result.vtable);
+    SPDLOG_INFO("FScene::StartFrame frame count offset at 0x{:x}", result.frame_count_offset);
+
+    for (const auto& ix : m_instructions.get_count(result.fn, 20)) {
+        if (add_rcx.matches(ix.bytes())) {
+            result.velocity_data_offset = *(uint32_t*)(ix.address + 3);
+            SPDLOG_INFO("FScene::StartFrame velocity data offset = 0x{:x}", *result.velocity_data_offset);
+            break;
+        }
+    }
+
+    return result;
+}
+
+std::optional<uintptr_t> GameResolver::find_update_transform() {
+    return find_signature("FVelocityData::UpdateTransform", detail::UPDATE_TRANSFORM.anchored());
+}
+
+std::optional<uintptr_t> GameResolver::find_update_all_primitive_scene_infos(uintptr_t update_transform) {
+    const auto call_ref = get_xrefs().find_reference(update_transform, XrefIndex::Kind::CALL);
+
+    if (!call_ref) {
+        return std::nullopt;
+    }
+
+    return get_functions().find_function_start(*call_ref);
+}
+}
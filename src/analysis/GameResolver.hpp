@@ -0,0 +1,147 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AnchorScan.hpp"
+#include "Fingerprint.hpp"
+#include "FunctionTable.hpp"
+#include "HintScan.hpp"
+#include "InstructionCache.hpp"
+#include "MultiScanner.hpp"
+#include "RttiIndex.hpp"
+#include "SharedScanState.hpp"
+#include "SimdScan.hpp"
+#include "StringIndex.hpp"
+#include "WorkPool.hpp"
+#include "XrefIndex.hpp"
+
+namespace analysis {
+class ScanCache;
+
+// Everything FF7Plugin needs to find in the game executable, independent of how the image got into memory.
+// The plugin runs it against the live process, tools/ScanHarness.cpp against a MappedImage from disk.
+//
+// The indexes are built lazily and are safe to share between threads, so the find_* functions
+// can run concurrently. Caching the results is up to the caller.
+class GameResolver {
+public:
+    struct StartFrame {
+        uintptr_t fn{};
+        uintptr_t vtable{}; // address of the StartFrame slot in the FScene vtable
+        uint32_t frame_count_offset{};
+        std::optional<uint32_t> velocity_data_offset{};
+    };
+
+    // Where a signature turned up relative to its hint from the last run.
+    struct HintResult {
+        std::string name{};
+        uint32_t hint{};
+        uint32_t rva{};
+        HintWindow window{};
+        std::chrono::nanoseconds elapsed{};
+    };
+
+    // cache is optional. It persists the function table and provides the hints for find_signature.
+    // shared is optional too, indexes published by a previous instance in the same process get restored from it instead of being built.
+    // With a pool, module-wide pattern scans get split up across it (see ParallelScan.hpp). It has to outlive the resolver.
+    explicit GameResolver(uintptr_t module, ScanCache* cache = nullptr, const SharedScanState* shared = nullptr, WorkPool* pool = nullptr)
+        : m_module{module},
+        m_cache{cache},
+        m_shared{shared},
+        m_pool{pool}
+    {
+    }
+
+    uintptr_t get_module() const {
+        return m_module;
+    }
+
+    WorkPool* get_work_pool() const {
+        return m_pool;
+    }
+
+    const MultiScanner& get_signatures();
+    const XrefIndex& get_xrefs();
+    const StringIndex& get_strings();
+    const FunctionTable& get_functions();
+    const RttiIndex& get_rtti();
+    const FingerprintIndex& get_fingerprints();
+
+    // The indexes built (or restored) so far, for SharedScanState::publish.
+    // Must not run concurrently with anything that could still be building them.
+    std::vector<SharedScanState::Blob> serialize_indexes() const;
+
+    // Shared by every find_* that disassembles, so the same function is only decoded once.
+    InstructionCache& get_instructions() {
+        return m_instructions;
+    }
+
+    // Containing function of addr, with a call target heuristic for leaf functions that have no unwind info.
+    std::optional<uintptr_t> find_function_start(uintptr_t addr);
+    std::optional<uintptr_t> find_string_ref(std::wstring_view str);
+    std::optional<uintptr_t> find_function_from_string(std::wstring_view str);
+
+    // Unique match of pattern, looked for around the RVA the cache last saw for name before scanning the whole module.
+    std::optional<uintptr_t> find_signature(std::string_view name, const AnchoredPattern& pattern);
+    std::vector<HintResult> get_hint_results() const;
+
+    // Fingerprint of the function starting at fn, up to the end of its unwind info.
+    std::optional<Fingerprint> fingerprint_function(uintptr_t fn);
+
+    // Stores fn's fingerprint under name, so find_function_by_fingerprint can port it to the next build.
+    void remember_function(std::string_view name, uintptr_t fn);
+
+    // Function in this build most like the one last remembered under name, if the match is convincing enough.
+    std::optional<uintptr_t> find_function_by_fingerprint(std::string_view name);
+
+    static constexpr float MIN_FINGERPRINT_CONFIDENCE = 0.85f;
+    static constexpr float MIN_FINGERPRINT_MARGIN = 0.05f;
+
+    // The inc dword ptr [GFrameNumberRenderThread] instruction.
+    std::optional<uintptr_t> find_frame_number_increment();
+    std::optional<uintptr_t> find_render_composite_layer();
+    std::optional<uintptr_t> find_post_process_settings();
+    std::optional<uintptr_t> find_motion_blur_jcc();
+    std::optional<StartFrame> find_startframe();
+    std::optional<uintptr_t> find_update_transform();
+    std::optional<uintptr_t> find_update_all_primitive_scene_infos(uintptr_t update_transform);
+
+    // Target of the rel32 displacement at addr.
+    static uintptr_t calculate_absolute(uintptr_t addr, size_t offset = 4) {
+        return addr + offset + *(const int32_t*)addr;
+    }
+
+private:
+    std::optional<uintptr_t> find_pointer(uintptr_t value);
+    std::vector<uintptr_t> find_all_code(std::string_view what, const simd::CompiledPattern& pattern);
+    void record_hint(HintResult result);
+
+    uintptr_t m_module{};
+    ScanCache* m_cache{nullptr};
+    const SharedScanState* m_shared{nullptr};
+    WorkPool* m_pool{nullptr};
+
+    MultiScanner m_signatures{};
+    std::once_flag m_signatures_once{};
+    XrefIndex m_xrefs{};
+    std::once_flag m_xrefs_once{};
+    StringIndex m_strings{};
+    std::once_flag m_strings_once{};
+    FunctionTable m_functions{};
+    std::once_flag m_functions_once{};
+    RttiIndex m_rtti{};
+    std::once_flag m_rtti_once{};
+    FingerprintIndex m_fingerprints{};
+    std::once_flag m_fingerprints_once{};
+    InstructionCache m_instructions{};
+
+    mutable std::mutex m_hint_results_mutex{};
+    std::vector<HintResult> m_hint_results{};
+};
+}
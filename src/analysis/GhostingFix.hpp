@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace analysis {
+// VR state the velocity hooks decide on, refreshed once per engine tick.
+struct GhostingFixState {
+    bool hmd_active{};
+    bool native_stereo{};
+    bool enabled{}; // VR_GhostingFix
+
+    bool operator==(const GhostingFixState&) const = default;
+};
+
+// Synchronized sequential rendering renders every eye in its own frame, so velocities computed every frame
+// come out as the difference between the two eyes. Only letting the velocity data advance every other
+// frame makes both eyes see the same previous transforms.
+inline bool is_ghosting_fix_active(const GhostingFixState& state) {
+    return state.hmd_active && !state.native_stereo && state.enabled;
+}
+
+// FScene::StartFrame
+inline bool should_start_frame(const GhostingFixState& state, uint32_t frame_number) {
+    return !is_ghosting_fix_active(state) || frame_number % 2 == 0;
+}
+
+// FVelocityData::UpdateTransform, skipped on odd frames outside native stereo even with the fix turned off.
+inline bool should_update_transform(const GhostingFixState& state, uint32_t frame_number) {
+    return !state.hmd_active || state.native_stereo || frame_number % 2 == 0;
+}
+}
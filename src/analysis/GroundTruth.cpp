@@ -0,0 +1,75 @@
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <spdlog/spdlog.h>
+
+#include "GroundTruth.hpp"
+
+namespace analysis {
+std::optional<GroundTruth> GroundTruth::load(const std::filesystem::path& path) {
+    std::ifstream f{path};
+
+    if (!f) {
+        SPDLOG_ERROR("[GroundTruth] Failed to open {}", path.string());
+        return std::nullopt;
+    }
+
+    GroundTruth result{};
+    std::string line{};
+
+    for (size_t line_number = 1; std::getline(f, line); ++line_number) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields{line};
+        std::string name{};
+        std::string value{};
+
+        // Names never contain whitespace, they're C++ qualified names
+        if (!(fields >> name >> value)) {
+            SPDLOG_ERROR("[GroundTruth] {}:{}: expected \"<name> <value>\"", path.string(), line_number);
+            return std::nullopt;
+        }
+
+        char* end = nullptr;
+        const auto parsed = std::strtoull(value.c_str(), &end, 0);
+
+        if (end == value.c_str() || *end != '\0') {
+            SPDLOG_ERROR("[GroundTruth] {}:{}: \"{}\" is not a number", path.string(), line_number, value);
+            return std::nullopt;
+        }
+
+        result.m_entries[name] = parsed;
+    }
+
+    return result;
+}
+
+bool GroundTruth::save(const std::filesystem::path& path) const {
+    std::ofstream f{path, std::ios::trunc};
+
+    if (!f) {
+        SPDLOG_ERROR("[GroundTruth] Failed to open {} for writing", path.string());
+        return false;
+    }
+
+    f << "# <name> <value>, RVAs except for .offset entries and the corpus.* parameters\n";
+
+    for (const auto& [name, value] : m_entries) {
+        f << name << " 0x" << std::hex << value << std::dec << '\n';
+    }
+
+    return (bool)f;
+}
+
+void GroundTruth::set(std::string_view name, uint64_t value) {
+    m_entries[std::string{name}] = value;
+}
+
+std::optional<uint64_t> GroundTruth::get(std::string_view name) const {
+    const auto it = m_entries.find(std::string{name});
+    return it != m_entries.end() ? std::optional<uint64_t>{it->second} : std::nullopt;
+}
+}
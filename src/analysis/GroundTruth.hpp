@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace analysis {
+// Known answers for a synthetic image, written by corpus_gen next to the image it describes.
+// Keyed by the same names the plugin uses for its scan cache, values are RVAs or plain numbers (offsets).
+// Plain text so it can be diffed and edited by hand: one "<name> <value>" per line, # starts a comment.
+class GroundTruth {
+public:
+    static std::optional<GroundTruth> load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path) const;
+
+    void set(std::string_view name, uint64_t value);
+    std::optional<uint64_t> get(std::string_view name) const;
+
+    const std::map<std::string, uint64_t>& get_entries() const {
+        return m_entries;
+    }
+
+private:
+    std::map<std::string, uint64_t> m_entries{};
+};
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <vector>
+
+#include "HintScan.hpp"
+
+namespace analysis {
+namespace detail {
+constexpr size_t WINDOW_64K = 64 * 1024;
+constexpr size_t WINDOW_1M = 1024 * 1024;
+
+// Matches starting in [begin, end), the pattern itself may run past end up to limit.
+void find_starting_in(const uint8_t* begin, const uint8_t* end, const uint8_t* limit, const AnchoredPattern& pattern, std::vector<uintptr_t>& out) {
+    if (begin >= end) {
+        return;
+    }
+
+    const auto scan_end = std::min(limit, end + pattern.size - 1);
+    find_all(begin, (size_t)(scan_end - begin), pattern, out);
+}
+}
+
+const char* to_string(HintWindow window) {
+    switch (window) {
+    case HintWindow::WITHIN_64K:
+        return "within 64 KB";
+    case HintWindow::WITHIN_1M:
+        return "within 1 MB";
+    case HintWindow::SECTION:
+        return "section";
+    case HintWindow::MODULE:
+        return "module";
+    default:
+        return "unknown";
+    }
+}
+
+std::optional<HintMatch> find_near_hint(uintptr_t module, std::span<const ScanRegion> regions, uint32_t hint, const AnchoredPattern& pattern) {
+    const auto center = (const uint8_t*)module + hint;
+    const auto region = std::find_if(regions.begin(), regions.end(), [&](const ScanRegion& r) {
+        return center >= r.begin && center < r.begin + r.size;
+    });
+
+    if (region == regions.end() || pattern.size == 0) {
+        return std::nullopt;
+    }
+
+    const auto region_end = region->begin + region->size;
+
+    // [lo, hi) is where every match start has already been collected
+    auto lo = center;
+    auto hi = center;
+    std::vector<uintptr_t> matches{};
+
+    for (const auto window : {HintWindow::WITHIN_64K, HintWindow::WITHIN_1M, HintWindow::SECTION}) {
+        const auto radius = window == HintWindow::WITHIN_64K ? detail::WINDOW_64K : window == HintWindow::WITHIN_1M ? detail::WINDOW_1M : region->size;
+        const auto new_lo = (size_t)(center - region->begin) > radius ? center - radius : region->begin;
+        const auto new_hi = (size_t)(region_end - center) > radius ? center + radius : region_end;
+
+        detail::find_starting_in(new_lo, lo, region_end, pattern, matches);
+        detail::find_starting_in(hi, new_hi, region_end, pattern, matches);
+
+        lo = new_lo;
+        hi = new_hi;
+
+        // A bigger window can only add more
+        if (matches.size() > 1) {
+            return std::nullopt;
+        }
+
+        if (matches.size() == 1) {
+            return HintMatch{matches.front(), window};
+        }
+    }
+
+    return std::nullopt;
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "AnchorScan.hpp"
+#include "ScanRegion.hpp"
+
+namespace analysis {
+// How far from its previous RVA a target turned up. Patches mostly shift code around a little,
+// so the smallest window usually does it.
+enum class HintWindow : uint8_t {
+    WITHIN_64K,
+    WITHIN_1M,
+    SECTION,    // somewhere else in the same section
+    MODULE,     // only found by a full scan
+};
+
+const char* to_string(HintWindow window);
+
+struct HintMatch {
+    uintptr_t address{};
+    HintWindow window{};
+};
+
+// Searches windows of growing size around module + hint, clipped to the region containing it,
+// and returns as soon as one of them has exactly one match. Every byte is searched at most once.
+// Gives up if the hint is outside of regions, nothing matches, or more than one match shows up.
+std::optional<HintMatch> find_near_hint(uintptr_t module, std::span<const ScanRegion> regions, uint32_t hint, const AnchoredPattern& pattern);
+}
@@ -0,0 +1,75 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#endif
+
+#include "HookGate.hpp"
+
+namespace analysis {
+const char* to_string(HookState state) {
+    switch (state) {
+    case HookState::PENDING:
+        return "pending";
+    case HookState::INSTALLING:
+        return "installing";
+    case HookState::LIVE:
+        return "live";
+    case HookState::FAILED:
+        return "failed";
+    default:
+        return "unknown";
+    }
+}
+
+std::chrono::nanoseconds get_process_uptime() {
+#ifdef _WIN32
+    FILETIME creation{}, exit{}, kernel{}, user{};
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return {};
+    }
+
+    FILETIME now{};
+    GetSystemTimeAsFileTime(&now);
+
+    const auto to_u64 = [](const FILETIME& ft) { return (uint64_t)ft.dwHighDateTime << 32 | ft.dwLowDateTime; };
+
+    // FILETIME is in 100ns units
+    return std::chrono::nanoseconds{(int64_t)(to_u64(now) - to_u64(creation)) * 100};
+#else
+    // Field 22 of /proc/self/stat is the start time in clock ticks since boot.
+    // Counted from the end of the command name, which can contain spaces itself
+    std::ifstream stat{"/proc/self/stat"};
+    std::ifstream uptime{"/proc/uptime"};
+    std::string line{};
+    double seconds_since_boot = 0.0;
+
+    if (!std::getline(stat, line) || !(uptime >> seconds_since_boot)) {
+        return {};
+    }
+
+    const auto comm_end = line.rfind(')');
+
+    if (comm_end == std::string::npos) {
+        return {};
+    }
+
+    std::istringstream fields{line.substr(comm_end + 1)};
+    std::string field{};
+
+    for (int i = 3; i <= 22 && fields >> field; ++i) {
+    }
+
+    if (!fields) {
+        return {};
+    }
+
+    const auto started = std::stod(field) / (double)sysconf(_SC_CLK_TCK);
+    return std::chrono::nanoseconds{(int64_t)((seconds_since_boot - started) * 1e9)};
+#endif
+}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include <immintrin.h>
+
+namespace analysis {
+enum class HookState : uint8_t {
+    PENDING,    // not resolved or not installed yet
+    INSTALLING, // the detour may already be running, the trampoline might not be stored yet
+    LIVE,
+    FAILED,
+};
+
+const char* to_string(HookState state);
+
+// Time since the process was created, for reporting when hooks went live relative to game startup.
+std::chrono::nanoseconds get_process_uptime();
+
+// Readiness of one inline hook, shared between the thread installing it and the detour.
+// Until the gate is live the detour is expected to call straight through to the original,
+// without touching any plugin state that might not be resolved yet.
+template <typename Fn>
+class HookGate {
+public:
+    static_assert(std::atomic<Fn>::is_always_lock_free && sizeof(std::atomic<Fn>) == sizeof(void*));
+
+    // Where register_inline_hook stores the trampoline.
+    void** get_original_slot() {
+        return (void**)&m_original;
+    }
+
+    // register_inline_hook stores the trampoline right after writing the detour, so a detour entered in between
+    // (the gate is INSTALLING then) spins for it. That's a handful of instructions on the installing thread,
+    // the original has to run either way: skipping it would leave the engine with whatever it expected it to do undone.
+    Fn get_original() const {
+        auto fn = m_original.load(std::memory_order_acquire);
+
+        while (fn == nullptr) [[unlikely]] {
+            _mm_pause();
+            fn = m_original.load(std::memory_order_acquire);
+        }
+
+        return fn;
+    }
+
+    template <typename... Args>
+    auto call_original(Args&&... args) const {
+        return get_original()(std::forward<Args>(args)...);
+    }
+
+    HookState get_state() const {
+        return m_state.load(std::memory_order_acquire);
+    }
+
+    bool is_live() const {
+        return get_state() == HookState::LIVE;
+    }
+
+    void set_state(HookState state) {
+        if (state == HookState::LIVE) {
+            m_live_time = get_process_uptime();
+        }
+
+        m_state.store(state, std::memory_order_release);
+    }
+
+    // Process uptime at the moment set_state(LIVE) was called, zero if it never was.
+    std::chrono::nanoseconds get_live_time() const {
+        return is_live() ? m_live_time : std::chrono::nanoseconds{};
+    }
+
+private:
+    std::atomic<Fn> m_original{nullptr};
+    std::atomic<HookState> m_state{HookState::PENDING};
+    std::chrono::nanoseconds m_live_time{};
+};
+}
@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <thread>
+
+#include "HookTrace.hpp"
+
+namespace analysis {
+namespace {
+// Largest a FRAME record can get: type, frame number delta, state bits
+constexpr size_t MAX_FRAME_RECORD_SIZE = 1 + 10 + 1;
+
+// Anything bigger than this isn't a block we wrote
+constexpr size_t MAX_BLOCK_SIZE = TraceRecorder::MAX_BUFFERED * 2;
+
+std::atomic<uint64_t> g_next_recorder_id{1};
+
+uint64_t zigzag(uint64_t delta) {
+    return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+}
+
+uint64_t unzigzag(uint64_t value) {
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+uint8_t pack_state(const GhostingFixState& state) {
+    return (uint8_t)((state.hmd_active ? 1 : 0) | (state.native_stereo ? 2 : 0) | (state.enabled ? 4 : 0));
+}
+
+GhostingFixState unpack_state(uint8_t bits) {
+    return {(bits & 1) != 0, (bits & 2) != 0, (bits & 4) != 0};
+}
+
+enum CopyFlags : uint8_t {
+    HAS_DEST_STARTS = 1 << 0,
+    HAS_DEST_SIZES = 1 << 1,
+    HAS_SRC_STARTS = 1 << 2,
+    HAS_SRC_SIZES = 1 << 3,
+};
+
+// Copies num values out of the caller's array into scratch, null stays null
+template <typename T>
+const T* copy_out(std::vector<T>& scratch, const T* values, size_t num) {
+    if (values == nullptr) {
+        return nullptr;
+    }
+
+    scratch.resize(num);
+    std::copy_n(values, num, scratch.data());
+
+    return scratch.data();
+}
+}
+
+const char* to_string(TraceRecordType type) {
+    switch (type) {
+    case TraceRecordType::FRAME:
+        return "frame";
+    case TraceRecordType::COPY_DESCRIPTORS:
+        return "CDevice::CopyDescriptors";
+    case TraceRecordType::START_FRAME:
+        return "FScene::StartFrame";
+    case TraceRecordType::UPDATE_TRANSFORM:
+        return "FVelocityData::UpdateTransform";
+    case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+        return "FScene::GetPrimitiveUniformShaderParameters_RenderThread";
+    case TraceRecordType::DESCRIPTOR_HEAP_CREATED:
+        return "CDevice::CreateDescriptorHeap";
+    case TraceRecordType::DESCRIPTOR_HEAP_RELEASED:
+        return "CDescriptorHeap::Release";
+    default:
+        return "?";
+    }
+}
+
+// Writes one record into a locked thread buffer. Grows it by the most the record can take up front,
+// so nothing has to be bounds checked while encoding, and shrinks it back to what was written at the end.
+class TraceRecorder::Encoder {
+public:
+    Encoder(ThreadBuffer& buffer, size_t max_size)
+        : m_buffer{buffer}
+    {
+        const auto start = buffer.bytes.size();
+        buffer.bytes.resize(start + max_size);
+        m_p = buffer.bytes.data() + start;
+    }
+
+    ~Encoder() {
+        m_buffer.bytes.resize((size_t)(m_p - m_buffer.bytes.data()));
+        ++m_buffer.records;
+    }
+
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    void byte(uint8_t value) {
+        *m_p++ = value;
+    }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            *m_p++ = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+
+        *m_p++ = (uint8_t)value;
+    }
+
+    void delta(TraceStream stream, uint64_t value) {
+        auto& previous = m_buffer.previous[(size_t)stream];
+        varint(zigzag(value - previous));
+        previous = value;
+    }
+
+private:
+    ThreadBuffer& m_buffer;
+    uint8_t* m_p{};
+};
+
+TraceRecorder::TraceRecorder(const std::filesystem::path& path)
+    : m_id{g_next_recorder_id.fetch_add(1, std::memory_order_relaxed)},
+    m_file{path, std::ios::binary | std::ios::trunc}
+{
+    if (!m_file) {
+        return;
+    }
+
+    const TraceFileHeader header{};
+    m_file.write((const char*)&header, sizeof(header));
+    m_open = m_file.good();
+}
+
+// Runs in DLL_PROCESS_DETACH in the plugin, where whoever held the write mutex may have been terminated with it.
+TraceRecorder::~TraceRecorder() {
+    if (std::unique_lock lock{m_write_mutex, std::try_to_lock}; lock.owns_lock() && m_open) {
+        write_buffers();
+    }
+}
+
+// Claimed on a thread's first record and kept until the recorder goes away. Null once every slot is taken.
+TraceRecorder::ThreadBuffer* TraceRecorder::get_thread_buffer() {
+    struct Cached {
+        uint64_t recorder{};
+        ThreadBuffer* buffer{};
+    };
+
+    // Recorder ids are never reused, so a thread can't mistake a new recorder at the same address for the old one
+    static thread_local Cached t_cached{};
+
+    if (t_cached.recorder == m_id) {
+        return t_cached.buffer;
+    }
+
+    const auto i = m_claimed.fetch_add(1, std::memory_order_acq_rel);
+    t_cached = {m_id, i < MAX_THREADS ? &m_buffers[i] : nullptr};
+
+    return t_cached.buffer;
+}
+
+// Locks this thread's buffer if there's room for max_size more bytes in it, counts the record as dropped otherwise.
+TraceRecorder::ThreadBuffer* TraceRecorder::lock_thread_buffer(size_t max_size) {
+    if (!m_open) {
+        return nullptr;
+    }
+
+    const auto buffer = get_thread_buffer();
+
+    if (buffer == nullptr) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Only ever contended for as long as it takes the writer to swap the buffer out
+    while (buffer->busy.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    if (buffer->bytes.size() + MAX_FRAME_RECORD_SIZE + max_size > MAX_BUFFERED) {
+        buffer->busy.store(false, std::memory_order_release);
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return buffer;
+}
+
+void TraceRecorder::unlock_thread_buffer(ThreadBuffer& buffer) {
+    buffer.busy.store(false, std::memory_order_release);
+}
+
+void TraceRecorder::write_frame(ThreadBuffer& buffer, const TraceFrame& frame) {
+    if (buffer.has_frame && buffer.frame == frame) {
+        return;
+    }
+
+    buffer.has_frame = true;
+    buffer.frame = frame;
+
+    Encoder e{buffer, MAX_FRAME_RECORD_SIZE};
+    e.byte((uint8_t)TraceRecordType::FRAME);
+    e.delta(TraceStream::FRAME, frame.number);
+    e.byte(pack_state(frame.state));
+}
+
+// Only stores when the frame changed, the driver threads read this on every CopyDescriptors call
+void TraceRecorder::set_frame(const TraceFrame& frame) {
+    const auto packed = frame.number | ((uint64_t)pack_state(frame.state) << 32);
+
+    if (m_frame.load(std::memory_order_relaxed) != packed) {
+        m_frame.store(packed, std::memory_order_relaxed);
+    }
+}
+
+TraceFrame TraceRecorder::get_frame() const {
+    const auto frame = m_frame.load(std::memory_order_relaxed);
+    return {(uint32_t)frame, unpack_state((uint8_t)(frame >> 32))};
+}
+
+void TraceRecorder::record_copy_descriptors(const void* device, uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t type)
+{
+    // The caller's arrays are what may fault in CopyDescriptors, so they get read before the buffer is locked.
+    // A fault while holding it would leave it locked for good.
+    struct Scratch {
+        std::vector<uint64_t> dest_starts{};
+        std::vector<uint32_t> dest_sizes{};
+        std::vector<uint64_t> src_starts{};
+        std::vector<uint32_t> src_sizes{};
+    };
+
+    static thread_local Scratch t_scratch{};
+
+    dest_sizes = dest_starts != nullptr ? copy_out(t_scratch.dest_sizes, dest_sizes, num_dest) : nullptr;
+    dest_starts = copy_out(t_scratch.dest_starts, dest_starts, num_dest);
+    src_sizes = src_starts != nullptr ? copy_out(t_scratch.src_sizes, src_sizes, num_src) : nullptr;
+    src_starts = copy_out(t_scratch.src_starts, src_starts, num_src);
+
+    // Every range is at most a 10 byte handle delta and a 5 byte size
+    const auto dest_ranges = dest_starts != nullptr ? (size_t)num_dest : 0;
+    const auto src_ranges = src_starts != nullptr ? (size_t)num_src : 0;
+    const auto max_size = 1 + 5 + 5 + 5 + 1 + 10 + (dest_ranges + src_ranges) * 15;
+
+    const auto buffer = lock_thread_buffer(max_size);
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    write_frame(*buffer, get_frame());
+
+    {
+        const uint8_t flags = (dest_starts != nullptr ? HAS_DEST_STARTS : 0) | (dest_starts != nullptr && dest_sizes != nullptr ? HAS_DEST_SIZES : 0) |
+            (src_starts != nullptr ? HAS_SRC_STARTS : 0) | (src_starts != nullptr && src_sizes != nullptr ? HAS_SRC_SIZES : 0);
+
+        Encoder e{*buffer, max_size};
+        e.byte((uint8_t)TraceRecordType::COPY_DESCRIPTORS);
+        e.varint(num_dest);
+        e.varint(num_src);
+        e.varint(type);
+        e.byte(flags);
+        e.delta(TraceStream::DEVICE, (uint64_t)device);
+
+        for (size_t i = 0; i < dest_ranges; ++i) {
+            e.delta(TraceStream::DEST_HANDLE, dest_starts[i]);
+
+            if ((flags & HAS_DEST_SIZES) != 0) {
+                e.varint(dest_sizes[i]);
+            }
+        }
+
+        for (size_t i = 0; i < src_ranges; ++i) {
+            e.delta(TraceStream::SRC_HANDLE, src_starts[i]);
+
+            if ((flags & HAS_SRC_SIZES) != 0) {
+                e.varint(src_sizes[i]);
+            }
+        }
+    }
+
+    unlock_thread_buffer(*buffer);
+}
+
+void TraceRecorder::record_call(TraceRecordType type, const TraceFrame& frame, const void* self, const void* a2, const void* a3, const void* a4) {
+    set_frame(frame);
+
+    const auto buffer = lock_thread_buffer(1 + 4 * 10);
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    write_frame(*buffer, frame);
+
+    {
+        Encoder e{*buffer, 1 + 4 * 10};
+        e.byte((uint8_t)type);
+        e.delta(TraceStream::SELF, (uint64_t)self);
+        e.delta(TraceStream::ARG2, (uint64_t)a2);
+        e.delta(TraceStream::ARG3, (uint64_t)a3);
+        e.delta(TraceStream::ARG4, (uint64_t)a4);
+    }
+
+    unlock_thread_buffer(*buffer);
+}
+
+void TraceRecorder::record_start_frame(const TraceFrame& frame, const void* scene, const void* a2, const void* a3, const void* a4) {
+    record_call(TraceRecordType::START_FRAME, frame, scene, a2, a3, a4);
+}
+
+void TraceRecorder::record_update_transform(const TraceFrame& frame, const void* velocity_data, const void* a2, const void* a3, const void* a4) {
+    record_call(TraceRecordType::UPDATE_TRANSFORM, frame, velocity_data, a2, a3, a4);
+}
+
+void TraceRecorder::record_primitive_uniform_shader_parameters(const TraceFrame& frame, const void* scene, const void* primitive_scene_info,
+    const void* a3, const void* previous_local_to_world, uint32_t primitive_id, uint32_t scene_frame_count)
+{
+    set_frame(frame);
+
+    constexpr size_t max_size = 1 + 4 * 10 + 5 + 10;
+    const auto buffer = lock_thread_buffer(max_size);
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    write_frame(*buffer, frame);
+
+    {
+        Encoder e{*buffer, max_size};
+        e.byte((uint8_t)TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS);
+        e.delta(TraceStream::SELF, (uint64_t)scene);
+        e.delta(TraceStream::ARG2, (uint64_t)primitive_scene_info);
+        e.delta(TraceStream::ARG3, (uint64_t)a3);
+        e.delta(TraceStream::ARG4, (uint64_t)previous_local_to_world);
+        e.varint(primitive_id);
+        e.delta(TraceStream::SCENE_FRAME_COUNT, scene_frame_count);
+    }
+
+    unlock_thread_buffer(*buffer);
+}
+
+void TraceRecorder::record_descriptor_heap_created(const DescriptorHeapRange& range) {
+    constexpr size_t max_size = 1 + 10 + 10 + 5 + 5 + 5;
+    const auto buffer = lock_thread_buffer(max_size);
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    write_frame(*buffer, get_frame());
+
+    {
+        Encoder e{*buffer, max_size};
+        e.byte((uint8_t)TraceRecordType::DESCRIPTOR_HEAP_CREATED);
+        e.delta(TraceStream::HEAP, (uint64_t)range.heap);
+        e.delta(TraceStream::HEAP_BASE, range.base);
+        e.varint(range.count);
+        e.varint(range.increment);
+        e.varint(range.type);
+    }
+
+    unlock_thread_buffer(*buffer);
+}
+
+void TraceRecorder::record_descriptor_heap_released(const void* heap) {
+    const auto buffer = lock_thread_buffer(1 + 10);
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    write_frame(*buffer, get_frame());
+
+    {
+        Encoder e{*buffer, 1 + 10};
+        e.byte((uint8_t)TraceRecordType::DESCRIPTOR_HEAP_RELEASED);
+        e.delta(TraceStream::HEAP, (uint64_t)heap);
+    }
+
+    unlock_thread_buffer(*buffer);
+}
+
+void TraceRecorder::poll() {
+    std::scoped_lock _{m_write_mutex};
+
+    if (const auto now = std::chrono::steady_clock::now(); m_open && now - m_last_write >= FLUSH_INTERVAL) {
+        write_buffers();
+        m_last_write = now;
+    }
+}
+
+void TraceRecorder::flush() {
+    std::scoped_lock _{m_write_mutex};
+
+    if (m_open) {
+        write_buffers();
+        m_last_write = std::chrono::steady_clock::now();
+    }
+}
+
+// Swaps every non-empty buffer with m_spare and writes it out as a block. The buffer's delta state starts over,
+// so the next block decodes without this one. A buffer that's in the middle of a record waits for the next call,
+// nothing here waits on a hook.
+void TraceRecorder::write_buffers() {
+    const auto count = std::min(m_claimed.load(std::memory_order_acquire), MAX_THREADS);
+
+    for (size_t i = 0; i < count; ++i) {
+        auto& buffer = m_buffers[i];
+
+        if (buffer.busy.exchange(true, std::memory_order_acquire)) {
+            continue;
+        }
+
+        if (buffer.bytes.empty()) {
+            buffer.busy.store(false, std::memory_order_release);
+            continue;
+        }
+
+        std::swap(buffer.bytes, m_spare);
+
+        const TraceBlockHeader header{(uint32_t)m_spare.size(), (uint32_t)i, buffer.records};
+
+        buffer.records = 0;
+        buffer.has_frame = false;
+        buffer.previous = {};
+        buffer.busy.store(false, std::memory_order_release);
+
+        m_file.write((const char*)&header, sizeof(header));
+        m_file.write((const char*)m_spare.data(), (std::streamsize)m_spare.size());
+
+        m_bytes_written.fetch_add(sizeof(header) + m_spare.size(), std::memory_order_relaxed);
+        m_records.fetch_add(header.records, std::memory_order_relaxed);
+        m_spare.clear();
+    }
+
+    m_file.flush();
+}
+
+TraceReader::TraceReader(const std::filesystem::path& path)
+    : m_file{path, std::ios::binary}
+{
+    TraceFileHeader header{};
+
+    if (!m_file.read((char*)&header, sizeof(header))) {
+        return;
+    }
+
+    m_open = header.magic == TraceFileHeader::MAGIC && header.version == TraceFileHeader::VERSION;
+}
+
+bool TraceReader::next_block() {
+    TraceBlockHeader header{};
+
+    if (!m_file.read((char*)&header, sizeof(header))) {
+        // Ending in the middle of a header means the file got cut off
+        m_corrupt = m_file.gcount() != 0;
+        return false;
+    }
+
+    if (header.size == 0 || header.size > MAX_BLOCK_SIZE) {
+        m_corrupt = true;
+        return false;
+    }
+
+    m_block.resize(header.size);
+
+    if (!m_file.read((char*)m_block.data(), header.size)) {
+        m_corrupt = true;
+        return false;
+    }
+
+    m_pos = 0;
+    m_thread = header.thread;
+    m_frame = {};
+    m_previous = {};
+    ++m_blocks;
+
+    return true;
+}
+
+bool TraceReader::read_varint(uint64_t& value) {
+    value = 0;
+
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (m_pos >= m_block.size()) {
+            return false;
+        }
+
+        const auto b = m_block[m_pos++];
+        value |= (uint64_t)(b & 0x7F) << shift;
+
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TraceReader::read_delta(TraceStream stream, uint64_t& value) {
+    if (!read_varint(value)) {
+        return false;
+    }
+
+    auto& previous = m_previous[(size_t)stream];
+    value = previous + unzigzag(value);
+    previous = value;
+
+    return true;
+}
+
+bool TraceReader::read_ranges(uint32_t num, bool has_sizes, TraceStream stream, std::vector<uint64_t>& starts, std::vector<uint32_t>& sizes) {
+    // Every range takes at least a byte, anything more than what's left can only be garbage
+    if (num > m_block.size() - m_pos) {
+        return false;
+    }
+
+    starts.resize(num);
+    sizes.resize(has_sizes ? num : 0);
+
+    for (uint32_t i = 0; i < num; ++i) {
+        uint64_t size{};
+
+        if (!read_delta(stream, starts[i]) || (has_sizes && !read_varint(size))) {
+            return false;
+        }
+
+        if (has_sizes) {
+            sizes[i] = (uint32_t)size;
+        }
+    }
+
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (!m_open || m_corrupt) {
+        return false;
+    }
+
+    while (true) {
+        while (m_pos >= m_block.size()) {
+            if (!next_block()) {
+                return false;
+            }
+        }
+
+        const auto type = (TraceRecordType)m_block[m_pos++];
+        uint64_t v[6]{};
+        bool ok{};
+
+        switch (type) {
+        case TraceRecordType::FRAME:
+            ok = read_delta(TraceStream::FRAME, v[0]) && m_pos < m_block.size();
+
+            if (ok) {
+                m_frame = {(uint32_t)v[0], unpack_state(m_block[m_pos++])};
+            }
+
+            break;
+
+        case TraceRecordType::COPY_DESCRIPTORS:
+            ok = read_varint(v[0]) && read_varint(v[1]) && read_varint(v[2]) && m_pos < m_block.size();
+
+            if (ok) {
+                const auto flags = m_block[m_pos++];
+
+                record.num_dest = (uint32_t)v[0];
+                record.num_src = (uint32_t)v[1];
+                record.heap_type = (uint32_t)v[2];
+                record.has_dest_starts = (flags & HAS_DEST_STARTS) != 0;
+                record.has_src_starts = (flags & HAS_SRC_STARTS) != 0;
+
+                ok = read_delta(TraceStream::DEVICE, record.self) &&
+                    read_ranges(record.has_dest_starts ? record.num_dest : 0, (flags & HAS_DEST_SIZES) != 0, TraceStream::DEST_HANDLE, record.dest_starts, record.dest_sizes) &&
+                    read_ranges(record.has_src_starts ? record.num_src : 0, (flags & HAS_SRC_SIZES) != 0, TraceStream::SRC_HANDLE, record.src_starts, record.src_sizes);
+            }
+
+            break;
+
+        case TraceRecordType::START_FRAME:
+        case TraceRecordType::UPDATE_TRANSFORM:
+            ok = read_delta(TraceStream::SELF, record.self) && read_delta(TraceStream::ARG2, record.args[0]) &&
+                read_delta(TraceStream::ARG3, record.args[1]) && read_delta(TraceStream::ARG4, record.args[2]);
+            break;
+
+        case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+            ok = read_delta(TraceStream::SELF, record.self) && read_delta(TraceStream::ARG2, record.args[0]) &&
+                read_delta(TraceStream::ARG3, record.args[1]) && read_delta(TraceStream::ARG4, record.args[2]) &&
+                read_varint(v[0]) && read_delta(TraceStream::SCENE_FRAME_COUNT, v[1]);
+
+            record.primitive_id = (uint32_t)v[0];
+            record.scene_frame_count = (uint32_t)v[1];
+            break;
+
+        case TraceRecordType::DESCRIPTOR_HEAP_CREATED:
+            ok = read_delta(TraceStream::HEAP, record.self) && read_delta(TraceStream::HEAP_BASE, record.heap_base) &&
+                read_varint(v[0]) && read_varint(v[1]) && read_varint(v[2]);
+
+            record.heap_count = (uint32_t)v[0];
+            record.heap_increment = (uint32_t)v[1];
+            record.heap_type = (uint32_t)v[2];
+            break;
+
+        case TraceRecordType::DESCRIPTOR_HEAP_RELEASED:
+            ok = read_delta(TraceStream::HEAP, record.self);
+            break;
+
+        default:
+            break;
+        }
+
+        if (!ok) {
+            m_corrupt = true;
+            return false;
+        }
+
+        if (type != TraceRecordType::FRAME) {
+            record.type = type;
+            record.thread = m_thread;
+            record.frame = m_frame;
+
+            return true;
+        }
+    }
+}
+}
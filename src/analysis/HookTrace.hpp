@@ -0,0 +1,242 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DescriptorHeapIndex.hpp"
+#include "GhostingFix.hpp"
+
+// Binary traces of the arguments the plugin's hooks get called with, for replaying real workloads offline (tools/TraceReplay.cpp).
+//
+// File: TraceFileHeader, then any number of blocks. Every block is a TraceBlockHeader followed by the records one thread
+// wrote since the previous block of that thread. Blocks decode on their own, the delta state starts over in each of them.
+// Record: type byte, then its fields as LEB128 varints. Handles and pointers are zigzag encoded deltas against the
+// previous value of the same TraceStream, so a run of handles into the same heap takes a byte or two each.
+// Whenever the frame changes, a thread writes a FRAME record first, and everything after it belongs to that frame.
+// Order across threads is only kept per frame, not within one.
+namespace analysis {
+enum class TraceRecordType : uint8_t {
+    FRAME = 1,                                  // frame number delta, GhostingFixState bits
+    COPY_DESCRIPTORS,                           // CDevice::CopyDescriptors
+    START_FRAME,                                // FScene::StartFrame
+    UPDATE_TRANSFORM,                           // FVelocityData::UpdateTransform
+    PRIMITIVE_UNIFORM_SHADER_PARAMETERS,        // FScene::GetPrimitiveUniformShaderParameters_RenderThread
+    DESCRIPTOR_HEAP_CREATED,                    // CDevice::CreateDescriptorHeap that got tracked
+    DESCRIPTOR_HEAP_RELEASED,                   // final CDescriptorHeap::Release of a tracked heap
+};
+
+const char* to_string(TraceRecordType type);
+
+// Every delta encoded field has its own previous value.
+enum class TraceStream : uint8_t {
+    FRAME,
+    DEVICE,
+    DEST_HANDLE,
+    SRC_HANDLE,
+    SELF,
+    ARG2,
+    ARG3,
+    ARG4,
+    SCENE_FRAME_COUNT,
+    HEAP,
+    HEAP_BASE,
+    COUNT,
+};
+
+struct TraceFrame {
+    uint32_t number{};          // GFrameNumberRenderThread
+    GhostingFixState state{};
+
+    bool operator==(const TraceFrame&) const = default;
+};
+
+struct TraceFileHeader {
+    static constexpr uint32_t MAGIC = 0x54374646; // "FF7T"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic{MAGIC};
+    uint32_t version{VERSION};
+};
+
+struct TraceBlockHeader {
+    uint32_t size{};    // bytes of records that follow
+    uint32_t thread{};  // writer slot, stays the same for the lifetime of a thread
+    uint32_t records{};
+    uint32_t reserved{};
+};
+
+// One decoded record. Only the fields of its type mean anything, the range vectors get reused from record to record.
+struct TraceRecord {
+    TraceRecordType type{};
+    uint32_t thread{};
+    TraceFrame frame{};
+
+    uint64_t self{};        // device, scene, velocity data or descriptor heap
+    uint64_t args[3]{};     // a2..a4, or primitive_scene_info, a3, previous_local_to_world
+
+    // COPY_DESCRIPTORS. Null sizes get recorded as empty size vectors, null starts as has_*_starts = false.
+    uint32_t num_dest{};
+    uint32_t num_src{};
+    uint32_t heap_type{};
+    bool has_dest_starts{};
+    bool has_src_starts{};
+    std::vector<uint64_t> dest_starts{};
+    std::vector<uint32_t> dest_sizes{};
+    std::vector<uint64_t> src_starts{};
+    std::vector<uint32_t> src_sizes{};
+
+    // PRIMITIVE_UNIFORM_SHADER_PARAMETERS
+    uint32_t primitive_id{};
+    uint32_t scene_frame_count{};
+
+    // DESCRIPTOR_HEAP_CREATED, heap is self
+    uint64_t heap_base{};
+    uint32_t heap_count{};
+    uint32_t heap_increment{};
+};
+
+// Records hook calls from any number of threads into a trace file.
+// Every thread encodes into its own buffer (claimed on its first record, guarded by a spin flag that only the
+// writer ever contends on). The owner calls poll() from a background thread, which swaps the buffers out every
+// FLUSH_INTERVAL and writes them as blocks. The plugin uses its drain timer for that, like for the EventLog.
+// A thread that gets MAX_BUFFERED bytes ahead of the writer, or shows up after MAX_THREADS others, has its records dropped.
+class TraceRecorder {
+public:
+    static constexpr size_t MAX_THREADS = 64;
+    static constexpr size_t MAX_BUFFERED = 16 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
+
+    // Truncates path. Records nothing if it can't be opened, see is_open.
+    explicit TraceRecorder(const std::filesystem::path& path);
+
+    // Writes out whatever is still buffered, unless the writer or that thread's buffer is taken.
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool is_open() const {
+        return m_open;
+    }
+
+    // CopyDescriptors doesn't know the frame, its records belong to whichever frame any other hook saw last.
+    // Reads the arrays before locking anything, so a fault on them (in the detour's __try) leaves the recorder usable.
+    void record_copy_descriptors(const void* device, uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+        uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes, uint32_t type);
+
+    void record_start_frame(const TraceFrame& frame, const void* scene, const void* a2, const void* a3, const void* a4);
+    void record_update_transform(const TraceFrame& frame, const void* velocity_data, const void* a2, const void* a3, const void* a4);
+    void record_primitive_uniform_shader_parameters(const TraceFrame& frame, const void* scene, const void* primitive_scene_info,
+        const void* a3, const void* previous_local_to_world, uint32_t primitive_id, uint32_t scene_frame_count);
+
+    void record_descriptor_heap_created(const DescriptorHeapRange& range);
+    void record_descriptor_heap_released(const void* heap);
+
+    // Writes every buffer out if it's been FLUSH_INTERVAL since the last time, meant to be called every few ms.
+    void poll();
+
+    // Swaps out and writes every buffer right away, except ones a thread is recording into at that moment.
+    void flush();
+
+    size_t get_records() const {
+        return m_records.load(std::memory_order_relaxed);
+    }
+
+    size_t get_dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    size_t get_bytes_written() const {
+        return m_bytes_written.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Cache line aligned, neighbouring slots belong to different threads
+    struct alignas(64) ThreadBuffer {
+        std::atomic<bool> busy{false};
+        bool has_frame{};
+        TraceFrame frame{};
+        uint32_t records{};
+        std::array<uint64_t, (size_t)TraceStream::COUNT> previous{};
+        std::vector<uint8_t> bytes{};
+    };
+
+    class Encoder;
+
+    ThreadBuffer* get_thread_buffer();
+    ThreadBuffer* lock_thread_buffer(size_t max_size);
+    void unlock_thread_buffer(ThreadBuffer& buffer);
+    void write_frame(ThreadBuffer& buffer, const TraceFrame& frame);
+    void record_call(TraceRecordType type, const TraceFrame& frame, const void* self, const void* a2, const void* a3, const void* a4);
+    void set_frame(const TraceFrame& frame);
+    TraceFrame get_frame() const;
+
+    void write_buffers();
+
+    uint64_t m_id{};
+    std::ofstream m_file{};
+    bool m_open{};
+
+    std::unique_ptr<std::array<ThreadBuffer, MAX_THREADS>> m_buffers_storage{std::make_unique<std::array<ThreadBuffer, MAX_THREADS>>()};
+    std::array<ThreadBuffer, MAX_THREADS>& m_buffers{*m_buffers_storage};
+    std::atomic<size_t> m_claimed{0};
+
+    // number | state bits << 32
+    std::atomic<uint64_t> m_frame{0};
+
+    std::atomic<size_t> m_records{0};
+    std::atomic<size_t> m_dropped{0};
+    std::atomic<size_t> m_bytes_written{0};
+
+    // Only touched by whoever holds m_write_mutex
+    std::mutex m_write_mutex{};
+    std::vector<uint8_t> m_spare{};
+    std::chrono::steady_clock::time_point m_last_write{std::chrono::steady_clock::now()};
+};
+
+// Reads a trace back one record at a time, in file order.
+class TraceReader {
+public:
+    explicit TraceReader(const std::filesystem::path& path);
+
+    // False if the file couldn't be opened or isn't a trace of this version.
+    bool is_open() const {
+        return m_open;
+    }
+
+    // False at the end of the trace, or at the first thing that doesn't decode (is_corrupt then).
+    bool next(TraceRecord& record);
+
+    bool is_corrupt() const {
+        return m_corrupt;
+    }
+
+    size_t get_blocks() const {
+        return m_blocks;
+    }
+
+private:
+    bool next_block();
+    bool read_varint(uint64_t& value);
+    bool read_delta(TraceStream stream, uint64_t& value);
+    bool read_ranges(uint32_t num, bool has_sizes, TraceStream stream, std::vector<uint64_t>& starts, std::vector<uint32_t>& sizes);
+
+    std::ifstream m_file{};
+    bool m_open{};
+    bool m_corrupt{};
+    size_t m_blocks{};
+
+    std::vector<uint8_t> m_block{};
+    size_t m_pos{};
+    uint32_t m_thread{};
+    TraceFrame m_frame{};
+    std::array<uint64_t, (size_t)TraceStream::COUNT> m_previous{};
+};
+}
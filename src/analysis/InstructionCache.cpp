@@ -0,0 +1,102 @@
+#include <limits>
+#include <mutex>
+
+#include <bddisasm.h>
+
+#include "InstructionCache.hpp"
+
+namespace analysis {
+namespace detail {
+// The first max_instructions instructions of run that start before end.
+std::span<const Instruction> slice(const std::vector<Instruction>& run, uintptr_t end, size_t max_instructions) {
+    const auto limit = std::min(run.size(), max_instructions);
+    const auto it = std::lower_bound(run.begin(), run.begin() + limit, end, [](const Instruction& ix, uintptr_t a) {
+        return ix.address < a;
+    });
+
+    return std::span<const Instruction>{run.data(), (size_t)(it - run.begin())};
+}
+}
+
+std::span<const Instruction> InstructionCache::get(uintptr_t begin, uintptr_t end) {
+    return decode(begin, end, std::numeric_limits<size_t>::max());
+}
+
+std::span<const Instruction> InstructionCache::get_count(uintptr_t begin, size_t max_instructions) {
+    return decode(begin, std::numeric_limits<uintptr_t>::max(), max_instructions);
+}
+
+size_t InstructionCache::size() const {
+    std::shared_lock _{m_mutex};
+    size_t total = 0;
+
+    for (const auto& [begin, run] : m_runs) {
+        total += run->instructions.size();
+    }
+
+    return total;
+}
+
+std::span<const Instruction> InstructionCache::decode(uintptr_t begin, uintptr_t end, size_t max_instructions) {
+    auto run = std::make_unique<Run>();
+
+    {
+        std::shared_lock _{m_mutex};
+
+        if (const auto it = m_runs.find(begin); it != m_runs.end()) {
+            if (it->second->covers(end, max_instructions)) {
+                const auto result = detail::slice(it->second->instructions, end, max_instructions);
+                m_served += result.size();
+                return result;
+            }
+
+            // Too short, carry on from where it stopped instead of starting over
+            run->instructions = it->second->instructions;
+        }
+    }
+
+    const auto reused = run->instructions.size();
+    const auto start = std::chrono::steady_clock::now();
+    auto ip = run->instructions.empty() ? begin : run->instructions.back().end();
+
+    while (!run->covers(end, max_instructions)) {
+        INSTRUX ix{};
+
+        if (!ND_SUCCESS(NdDecodeEx(&ix, (const ND_UINT8*)ip, 16, ND_CODE_64, ND_DATA_64))) {
+            run->stopped = true;
+            break;
+        }
+
+        Instruction insn{};
+        insn.address = ip;
+        insn.length = (uint8_t)ix.Length;
+        insn.flags = (ix.BranchInfo.IsBranch ? Instruction::BRANCH : 0) | (ix.BranchInfo.IsConditional ? Instruction::CONDITIONAL : 0);
+        run->instructions.push_back(insn);
+
+        ip += ix.Length;
+    }
+
+    m_decode_time += (std::chrono::steady_clock::now() - start).count();
+    m_decoded += run->instructions.size() - reused;
+
+    std::unique_lock _{m_mutex};
+    auto& slot = m_runs[begin];
+
+    // Somebody else may have decoded at least as far in the meantime
+    if (slot != nullptr && slot->instructions.size() >= run->instructions.size()) {
+        const auto result = detail::slice(slot->instructions, end, max_instructions);
+        m_served += std::min(result.size(), reused);
+        return result;
+    }
+
+    if (slot != nullptr) {
+        m_retired.push_back(std::move(slot));
+    }
+
+    slot = std::move(run);
+
+    const auto result = detail::slice(slot->instructions, end, max_instructions);
+    m_served += std::min(result.size(), reused);
+    return result;
+}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace analysis {
+// The parts of a decoded instruction the resolvers care about, the raw bytes are still at address.
+struct Instruction {
+    enum Flags : uint8_t {
+        BRANCH = 1 << 0,
+        CONDITIONAL = 1 << 1,
+    };
+
+    uintptr_t address{};
+    uint8_t length{};
+    uint8_t flags{};
+
+    const uint8_t* bytes() const {
+        return (const uint8_t*)address;
+    }
+
+    uintptr_t end() const {
+        return address + length;
+    }
+
+    bool is_conditional_branch() const {
+        return (flags & (BRANCH | CONDITIONAL)) == (BRANCH | CONDITIONAL);
+    }
+};
+
+// Linear sweeps decoded once and shared between every resolver that looks at the same code.
+// A run is keyed by its start address and covers [begin, end) or up to the first undecodable instruction.
+// Spans handed out stay valid for the lifetime of the cache, even if the run gets decoded further later.
+class InstructionCache {
+public:
+    struct Stats {
+        size_t decoded{};   // instructions that went through the decoder
+        size_t served{};    // instructions handed out from an existing run instead of being decoded again
+        std::chrono::nanoseconds decode_time{};
+
+        // Estimate based on the average decode time so far.
+        std::chrono::nanoseconds get_time_saved() const {
+            return decoded != 0 ? decode_time * (int64_t)served / (int64_t)decoded : std::chrono::nanoseconds{};
+        }
+    };
+
+    // Instructions starting at begin, up to end.
+    std::span<const Instruction> get(uintptr_t begin, uintptr_t end);
+
+    // Up to max_instructions starting at begin, for code with no known end.
+    std::span<const Instruction> get_count(uintptr_t begin, size_t max_instructions);
+
+    Stats get_stats() const {
+        return Stats{m_decoded.load(), m_served.load(), std::chrono::nanoseconds{m_decode_time.load()}};
+    }
+
+    size_t size() const;
+
+private:
+    struct Run {
+        std::vector<Instruction> instructions{};
+        bool stopped{false}; // hit something undecodable, there is nothing more to decode
+
+        bool covers(uintptr_t end, size_t max_instructions) const {
+            return stopped || instructions.size() >= max_instructions || (!instructions.empty() && instructions.back().end() >= end);
+        }
+    };
+
+    std::span<const Instruction> decode(uintptr_t begin, uintptr_t end, size_t max_instructions);
+
+    mutable std::shared_mutex m_mutex{};
+    std::unordered_map<uintptr_t, std::unique_ptr<Run>> m_runs{};
+    std::vector<std::unique_ptr<Run>> m_retired{}; // superseded runs, kept alive for spans still in use
+
+    std::atomic<size_t> m_decoded{0};
+    std::atomic<size_t> m_served{0};
+    std::atomic<int64_t> m_decode_time{0};
+};
+
+// Instructions of run that start before addr, nearest first. Allocation free.
+inline auto instructions_before(std::span<const Instruction> run, uintptr_t addr) {
+    const auto it = std::lower_bound(run.begin(), run.end(), addr, [](const Instruction& ix, uintptr_t a) {
+        return ix.address < a;
+    });
+
+    return std::ranges::subrange{std::make_reverse_iterator(it), run.rend()};
+}
+
+// Instructions of run starting at or after addr, in order. Allocation free.
+inline auto instructions_from(std::span<const Instruction> run, uintptr_t addr) {
+    const auto it = std::lower_bound(run.begin(), run.end(), addr, [](const Instruction& ix, uintptr_t a) {
+        return ix.address < a;
+    });
+
+    return std::ranges::subrange{it, run.end()};
+}
+}
@@ -0,0 +1,105 @@
+#include <cstring>
+
+#include "JumpStub.hpp"
+
+namespace analysis {
+namespace detail {
+template <typename T>
+T read(uintptr_t addr) {
+    T value{};
+    std::memcpy(&value, (const void*)addr, sizeof(value));
+    return value;
+}
+
+// add rcx, imm8/imm32 or sub rcx, imm8/imm32. Returns the instruction length.
+size_t decode_this_adjustment(uintptr_t addr, int32_t& adjustment) {
+    const auto p = (const uint8_t*)addr;
+
+    if (p[0] != 0x48 || (p[1] != 0x83 && p[1] != 0x81)) {
+        return 0;
+    }
+
+    const auto is_add = p[2] == 0xC1;
+    const auto is_sub = p[2] == 0xE9;
+
+    if (!is_add && !is_sub) {
+        return 0;
+    }
+
+    const auto imm = p[1] == 0x83 ? (int32_t)read<int8_t>(addr + 3) : read<int32_t>(addr + 3);
+    adjustment = is_add ? imm : -imm;
+
+    return p[1] == 0x83 ? 4 : 7;
+}
+}
+
+std::optional<uintptr_t> decode_jump(uintptr_t addr, int32_t* this_adjustment) {
+    int32_t adjustment = 0;
+    addr += detail::decode_this_adjustment(addr, adjustment);
+
+    const auto p = (const uint8_t*)addr;
+    std::optional<uintptr_t> result{};
+
+    if (p[0] == 0xEB) {
+        // jmp rel8
+        result = addr + 2 + detail::read<int8_t>(addr + 1);
+    } else if (p[0] == 0xE9) {
+        // jmp rel32
+        result = addr + 5 + detail::read<int32_t>(addr + 1);
+    } else if (p[0] == 0xFF && p[1] == 0x25) {
+        // jmp [rip+disp32], import thunks and hotpatched functions
+        const auto slot = addr + 6 + detail::read<int32_t>(addr + 2);
+        result = detail::read<uintptr_t>(slot);
+    } else if (p[0] == 0x48 && p[1] == 0xB8 && p[10] == 0xFF && p[11] == 0xE0) {
+        // mov rax, imm64; jmp rax
+        result = detail::read<uintptr_t>(addr + 2);
+    }
+
+    if (result && *result == 0) {
+        result = std::nullopt;
+    }
+
+    if (result && this_adjustment != nullptr) {
+        *this_adjustment = adjustment;
+    }
+
+    return result;
+}
+
+std::optional<JumpChain> follow_jumps(uintptr_t addr, uint32_t max_hops) {
+    if (addr == 0) {
+        return std::nullopt;
+    }
+
+    JumpChain chain{addr};
+
+    for (; chain.hops < max_hops; ++chain.hops) {
+        int32_t adjustment = 0;
+        const auto next = decode_jump(chain.target, &adjustment);
+
+        if (!next) {
+            return chain;
+        }
+
+        chain.target = *next;
+        chain.this_adjustment += adjustment;
+    }
+
+    // Still a stub after max_hops, most likely a loop
+    return std::nullopt;
+}
+
+std::optional<JumpChain> resolve_virtual(const void* object, uint32_t index, uint32_t max_hops) {
+    if (object == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto vtable = *(const uintptr_t* const*)object;
+
+    if (vtable == nullptr) {
+        return std::nullopt;
+    }
+
+    return follow_jumps(vtable[index], max_hops);
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace analysis {
+// Where a chain of forwarding stubs ends up.
+struct JumpChain {
+    uintptr_t target{};
+    uint32_t hops{};            // stubs followed to get to target, 0 if it wasn't a stub at all
+    int32_t this_adjustment{};  // sum of the add/sub rcx the stubs did on the way, non-zero for adjustor thunks
+};
+
+// Destination of the unconditional jmp at addr, decoded straight from the bytes:
+// jmp rel8, jmp rel32, jmp [rip+disp32] and mov rax, imm64; jmp rax.
+// An adjustor thunk's add/sub rcx, imm in front of the jmp is skipped and its immediate
+// written to this_adjustment when given.
+std::optional<uintptr_t> decode_jump(uintptr_t addr, int32_t* this_adjustment = nullptr);
+
+// Follows decode_jump until it lands on something that isn't a stub.
+// Gives up after max_hops so a jump to itself can't hang us.
+std::optional<JumpChain> follow_jumps(uintptr_t addr, uint32_t max_hops = 8);
+
+// Function in the given slot of a COM style object's vtable (the first pointer of the object), stubs followed.
+std::optional<JumpChain> resolve_virtual(const void* object, uint32_t index, uint32_t max_hops = 8);
+}
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "MappedImage.hpp"
+#include "Pe.hpp"
+
+namespace analysis {
+namespace detail {
+// Read-only view of the whole file, unmapped when it goes out of scope.
+class FileView {
+public:
+    explicit FileView(const std::filesystem::path& path) {
+#ifdef _WIN32
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER size{};
+        GetFileSizeEx(m_file, &size);
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (m_mapping != nullptr) {
+            m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+            m_size = m_data != nullptr ? (size_t)size.QuadPart : 0;
+        }
+#else
+        m_fd = open(path.c_str(), O_RDONLY);
+
+        if (m_fd < 0) {
+            return;
+        }
+
+        struct stat st{};
+
+        if (fstat(m_fd, &st) != 0 || st.st_size == 0) {
+            return;
+        }
+
+        const auto data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+
+        if (data != MAP_FAILED) {
+            m_data = (const uint8_t*)data;
+            m_size = (size_t)st.st_size;
+        }
+#endif
+    }
+
+    ~FileView() {
+#ifdef _WIN32
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+        }
+#else
+        if (m_data != nullptr) {
+            munmap((void*)m_data, m_size);
+        }
+
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+    }
+
+    const uint8_t* data() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file{INVALID_HANDLE_VALUE};
+    HANDLE m_mapping{nullptr};
+#else
+    int m_fd{-1};
+#endif
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+};
+
+uint8_t* allocate_image(size_t size) {
+#ifdef _WIN32
+    return (uint8_t*)VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    const auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p != MAP_FAILED ? (uint8_t*)p : nullptr;
+#endif
+}
+
+void free_image(uint8_t* base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, size);
+#endif
+}
+}
+
+std::unique_ptr<MappedImage> MappedImage::load(const std::filesystem::path& path) {
+    const detail::FileView file{path};
+
+    if (file.data() == nullptr) {
+        SPDLOG_ERROR("[MappedImage] Failed to open {}", path.string());
+        return nullptr;
+    }
+
+    // The header helpers assume the headers are fully readable
+    if (file.size() < sizeof(pe::DosHeader)) {
+        SPDLOG_ERROR("[MappedImage] {} is too small to be a PE file", path.string());
+        return nullptr;
+    }
+
+    const auto e_lfanew = ((const pe::DosHeader*)file.data())->e_lfanew;
+
+    if (e_lfanew <= 0 || (size_t)e_lfanew + sizeof(pe::NtHeaders64) > file.size()) {
+        SPDLOG_ERROR("[MappedImage] {} is not a PE32+ image", path.string());
+        return nullptr;
+    }
+
+    const auto nt = pe::get_nt_headers(file.data());
+
+    if (nt == nullptr || nt->optional_header.size_of_image == 0) {
+        SPDLOG_ERROR("[MappedImage] {} is not a PE32+ image", path.string());
+        return nullptr;
+    }
+
+    const auto sections = pe::get_sections(file.data());
+
+    if ((const uint8_t*)(sections.data() + sections.size()) > file.data() + file.size()) {
+        SPDLOG_ERROR("[MappedImage] {} has a truncated section table", path.string());
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedImage> image{new MappedImage{}};
+    image->m_size = nt->optional_header.size_of_image;
+    image->m_file_size = file.size();
+    image->m_preferred_base = nt->optional_header.image_base;
+    image->m_base = detail::allocate_image(image->m_size);
+
+    if (image->m_base == nullptr) {
+        SPDLOG_ERROR("[MappedImage] Failed to allocate 0x{:x} bytes for {}", image->m_size, path.string());
+        return nullptr;
+    }
+
+    const auto headers_size = std::min<size_t>({nt->optional_header.size_of_headers, file.size(), image->m_size});
+    std::memcpy(image->m_base, file.data(), headers_size);
+
+    for (const auto& section : sections) {
+        if (section.pointer_to_raw_data >= file.size() || section.virtual_address >= image->m_size) {
+            continue;
+        }
+
+        // Anything past the raw data (.bss and friends) stays zeroed, like the loader does
+        auto size = std::min<size_t>(section.size_of_raw_data, file.size() - section.pointer_to_raw_data);
+        size = std::min<size_t>(size, image->m_size - section.virtual_address);
+
+        if (section.virtual_size != 0) {
+            size = std::min<size_t>(size, section.virtual_size);
+        }
+
+        std::memcpy(image->m_base + section.virtual_address, file.data() + section.pointer_to_raw_data, size);
+    }
+
+    if (!image->relocate()) {
+        SPDLOG_WARN("[MappedImage] Malformed relocations in {}, absolute pointers may be wrong", path.string());
+    }
+
+    return image;
+}
+
+MappedImage::~MappedImage() {
+    if (m_base != nullptr) {
+        detail::free_image(m_base, m_size);
+    }
+}
+
+bool MappedImage::relocate() {
+    const auto nt = pe::get_nt_headers(m_base);
+
+    if (nt == nullptr || nt->optional_header.number_of_rva_and_sizes <= pe::DIRECTORY_ENTRY_BASERELOC) {
+        return true;
+    }
+
+    const auto& dir = nt->optional_header.data_directory[pe::DIRECTORY_ENTRY_BASERELOC];
+    const auto delta = (uint64_t)m_base - m_preferred_base;
+
+    if (dir.virtual_address == 0 || dir.size == 0 || delta == 0) {
+        return true;
+    }
+
+    if ((size_t)dir.virtual_address + dir.size > m_size) {
+        return false;
+    }
+
+    auto offset = dir.virtual_address;
+    const auto end = dir.virtual_address + dir.size;
+
+    while (offset + sizeof(pe::BaseRelocation) <= end) {
+        const auto block = (const pe::BaseRelocation*)(m_base + offset);
+
+        if (block->size_of_block < sizeof(pe::BaseRelocation) || offset + block->size_of_block > end) {
+            return false;
+        }
+
+        const auto entries = (const uint16_t*)(block + 1);
+        const auto count = (block->size_of_block - sizeof(pe::BaseRelocation)) / sizeof(uint16_t);
+
+        for (size_t i = 0; i < count; ++i) {
+            const auto type = entries[i] >> 12;
+            const auto rva = (size_t)block->virtual_address + (entries[i] & 0xFFF);
+
+            if (type == pe::REL_BASED_ABSOLUTE) {
+                continue;
+            }
+
+            if (type != pe::REL_BASED_DIR64 || rva + sizeof(uint64_t) > m_size) {
+                return false;
+            }
+
+            uint64_t value{};
+            std::memcpy(&value, m_base + rva, sizeof(value));
+            value += delta;
+            std::memcpy(m_base + rva, &value, sizeof(value));
+        }
+
+        offset += block->size_of_block;
+    }
+
+    return true;
+}
+}
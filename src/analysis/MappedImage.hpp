@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace analysis {
+// A PE32+ file from disk laid out the way the loader would: headers and sections at their virtual addresses,
+// base relocations applied for wherever we ended up. Imports aren't resolved and nothing is executed,
+// but everything the analysis code reads (code, .rdata, vtables, .pdata) looks exactly like it does in the game.
+class MappedImage {
+public:
+    static std::unique_ptr<MappedImage> load(const std::filesystem::path& path);
+
+    ~MappedImage();
+
+    MappedImage(const MappedImage&) = delete;
+    MappedImage& operator=(const MappedImage&) = delete;
+
+    uintptr_t get_base() const {
+        return (uintptr_t)m_base;
+    }
+
+    size_t get_size() const {
+        return m_size;
+    }
+
+    // ImageBase from the optional header, i.e. where the image would have been without relocation.
+    uint64_t get_preferred_base() const {
+        return m_preferred_base;
+    }
+
+    size_t get_file_size() const {
+        return m_file_size;
+    }
+
+private:
+    MappedImage() = default;
+
+    bool relocate();
+
+    uint8_t* m_base{nullptr};
+    size_t m_size{0};
+    size_t m_file_size{0};
+    uint64_t m_preferred_base{0};
+};
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
+#include "MultiScanner.hpp"
+#include "ParallelScan.hpp"
+#include "ScanRegion.hpp"
+#include "WorkPool.hpp"
+
+namespace analysis {
+size_t MultiScanner::add(std::string_view name, Pattern pattern, Target target) {
+    Entry entry{};
+    entry.name = name;
+    entry.anchor = pattern.longest_fixed_run();
+    entry.pattern = std::move(pattern);
+    entry.target = target;
+
+    if (entry.anchor.size == 0) {
+        throw std::invalid_argument("MultiScanner: pattern " + entry.name + " has no fixed bytes");
+    }
+
+    m_entries.push_back(std::move(entry));
+    m_compiled = false;
+
+    return m_entries.size() - 1;
+}
+
+size_t MultiScanner::add_pattern(std::string_view name, std::string_view ida, Target target) {
+    auto pattern = Pattern::parse(ida);
+
+    if (!pattern) {
+        throw std::invalid_argument("MultiScanner: failed to parse pattern " + std::string{name});
+    }
+
+    return add(name, std::move(*pattern), target);
+}
+
+size_t MultiScanner::add_string(std::string_view name, std::string_view str, bool null_terminate) {
+    return add(name, Pattern::from_string(str, null_terminate), Target::DATA);
+}
+
+size_t MultiScanner::add_string(std::string_view name, std::wstring_view str, bool null_terminate) {
+    return add(name, Pattern::from_string(str, null_terminate), Target::DATA);
+}
+
+void MultiScanner::compile() {
+    m_states.clear();
+    m_states.emplace_back(); // root
+
+    // Build the trie out of the anchors, 0 doubles as "no transition" since nothing can go back to the root.
+    for (uint32_t i = 0; i < m_entries.size(); ++i) {
+        const auto& entry = m_entries[i];
+        uint32_t state = 0;
+
+        for (size_t j = 0; j < entry.anchor.size; ++j) {
+            const auto b = entry.pattern.bytes[entry.anchor.offset + j];
+
+            if (m_states[state].next[b] == 0) {
+                m_states[state].next[b] = (uint32_t)m_states.size();
+                m_states.emplace_back();
+            }
+
+            state = m_states[state].next[b];
+        }
+
+        m_states[state].outputs.push_back(i);
+    }
+
+    // Breadth first pass to fill in fail links and turn the trie into a full DFA.
+    std::deque<uint32_t> queue{};
+
+    for (auto& next : m_states[0].next) {
+        if (next != 0) {
+            m_states[next].fail = 0;
+            queue.push_back(next);
+        }
+    }
+
+    while (!queue.empty()) {
+        const auto state = queue.front();
+        queue.pop_front();
+
+        const auto fail = m_states[state].fail;
+        const auto& fail_outputs = m_states[fail].outputs;
+        m_states[state].outputs.insert(m_states[state].outputs.end(), fail_outputs.begin(), fail_outputs.end());
+
+        for (size_t b = 0; b < 256; ++b) {
+            const auto next = m_states[state].next[b];
+
+            if (next != 0) {
+                m_states[next].fail = m_states[fail].next[b];
+                queue.push_back(next);
+            } else {
+                m_states[state].next[b] = m_states[fail].next[b];
+            }
+        }
+    }
+
+    m_max_pattern_size = 0;
+
+    for (const auto& entry : m_entries) {
+        m_max_pattern_size = std::max(m_max_pattern_size, entry.pattern.size());
+    }
+
+    m_compiled = true;
+}
+
+void MultiScanner::scan(const uint8_t* begin, size_t size, Target target, WorkPool* pool) {
+    if (!m_compiled) {
+        compile();
+    }
+
+    const auto chunk_size = DEFAULT_SCAN_CHUNK_SIZE;
+    const auto count = (size + chunk_size - 1) / chunk_size;
+
+    if (pool == nullptr || count <= 1 || m_max_pattern_size == 0) {
+        scan_chunk(begin, size, size, target, [&](uint32_t index, uintptr_t addr) {
+            m_entries[index].matches.push_back(addr);
+        });
+    } else {
+        std::vector<std::vector<std::pair<uint32_t, uintptr_t>>> results(count);
+
+        pool->parallel_for(count, [&](size_t i) {
+            const auto offset = i * chunk_size;
+            const auto limit = std::min(chunk_size, size - offset);
+            const auto read = std::min(limit + m_max_pattern_size - 1, size - offset);
+
+            scan_chunk(begin + offset, read, limit, target, [&](uint32_t index, uintptr_t addr) {
+                results[i].emplace_back(index, addr);
+            });
+        });
+
+        for (const auto& matches : results) {
+            for (const auto& [index, addr] : matches) {
+                m_entries[index].matches.push_back(addr);
+            }
+        }
+    }
+
+    m_bytes_scanned += size;
+}
+
+template <typename T>
+void MultiScanner::scan_chunk(const uint8_t* begin, size_t size, size_t limit, Target target, T&& on_match) const {
+    const auto end = begin + size;
+    const auto states = m_states.data();
+    uint32_t state = 0;
+
+    for (auto p = begin; p < end; ++p) {
+        state = states[state].next[*p];
+
+        if (states[state].outputs.empty()) {
+            continue;
+        }
+
+        for (const auto index : states[state].outputs) {
+            const auto& entry = m_entries[index];
+
+            if (entry.target != target) {
+                continue;
+            }
+
+            // p is the last byte of the anchor
+            const auto anchor_start = p + 1 - entry.anchor.size;
+
+            if (anchor_start < begin + entry.anchor.offset) {
+                continue;
+            }
+
+            const auto start = anchor_start - entry.anchor.offset;
+
+            // Past limit it belongs to the next chunk
+            if (start >= begin + limit || start + entry.pattern.size() > end) {
+                continue;
+            }
+
+            if (entry.pattern.matches(start)) {
+                on_match(index, (uintptr_t)start);
+            }
+        }
+    }
+}
+
+void MultiScanner::scan_module(uintptr_t module, WorkPool* pool) {
+    const auto has_target = [&](Target target) {
+        return std::any_of(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.target == target; });
+    };
+
+    // Don't even touch the data sections if nothing is looking for data
+    if (has_target(Target::CODE)) {
+        for (const auto& region : get_scan_regions(module, RegionKind::CODE)) {
+            scan(region.begin, region.size, Target::CODE, pool);
+        }
+    }
+
+    if (has_target(Target::DATA)) {
+        for (const auto& region : get_scan_regions(module, RegionKind::READ_ONLY)) {
+            scan(region.begin, region.size, Target::DATA, pool);
+        }
+    }
+
+    for (auto& entry : m_entries) {
+        std::sort(entry.matches.begin(), entry.matches.end());
+    }
+}
+
+void MultiScanner::clear_matches() {
+    for (auto& entry : m_entries) {
+        entry.matches.clear();
+    }
+
+    m_bytes_scanned = 0;
+}
+
+const MultiScanner::Entry* MultiScanner::find(std::string_view name) const {
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.name == name; });
+    return it != m_entries.end() ? &*it : nullptr;
+}
+
+const std::vector<uintptr_t>& MultiScanner::get_matches(std::string_view name) const {
+    static const std::vector<uintptr_t> empty{};
+    const auto entry = find(name);
+
+    return entry != nullptr ? entry->matches : empty;
+}
+
+std::optional<uintptr_t> MultiScanner::get_first(std::string_view name) const {
+    const auto& matches = get_matches(name);
+
+    if (matches.empty()) {
+        return std::nullopt;
+    }
+
+    return matches.front();
+}
+
+std::optional<uintptr_t> MultiScanner::get_unique(std::string_view name) const {
+    const auto& matches = get_matches(name);
+
+    if (matches.size() != 1) {
+        return std::nullopt;
+    }
+
+    return matches.front();
+}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Pattern.hpp"
+
+namespace analysis {
+class WorkPool;
+
+// Finds every occurrence of a whole set of patterns in a single pass over the memory.
+// Each pattern's longest fixed run of bytes goes into an Aho-Corasick automaton,
+// and candidates it reports are verified against the full pattern (wildcards included).
+class MultiScanner {
+public:
+    enum class Target : uint8_t {
+        CODE, // executable sections
+        DATA, // read-only initialized data, string literals live here
+    };
+
+    size_t add(std::string_view name, Pattern pattern, Target target);
+    size_t add_pattern(std::string_view name, std::string_view ida, Target target = Target::CODE);
+    size_t add_string(std::string_view name, std::string_view str, bool null_terminate = true);
+    size_t add_string(std::string_view name, std::wstring_view str, bool null_terminate = true);
+
+    // Builds the automaton. Called automatically by scan if needed.
+    void compile();
+
+    // Scans [begin, begin + size) for patterns of the given target, appending to their matches.
+    // With a pool the range gets split into chunks like parallel_find_all (see ParallelScan.hpp), with the same result.
+    void scan(const uint8_t* begin, size_t size, Target target, WorkPool* pool = nullptr);
+
+    // Scans a mapped PE image once, routing code patterns to the executable sections
+    // and data patterns to the read-only data sections (see get_scan_regions).
+    void scan_module(uintptr_t module, WorkPool* pool = nullptr);
+
+    void clear_matches();
+
+    // All matches for a pattern, sorted by address.
+    const std::vector<uintptr_t>& get_matches(std::string_view name) const;
+    std::optional<uintptr_t> get_first(std::string_view name) const;
+    std::optional<uintptr_t> get_unique(std::string_view name) const;
+
+    size_t get_bytes_scanned() const {
+        return m_bytes_scanned;
+    }
+
+private:
+    struct Entry {
+        std::string name{};
+        Pattern pattern{};
+        Pattern::Anchor anchor{};
+        Target target{};
+        std::vector<uintptr_t> matches{};
+    };
+
+    struct State {
+        std::array<uint32_t, 256> next{};
+        uint32_t fail{0};
+        std::vector<uint32_t> outputs{}; // indices into m_entries
+    };
+
+    const Entry* find(std::string_view name) const;
+
+    // Reports (entry index, address) of matches starting in [begin, begin + limit) that fit in [begin, begin + size).
+    template <typename T>
+    void scan_chunk(const uint8_t* begin, size_t size, size_t limit, Target target, T&& on_match) const;
+
+    std::vector<Entry> m_entries{};
+    std::vector<State> m_states{};
+    size_t m_max_pattern_size{0};
+    bool m_compiled{false};
+    size_t m_bytes_scanned{0};
+};
+}
@@ -0,0 +1,92 @@
+#include <bit>
+
+#include <immintrin.h>
+
+#include "NullHandleScan.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ANALYSIS_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#define ANALYSIS_TARGET_AVX512 __attribute__((target("avx512f,bmi")))
+#else
+#define ANALYSIS_TARGET_AVX2
+#define ANALYSIS_TARGET_AVX512
+#endif
+
+namespace analysis::simd {
+namespace detail {
+size_t find_null_handle_scalar(const uint64_t* handles, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (handles[i] == 0) {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+ANALYSIS_TARGET_AVX2 size_t find_null_handle_avx2(const uint64_t* handles, size_t count) {
+    const auto zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    // Two vectors per iteration, the common case is a long run without any null in it
+    for (; i + 8 <= count; i += 8) {
+        const auto a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(handles + i)), zero);
+        const auto b = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(handles + i + 4)), zero);
+
+        if (_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) == 0) {
+            const auto mask = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(a)) | ((uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(b)) << 4);
+            return i + std::countr_zero(mask);
+        }
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        const auto a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(handles + i)), zero);
+
+        if (const auto mask = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(a)); mask != 0) {
+            return i + std::countr_zero(mask);
+        }
+    }
+
+    for (; i < count; ++i) {
+        if (handles[i] == 0) {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+ANALYSIS_TARGET_AVX512 size_t find_null_handle_avx512(const uint64_t* handles, size_t count) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        if (const auto mask = (uint32_t)_mm512_testn_epi64_mask(_mm512_loadu_si512(handles + i), _mm512_loadu_si512(handles + i)); mask != 0) {
+            return i + std::countr_zero(mask);
+        }
+    }
+
+    // The tail (and every call with less than 8 handles, which is most of them) as a single masked load
+    if (i < count) {
+        const auto valid = (__mmask8)((1u << (count - i)) - 1);
+        const auto v = _mm512_maskz_loadu_epi64(valid, handles + i);
+
+        if (const auto mask = (uint32_t)_mm512_mask_testn_epi64_mask(valid, v, v); mask != 0) {
+            return i + std::countr_zero(mask);
+        }
+    }
+
+    return count;
+}
+}
+
+FindNullHandleFn get_find_null_handle(Isa isa) {
+    switch (isa) {
+    case Isa::AVX512:
+        return &detail::find_null_handle_avx512;
+    case Isa::AVX2:
+        return &detail::find_null_handle_avx2;
+    default:
+        return &detail::find_null_handle_scalar;
+    }
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SimdScan.hpp"
+
+// Finds null entries in arrays of 64 bit handles (D3D12_CPU_DESCRIPTOR_HANDLE::ptr and the like).
+// Compares 4 (AVX2) or 8 (AVX-512F) handles per instruction, with the ISA picked once up front
+// so the caller only pays for an indirect call on every lookup.
+namespace analysis::simd {
+// Index of the first zero in handles[0, count), count if there is none.
+using FindNullHandleFn = size_t (*)(const uint64_t* handles, size_t count);
+
+FindNullHandleFn get_find_null_handle(Isa isa = get_isa());
+
+// Less than a vector's worth of handles, cheaper inline than through the indirect call.
+inline size_t find_null_handle_short(const uint64_t* handles, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (handles[i] == 0) {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+inline size_t find_null_handle(const uint64_t* handles, size_t count, Isa isa = get_isa()) {
+    return get_find_null_handle(isa)(handles, count);
+}
+}
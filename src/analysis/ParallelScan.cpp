@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <atomic>
+
+#include "ParallelScan.hpp"
+
+namespace analysis {
+namespace detail {
+// Range chunk i reads: its own bytes plus the overlap, clamped to the end of the buffer.
+struct ScanChunk {
+    const uint8_t* begin{};
+    size_t size{};
+};
+
+ScanChunk get_chunk(const uint8_t* begin, size_t size, size_t pattern_size, size_t chunk_size, size_t i) {
+    const auto offset = i * chunk_size;
+    const auto end = std::min(offset + chunk_size + pattern_size - 1, size);
+
+    return {begin + offset, end - offset};
+}
+
+template <typename Scan>
+std::optional<uintptr_t> find_first_chunked(WorkPool& pool, const uint8_t* begin, size_t size, size_t pattern_size, size_t chunk_size, Scan&& scan) {
+    const auto count = (size + chunk_size - 1) / chunk_size;
+
+    if (count <= 1 || pattern_size == 0) {
+        return scan(begin, size);
+    }
+
+    std::vector<std::optional<uintptr_t>> results(count);
+    std::atomic<size_t> first{count};
+
+    pool.parallel_for(count, [&](size_t i) {
+        // Something below already matched, nothing in here can be first anymore.
+        // Every chunk below first still gets scanned, which is what keeps the result deterministic
+        if (i > first.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const auto chunk = get_chunk(begin, size, pattern_size, chunk_size, i);
+        results[i] = scan(chunk.begin, chunk.size);
+
+        if (!results[i]) {
+            return;
+        }
+
+        for (auto current = first.load(std::memory_order_relaxed); i < current && !first.compare_exchange_weak(current, i, std::memory_order_relaxed);) {
+        }
+    });
+
+    const auto index = first.load(std::memory_order_relaxed);
+    return index < count ? results[index] : std::nullopt;
+}
+
+template <typename Scan>
+void find_all_chunked(WorkPool& pool, const uint8_t* begin, size_t size, size_t pattern_size, size_t chunk_size, std::vector<uintptr_t>& out, Scan&& scan) {
+    const auto count = (size + chunk_size - 1) / chunk_size;
+
+    if (count <= 1 || pattern_size == 0) {
+        scan(begin, size, out);
+        return;
+    }
+
+    std::vector<std::vector<uintptr_t>> results(count);
+
+    pool.parallel_for(count, [&](size_t i) {
+        const auto chunk = get_chunk(begin, size, pattern_size, chunk_size, i);
+        scan(chunk.begin, chunk.size, results[i]);
+    });
+
+    for (const auto& matches : results) {
+        out.insert(out.end(), matches.begin(), matches.end());
+    }
+}
+}
+
+std::optional<uintptr_t> parallel_find_first(WorkPool& pool, const uint8_t* begin, size_t size, const AnchoredPattern& pattern, size_t chunk_size) {
+    return detail::find_first_chunked(pool, begin, size, pattern.size, chunk_size, [&](const uint8_t* p, size_t n) {
+        return find_first(p, n, pattern);
+    });
+}
+
+std::optional<uintptr_t> parallel_find_first(WorkPool& pool, const uint8_t* begin, size_t size, const simd::CompiledPattern& pattern, size_t chunk_size) {
+    return detail::find_first_chunked(pool, begin, size, pattern.pattern.size(), chunk_size, [&](const uint8_t* p, size_t n) {
+        return simd::find_first(p, n, pattern);
+    });
+}
+
+void parallel_find_all(WorkPool& pool, const uint8_t* begin, size_t size, const AnchoredPattern& pattern, std::vector<uintptr_t>& out, size_t chunk_size) {
+    detail::find_all_chunked(pool, begin, size, pattern.size, chunk_size, out, [&](const uint8_t* p, size_t n, std::vector<uintptr_t>& matches) {
+        find_all(p, n, pattern, matches);
+    });
+}
+
+void parallel_find_all(WorkPool& pool, const uint8_t* begin, size_t size, const simd::CompiledPattern& pattern, std::vector<uintptr_t>& out, size_t chunk_size) {
+    detail::find_all_chunked(pool, begin, size, pattern.pattern.size(), chunk_size, out, [&](const uint8_t* p, size_t n, std::vector<uintptr_t>& matches) {
+        simd::find_all(p, n, pattern, matches);
+    });
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "AnchorScan.hpp"
+#include "SimdScan.hpp"
+#include "WorkPool.hpp"
+
+namespace analysis {
+// Single pattern scans split into chunks across a WorkPool.
+// Each chunk reads pattern size - 1 bytes past its end, so a match straddling two chunks is found by exactly
+// the one it starts in. Results are the same as the single threaded find_first/find_all, in the same order.
+constexpr size_t DEFAULT_SCAN_CHUNK_SIZE = 1024 * 1024;
+
+// Lowest matching address. Chunks above one that already matched are skipped.
+std::optional<uintptr_t> parallel_find_first(WorkPool& pool, const uint8_t* begin, size_t size, const AnchoredPattern& pattern, size_t chunk_size = DEFAULT_SCAN_CHUNK_SIZE);
+std::optional<uintptr_t> parallel_find_first(WorkPool& pool, const uint8_t* begin, size_t size, const simd::CompiledPattern& pattern, size_t chunk_size = DEFAULT_SCAN_CHUNK_SIZE);
+
+// Every match, sorted by address and appended to out.
+void parallel_find_all(WorkPool& pool, const uint8_t* begin, size_t size, const AnchoredPattern& pattern, std::vector<uintptr_t>& out, size_t chunk_size = DEFAULT_SCAN_CHUNK_SIZE);
+void parallel_find_all(WorkPool& pool, const uint8_t* begin, size_t size, const simd::CompiledPattern& pattern, std::vector<uintptr_t>& out, size_t chunk_size = DEFAULT_SCAN_CHUNK_SIZE);
+}
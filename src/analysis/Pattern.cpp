@@ -0,0 +1,110 @@
+#include <cctype>
+
+#include "ByteFrequency.hpp"
+#include "Pattern.hpp"
+
+namespace analysis {
+std::optional<Pattern> Pattern::parse(std::string_view ida) {
+    Pattern result{};
+
+    const auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    for (size_t i = 0; i < ida.size();) {
+        const auto c = ida[i];
+
+        if (std::isspace((unsigned char)c)) {
+            ++i;
+            continue;
+        }
+
+        if (c == '?') {
+            result.bytes.push_back(0);
+            result.mask.push_back(0);
+
+            // Accept both "?" and "??"
+            i += (i + 1 < ida.size() && ida[i + 1] == '?') ? 2 : 1;
+            continue;
+        }
+
+        if (i + 1 >= ida.size() || hex(c) < 0 || hex(ida[i + 1]) < 0) {
+            return std::nullopt;
+        }
+
+        result.bytes.push_back((uint8_t)((hex(c) << 4) | hex(ida[i + 1])));
+        result.mask.push_back(0xFF);
+        i += 2;
+    }
+
+    if (result.bytes.empty()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+Pattern Pattern::from_string(std::string_view str, bool null_terminate) {
+    auto result = from_bytes(str.data(), str.size());
+
+    if (null_terminate) {
+        result.bytes.push_back(0);
+        result.mask.push_back(0xFF);
+    }
+
+    return result;
+}
+
+Pattern Pattern::from_string(std::wstring_view str, bool null_terminate) {
+    // The game is a Windows binary, so wide strings are always UTF-16LE regardless of our wchar_t.
+    Pattern result{};
+
+    for (const auto c : str) {
+        result.bytes.push_back((uint8_t)(c & 0xFF));
+        result.bytes.push_back((uint8_t)((c >> 8) & 0xFF));
+    }
+
+    if (null_terminate) {
+        result.bytes.push_back(0);
+        result.bytes.push_back(0);
+    }
+
+    result.mask.assign(result.bytes.size(), 0xFF);
+    return result;
+}
+
+Pattern Pattern::from_bytes(const void* data, size_t size) {
+    Pattern result{};
+    result.bytes.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    result.mask.assign(size, 0xFF);
+
+    return result;
+}
+
+Pattern::Anchor Pattern::longest_fixed_run() const {
+    Anchor best{};
+    Anchor current{};
+
+    for (size_t i = 0; i < mask.size(); ++i) {
+        if (mask[i] != 0xFF) {
+            current = Anchor{i + 1, 0};
+            continue;
+        }
+
+        ++current.size;
+
+        if (current.size > best.size) {
+            best = current;
+        }
+    }
+
+    return best;
+}
+
+size_t Pattern::rarest_fixed_byte() const {
+    return find_rarest_fixed_byte(bytes, mask, bytes.size());
+}
+}
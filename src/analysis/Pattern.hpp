@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace analysis {
+// A byte signature with wildcards, e.g. "48 8D 0D ? ? ? ? E8".
+// mask[i] is 0xFF for fixed bytes and 0x00 for wildcards.
+struct Pattern {
+    std::vector<uint8_t> bytes{};
+    std::vector<uint8_t> mask{};
+
+    static std::optional<Pattern> parse(std::string_view ida);
+    static Pattern from_string(std::string_view str, bool null_terminate = true);
+    static Pattern from_string(std::wstring_view str, bool null_terminate = true);
+    static Pattern from_bytes(const void* data, size_t size);
+
+    size_t size() const {
+        return bytes.size();
+    }
+
+    bool matches(const uint8_t* p) const {
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            if ((p[i] & mask[i]) != bytes[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Longest run of fixed bytes, used as the anchor when searching.
+    struct Anchor {
+        size_t offset{};
+        size_t size{};
+    };
+
+    Anchor longest_fixed_run() const;
+
+    // Index of the fixed byte least likely to show up in code (see ByteFrequency.hpp), size() if there is none.
+    size_t rarest_fixed_byte() const;
+};
+}
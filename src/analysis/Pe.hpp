@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Minimal PE32+ header definitions.
+// We don't pull in windows.h here so the analysis code can also run against images loaded from disk.
+namespace analysis::pe {
+constexpr uint16_t DOS_SIGNATURE = 0x5A4D; // MZ
+constexpr uint32_t NT_SIGNATURE = 0x00004550; // PE\0\0
+constexpr uint16_t OPTIONAL_HDR64_MAGIC = 0x20B;
+
+constexpr uint32_t SCN_CNT_CODE = 0x00000020;
+constexpr uint32_t SCN_CNT_INITIALIZED_DATA = 0x00000040;
+constexpr uint32_t SCN_CNT_UNINITIALIZED_DATA = 0x00000080;
+constexpr uint32_t SCN_MEM_DISCARDABLE = 0x02000000;
+constexpr uint32_t SCN_MEM_EXECUTE = 0x20000000;
+constexpr uint32_t SCN_MEM_READ = 0x40000000;
+constexpr uint32_t SCN_MEM_WRITE = 0x80000000;
+
+enum DirectoryEntry : uint32_t {
+    DIRECTORY_ENTRY_EXPORT = 0,
+    DIRECTORY_ENTRY_IMPORT = 1,
+    DIRECTORY_ENTRY_RESOURCE = 2,
+    DIRECTORY_ENTRY_EXCEPTION = 3,
+    DIRECTORY_ENTRY_BASERELOC = 5,
+    NUMBER_OF_DIRECTORY_ENTRIES = 16,
+};
+
+#pragma pack(push, 1)
+struct DosHeader {
+    uint16_t e_magic;
+    uint8_t pad[58];
+    int32_t e_lfanew;
+};
+
+struct FileHeader {
+    uint16_t machine;
+    uint16_t number_of_sections;
+    uint32_t time_date_stamp;
+    uint32_t pointer_to_symbol_table;
+    uint32_t number_of_symbols;
+    uint16_t size_of_optional_header;
+    uint16_t characteristics;
+};
+
+struct DataDirectory {
+    uint32_t virtual_address;
+    uint32_t size;
+};
+
+struct OptionalHeader64 {
+    uint16_t magic;
+    uint8_t major_linker_version;
+    uint8_t minor_linker_version;
+    uint32_t size_of_code;
+    uint32_t size_of_initialized_data;
+    uint32_t size_of_uninitialized_data;
+    uint32_t address_of_entry_point;
+    uint32_t base_of_code;
+    uint64_t image_base;
+    uint32_t section_alignment;
+    uint32_t file_alignment;
+    uint16_t major_operating_system_version;
+    uint16_t minor_operating_system_version;
+    uint16_t major_image_version;
+    uint16_t minor_image_version;
+    uint16_t major_subsystem_version;
+    uint16_t minor_subsystem_version;
+    uint32_t win32_version_value;
+    uint32_t size_of_image;
+    uint32_t size_of_headers;
+    uint32_t check_sum;
+    uint16_t subsystem;
+    uint16_t dll_characteristics;
+    uint64_t size_of_stack_reserve;
+    uint64_t size_of_stack_commit;
+    uint64_t size_of_heap_reserve;
+    uint64_t size_of_heap_commit;
+    uint32_t loader_flags;
+    uint32_t number_of_rva_and_sizes;
+    DataDirectory data_directory[NUMBER_OF_DIRECTORY_ENTRIES];
+};
+
+struct NtHeaders64 {
+    uint32_t signature;
+    FileHeader file_header;
+    OptionalHeader64 optional_header;
+};
+
+struct SectionHeader {
+    char name[8];
+    uint32_t virtual_size;
+    uint32_t virtual_address;
+    uint32_t size_of_raw_data;
+    uint32_t pointer_to_raw_data;
+    uint32_t pointer_to_relocations;
+    uint32_t pointer_to_linenumbers;
+    uint16_t number_of_relocations;
+    uint16_t number_of_linenumbers;
+    uint32_t characteristics;
+};
+
+struct RuntimeFunction {
+    uint32_t begin_address;
+    uint32_t end_address;
+    uint32_t unwind_data;
+};
+
+struct BaseRelocation {
+    uint32_t virtual_address;
+    uint32_t size_of_block;
+    // followed by u16 entries, type in the top 4 bits and page offset in the rest
+};
+
+struct UnwindInfo {
+    uint8_t version_and_flags;
+    uint8_t size_of_prolog;
+    uint8_t count_of_codes;
+    uint8_t frame_register_and_offset;
+    uint16_t unwind_codes[1];
+};
+
+// MSVC RTTI, x64 flavour where every pointer is an image relative offset.
+// The qword right before a vtable points at its CompleteObjectLocator.
+struct CompleteObjectLocator {
+    uint32_t signature; // COL_SIGNATURE_X64
+    uint32_t offset;    // of this vtable's subobject inside the complete object
+    uint32_t cd_offset;
+    uint32_t type_descriptor;
+    uint32_t class_descriptor;
+    uint32_t self;
+};
+
+struct TypeDescriptor {
+    uint64_t vtable; // type_info's vtable
+    uint64_t spare;
+    char name[1];    // decorated, e.g. ".?AVFScene@@"
+};
+
+struct ClassHierarchyDescriptor {
+    uint32_t signature;
+    uint32_t attributes;
+    uint32_t num_base_classes; // including the class itself
+    uint32_t base_class_array; // RVA of num_base_classes RVAs to BaseClassDescriptor
+};
+
+struct BaseClassDescriptor {
+    uint32_t type_descriptor;
+    uint32_t num_contained_bases;
+    int32_t mdisp;
+    int32_t pdisp;
+    int32_t vdisp;
+    uint32_t attributes;
+    uint32_t class_descriptor;
+};
+#pragma pack(pop)
+
+constexpr uint8_t UNW_FLAG_CHAININFO = 0x4;
+
+constexpr uint16_t REL_BASED_ABSOLUTE = 0;
+constexpr uint16_t REL_BASED_DIR64 = 10;
+
+constexpr uint32_t COL_SIGNATURE_X64 = 1;
+
+// Returns nullptr if the headers at base don't look like a PE32+ image.
+inline const NtHeaders64* get_nt_headers(const uint8_t* base) {
+    if (base == nullptr) {
+        return nullptr;
+    }
+
+    const auto dos = (const DosHeader*)base;
+
+    if (dos->e_magic != DOS_SIGNATURE || dos->e_lfanew <= 0) {
+        return nullptr;
+    }
+
+    const auto nt = (const NtHeaders64*)(base + dos->e_lfanew);
+
+    if (nt->signature != NT_SIGNATURE || nt->optional_header.magic != OPTIONAL_HDR64_MAGIC) {
+        return nullptr;
+    }
+
+    return nt;
+}
+
+inline std::span<const SectionHeader> get_sections(const uint8_t* base) {
+    const auto nt = get_nt_headers(base);
+
+    if (nt == nullptr) {
+        return {};
+    }
+
+    const auto first = (const SectionHeader*)((const uint8_t*)&nt->optional_header + nt->file_header.size_of_optional_header);
+    return {first, nt->file_header.number_of_sections};
+}
+
+inline uint32_t get_image_size(const uint8_t* base) {
+    const auto nt = get_nt_headers(base);
+    return nt != nullptr ? nt->optional_header.size_of_image : 0;
+}
+
+inline std::span<const RuntimeFunction> get_runtime_functions(const uint8_t* base) {
+    const auto nt = get_nt_headers(base);
+
+    if (nt == nullptr || nt->optional_header.number_of_rva_and_sizes <= DIRECTORY_ENTRY_EXCEPTION) {
+        return {};
+    }
+
+    const auto& dir = nt->optional_header.data_directory[DIRECTORY_ENTRY_EXCEPTION];
+
+    if (dir.virtual_address == 0 || dir.size == 0) {
+        return {};
+    }
+
+    return {(const RuntimeFunction*)(base + dir.virtual_address), dir.size / sizeof(RuntimeFunction)};
+}
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Pe.hpp"
+#include "RttiIndex.hpp"
+#include "ScanRegion.hpp"
+
+namespace analysis {
+namespace detail {
+constexpr size_t MAX_NAME_LENGTH = 4096;
+constexpr size_t MAX_BASE_CLASSES = 1024;
+constexpr size_t MAX_VTABLE_SLOTS = 4096;
+
+struct Range {
+    uintptr_t begin{~(uintptr_t)0};
+    uintptr_t end{0};
+
+    bool contains(uintptr_t addr) const {
+        return addr >= begin && addr < end;
+    }
+};
+
+Range get_bounds(std::span<const ScanRegion> regions) {
+    Range result{};
+
+    for (const auto& region : regions) {
+        result.begin = std::min(result.begin, (uintptr_t)region.begin);
+        result.end = std::max(result.end, (uintptr_t)region.begin + region.size);
+    }
+
+    return result;
+}
+
+// Decorated name of the TypeDescriptor at rva, empty if it doesn't look like one.
+std::string_view get_type_name(const uint8_t* base, uint32_t image_size, uint32_t rva) {
+    if (rva == 0 || (size_t)rva + sizeof(pe::TypeDescriptor) > image_size) {
+        return {};
+    }
+
+    const auto name = ((const pe::TypeDescriptor*)(base + rva))->name;
+    const auto length = strnlen(name, std::min<size_t>(MAX_NAME_LENGTH, image_size - (name - (const char*)base)));
+
+    const std::string_view result{name, length};
+    return result.starts_with(".?A") ? result : std::string_view{};
+}
+}
+
+std::string RttiIndex::undecorate(std::string_view decorated) {
+    if (!decorated.starts_with(".?AV") && !decorated.starts_with(".?AU")) {
+        return std::string{decorated};
+    }
+
+    auto name = decorated.substr(4);
+
+    // Templates and anything else with back references, not worth undecorating by hand
+    if (name.find('?') != std::string_view::npos) {
+        return std::string{name};
+    }
+
+    if (name.ends_with("@@")) {
+        name.remove_suffix(2);
+    }
+
+    // Innermost scope comes first
+    std::string result{};
+
+    while (!name.empty()) {
+        const auto at = name.rfind('@');
+        const auto part = at == std::string_view::npos ? name : name.substr(at + 1);
+
+        if (!result.empty()) {
+            result += "::";
+        }
+
+        result += part;
+        name = at == std::string_view::npos ? std::string_view{} : name.substr(0, at);
+    }
+
+    return result;
+}
+
+void RttiIndex::build(uintptr_t module) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto base = (const uint8_t*)module;
+    const auto image_size = pe::get_image_size(base);
+
+    m_module = module;
+    m_classes.clear();
+    m_vtable_count = 0;
+    m_bytes_scanned = 0;
+
+    const auto regions = get_scan_regions(module, RegionKind::READ_ONLY);
+    const auto data = detail::get_bounds(regions);
+    const auto code = detail::get_bounds(get_scan_regions(module, RegionKind::CODE));
+
+    std::vector<uint32_t> locators{}; // RVAs, ascending
+    std::vector<std::pair<uint32_t, uint32_t>> meta_candidates{}; // qword RVA -> read-only data RVA it points at
+
+    // One pass over the read-only data picks up both the locators (recognizable by their self RVA)
+    // and every qword that could be the locator pointer in front of a vtable. Locators can come
+    // before or after the vtables using them, so the two only get matched up afterwards.
+    for (const auto& region : regions) {
+        m_bytes_scanned += region.size;
+
+        for (size_t i = 0; i + sizeof(pe::CompleteObjectLocator) <= region.size; i += sizeof(uint32_t)) {
+            const auto p = region.begin + i;
+            const auto rva = (uint32_t)(p - base);
+
+            if ((i % sizeof(uint64_t)) == 0) {
+                const auto value = *(const uint64_t*)p;
+
+                if (data.contains(value)) {
+                    meta_candidates.emplace_back(rva, (uint32_t)(value - module));
+                }
+            }
+
+            const auto col = (const pe::CompleteObjectLocator*)p;
+
+            if (col->signature == pe::COL_SIGNATURE_X64 && col->self == rva) {
+                locators.push_back(rva);
+            }
+        }
+    }
+
+    for (const auto& [meta, target] : meta_candidates) {
+        if (!std::binary_search(locators.begin(), locators.end(), target)) {
+            continue;
+        }
+
+        const auto col = (const pe::CompleteObjectLocator*)(base + target);
+        const auto decorated = detail::get_type_name(base, image_size, col->type_descriptor);
+
+        if (decorated.empty()) {
+            continue;
+        }
+
+        auto& cls = m_classes[undecorate(decorated)];
+
+        Vtable vtable{};
+        vtable.rva = meta + sizeof(uint64_t);
+        vtable.offset = col->offset;
+
+        for (auto slot = (const uint64_t*)(base + vtable.rva); vtable.size < detail::MAX_VTABLE_SLOTS; ++slot) {
+            if ((const uint8_t*)(slot + 1) > base + image_size || !code.contains(*slot)) {
+                break;
+            }
+
+            ++vtable.size;
+        }
+
+        cls.vtables.push_back(vtable);
+        ++m_vtable_count;
+
+        // Every vtable of a class shares the same hierarchy, only read it once
+        if (!cls.bases.empty() || col->class_descriptor == 0 || (size_t)col->class_descriptor + sizeof(pe::ClassHierarchyDescriptor) > image_size) {
+            continue;
+        }
+
+        const auto chd = (const pe::ClassHierarchyDescriptor*)(base + col->class_descriptor);
+        const auto count = std::min<size_t>(chd->num_base_classes, detail::MAX_BASE_CLASSES);
+
+        if ((size_t)chd->base_class_array + count * sizeof(uint32_t) > image_size) {
+            continue;
+        }
+
+        const auto array = (const uint32_t*)(base + chd->base_class_array);
+
+        // The first entry is the class itself
+        for (size_t i = 1; i < count; ++i) {
+            if ((size_t)array[i] + sizeof(pe::BaseClassDescriptor) > image_size) {
+                break;
+            }
+
+            const auto bcd = (const pe::BaseClassDescriptor*)(base + array[i]);
+            const auto base_name = detail::get_type_name(base, image_size, bcd->type_descriptor);
+
+            if (!base_name.empty()) {
+                cls.bases.push_back(undecorate(base_name));
+            }
+        }
+    }
+
+    for (auto& [name, cls] : m_classes) {
+        std::sort(cls.vtables.begin(), cls.vtables.end(), [](const Vtable& a, const Vtable& b) {
+            return a.offset < b.offset || (a.offset == b.offset && a.rva < b.rva);
+        });
+    }
+
+    m_build_time = std::chrono::steady_clock::now() - start;
+}
+
+const RttiIndex::Class* RttiIndex::find(std::string_view name) const {
+    const auto it = m_classes.find(std::string{name});
+    return it != m_classes.end() ? &it->second : nullptr;
+}
+
+std::optional<uintptr_t> RttiIndex::find_vtable(std::string_view name, uint32_t offset) const {
+    const auto cls = find(name);
+
+    if (cls == nullptr) {
+        return std::nullopt;
+    }
+
+    for (const auto& vtable : cls->vtables) {
+        if (vtable.offset == offset) {
+            return m_module + vtable.rva;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<size_t> RttiIndex::find_slot(std::string_view name, uintptr_t fn) const {
+    const auto cls = find(name);
+
+    if (cls == nullptr || cls->vtables.empty() || cls->vtables.front().offset != 0) {
+        return std::nullopt;
+    }
+
+    const auto& vtable = cls->vtables.front();
+    const auto slots = (const uintptr_t*)(m_module + vtable.rva);
+
+    for (size_t i = 0; i < vtable.size; ++i) {
+        if (slots[i] == fn) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+}
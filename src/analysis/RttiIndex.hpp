@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace analysis {
+// Class name -> vtable index built from the MSVC RTTI in an image's read-only data, in a single pass.
+// Every CompleteObjectLocator found there is tied to the vtable that points at it, which gives the
+// class (from its TypeDescriptor) and the base classes (from its ClassHierarchyDescriptor).
+//
+// Names are undecorated the simple way, ".?AVFScene@@" becomes "FScene" and ".?AVFoo@Bar@@" becomes "Bar::Foo".
+// Templates keep their decorated name after the ".?AV" prefix. Images built without RTTI produce an empty index.
+class RttiIndex {
+public:
+    struct Vtable {
+        uint32_t rva{};    // of the first slot
+        uint32_t offset{}; // of the subobject using it, 0 for the primary vtable
+        uint32_t size{};   // in slots, up to the first entry that isn't a pointer into code
+    };
+
+    struct Class {
+        std::vector<Vtable> vtables{}; // sorted by offset
+        std::vector<std::string> bases{}; // every base class, direct or not, in hierarchy order
+    };
+
+    void build(uintptr_t module);
+
+    const Class* find(std::string_view name) const;
+
+    // Vtable for the subobject at offset (0 = primary).
+    std::optional<uintptr_t> find_vtable(std::string_view name, uint32_t offset = 0) const;
+
+    // Index of the slot in name's primary vtable holding fn.
+    std::optional<size_t> find_slot(std::string_view name, uintptr_t fn) const;
+
+    static std::string undecorate(std::string_view decorated);
+
+    size_t size() const {
+        return m_classes.size();
+    }
+
+    size_t get_vtable_count() const {
+        return m_vtable_count;
+    }
+
+    size_t get_bytes_scanned() const {
+        return m_bytes_scanned;
+    }
+
+    std::chrono::nanoseconds get_build_time() const {
+        return m_build_time;
+    }
+
+private:
+    uintptr_t m_module{};
+    std::unordered_map<std::string, Class> m_classes{};
+    size_t m_vtable_count{0};
+    size_t m_bytes_scanned{0};
+    std::chrono::nanoseconds m_build_time{};
+};
+}
@@ -0,0 +1,525 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "Hash.hpp"
+#include "Pe.hpp"
+#include "ScanCache.hpp"
+
+namespace analysis {
+uint64_t fingerprint_module(uintptr_t module) {
+    const auto base = (const uint8_t*)module;
+    const auto nt = pe::get_nt_headers(base);
+
+    if (nt == nullptr) {
+        return 0;
+    }
+
+    // The loader rewrites ImageBase when the image gets relocated, so we can't just hash the whole optional header.
+    const auto& opt = nt->optional_header;
+    auto hash = fnv1a_value(nt->file_header);
+    hash = fnv1a_value(opt.size_of_code, hash);
+    hash = fnv1a_value(opt.address_of_entry_point, hash);
+    hash = fnv1a_value(opt.size_of_image, hash);
+    hash = fnv1a_value(opt.check_sum, hash);
+
+    const auto sections = pe::get_sections(base);
+    return fnv1a(sections.data(), sections.size_bytes(), hash);
+}
+
+std::vector<uint64_t> ScanCache::get_live_fingerprints() const {
+    std::vector<uint64_t> live{};
+
+    for (const auto& [module, fingerprint] : m_fingerprints) {
+        if (fingerprint != 0 && m_modules.contains(fingerprint)) {
+            live.push_back(fingerprint);
+        }
+    }
+
+    return live;
+}
+
+uint64_t ScanCache::get_fingerprint(uintptr_t module) {
+    if (auto it = m_fingerprints.find(module); it != m_fingerprints.end()) {
+        return it->second;
+    }
+
+    const auto fingerprint = fingerprint_module(module);
+    m_fingerprints[module] = fingerprint;
+
+    return fingerprint;
+}
+
+std::optional<uint64_t> ScanCache::hash_prologue(uintptr_t module, uintptr_t address) {
+    const auto image_size = pe::get_image_size((const uint8_t*)module);
+
+    if (address < module || address + PROLOGUE_SIZE > module + image_size) {
+        return std::nullopt;
+    }
+
+    return fnv1a((const void*)address, PROLOGUE_SIZE);
+}
+
+std::optional<uintptr_t> ScanCache::get_address(uintptr_t module, std::string_view name) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+    const auto entries = m_modules.find(fingerprint);
+
+    if (fingerprint == 0 || entries == m_modules.end()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    const auto it = entries->second.find(std::string{name});
+
+    if (it == entries->second.end()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    const auto address = module + it->second.value;
+    const auto prologue_hash = hash_prologue(module, address);
+
+    if (!prologue_hash || *prologue_hash != it->second.prologue_hash) {
+        SPDLOG_WARN("[ScanCache] Prologue mismatch for {} at 0x{:x}, rescanning", name, address);
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    ++m_hits;
+    return address;
+}
+
+void ScanCache::set_address(uintptr_t module, std::string_view name, uintptr_t address) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+    const auto prologue_hash = hash_prologue(module, address);
+
+    if (fingerprint == 0 || !prologue_hash) {
+        return;
+    }
+
+    m_modules[fingerprint][std::string{name}] = Entry{address - module, *prologue_hash};
+    m_hints[std::string{name}].rva = (uint32_t)(address - module);
+    m_dirty = true;
+}
+
+std::optional<uint64_t> ScanCache::get_value(uintptr_t module, std::string_view name) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+    const auto entries = m_modules.find(fingerprint);
+
+    if (fingerprint == 0 || entries == m_modules.end()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    const auto it = entries->second.find(std::string{name});
+
+    if (it == entries->second.end()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    ++m_hits;
+    return it->second.value;
+}
+
+void ScanCache::set_value(uintptr_t module, std::string_view name, uint64_t value) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+
+    if (fingerprint == 0) {
+        return;
+    }
+
+    m_modules[fingerprint][std::string{name}] = Entry{value, 0};
+    m_dirty = true;
+}
+
+std::optional<std::vector<uint8_t>> ScanCache::get_blob(uintptr_t module, std::string_view name) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+    const auto entries = m_modules.find(fingerprint);
+
+    if (fingerprint == 0 || entries == m_modules.end()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    const auto it = entries->second.find(std::string{name});
+
+    if (it == entries->second.end() || it->second.blob.empty()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    ++m_hits;
+    return it->second.blob;
+}
+
+void ScanCache::set_blob(uintptr_t module, std::string_view name, std::vector<uint8_t> blob) {
+    std::scoped_lock _{m_mutex};
+
+    const auto fingerprint = get_fingerprint(module);
+
+    if (fingerprint == 0) {
+        return;
+    }
+
+    m_modules[fingerprint][std::string{name}] = Entry{0, 0, std::move(blob)};
+    m_dirty = true;
+}
+
+void ScanCache::invalidate(uintptr_t module, std::string_view name) {
+    std::scoped_lock _{m_mutex};
+
+    const auto entries = m_modules.find(get_fingerprint(module));
+
+    if (entries != m_modules.end() && entries->second.erase(std::string{name}) > 0) {
+        m_dirty = true;
+    }
+}
+
+std::optional<uint32_t> ScanCache::get_hint(std::string_view name) const {
+    std::scoped_lock _{m_mutex};
+
+    const auto it = m_hints.find(std::string{name});
+
+    // 0 means there's only a fingerprint
+    if (it == m_hints.end() || it->second.rva == 0) {
+        return std::nullopt;
+    }
+
+    return it->second.rva;
+}
+
+std::optional<std::vector<uint8_t>> ScanCache::get_function_fingerprint(std::string_view name) const {
+    std::scoped_lock _{m_mutex};
+
+    const auto it = m_hints.find(std::string{name});
+
+    if (it == m_hints.end() || it->second.fingerprint.empty()) {
+        return std::nullopt;
+    }
+
+    return it->second.fingerprint;
+}
+
+void ScanCache::set_function_fingerprint(std::string_view name, std::vector<uint8_t> fingerprint) {
+    std::scoped_lock _{m_mutex};
+
+    auto& hint = m_hints[std::string{name}];
+
+    // Set on every launch, only worth writing the file for if it changed
+    if (hint.fingerprint != fingerprint) {
+        hint.fingerprint = std::move(fingerprint);
+        m_dirty = true;
+    }
+}
+
+// Layout:
+// u32 magic, u32 version, u32 module count
+// per module: u64 fingerprint, u32 entry count
+// per entry: u16 name length, name, u64 value, u64 prologue hash, u32 blob size, blob
+// u32 hint count
+// per hint: u16 name length, name, u32 rva, u32 fingerprint size, fingerprint
+bool ScanCache::load(const std::filesystem::path& path) {
+    std::ifstream f{path, std::ios::binary};
+
+    if (!f) {
+        return false;
+    }
+
+    std::error_code ec{};
+    const auto file_size = std::filesystem::file_size(path, ec);
+
+    if (ec) {
+        return false;
+    }
+
+    const auto read = [&](auto& out) {
+        return (bool)f.read((char*)&out, sizeof(out));
+    };
+
+    // Counts and sizes come straight from the file, a corrupt one mustn't get us to allocate gigabytes before a read fails.
+    const auto fits = [&](uint64_t count, uint64_t size) {
+        const auto pos = (int64_t)f.tellg();
+        return pos >= 0 && (uint64_t)pos <= file_size && count * size <= file_size - (uint64_t)pos;
+    };
+
+    uint32_t magic{}, version{}, module_count{};
+
+    if (!read(magic) || !read(version) || !read(module_count) || magic != MAGIC || version != VERSION) {
+        SPDLOG_WARN("[ScanCache] Ignoring incompatible cache file {}", path.string());
+        return false;
+    }
+
+    if (!fits(module_count, MIN_MODULE_SIZE)) {
+        return false;
+    }
+
+    decltype(m_modules) modules{};
+
+    for (uint32_t i = 0; i < module_count; ++i) {
+        uint64_t fingerprint{};
+        uint32_t entry_count{};
+
+        if (!read(fingerprint) || !read(entry_count) || !fits(entry_count, MIN_ENTRY_SIZE)) {
+            return false;
+        }
+
+        auto& entries = modules[fingerprint];
+
+        for (uint32_t j = 0; j < entry_count; ++j) {
+            uint16_t name_len{};
+            Entry entry{};
+
+            if (!read(name_len) || !fits(name_len, 1)) {
+                return false;
+            }
+
+            std::string name(name_len, '\0');
+
+            uint32_t blob_size{};
+
+            if (!f.read(name.data(), name_len) || !read(entry.value) || !read(entry.prologue_hash) || !read(blob_size) || !fits(blob_size, 1)) {
+                return false;
+            }
+
+            entry.blob.resize(blob_size);
+
+            if (!f.read((char*)entry.blob.data(), blob_size)) {
+                return false;
+            }
+
+            entries[std::move(name)] = std::move(entry);
+        }
+    }
+
+    decltype(m_hints) hints{};
+    uint32_t hint_count{};
+
+    if (!read(hint_count) || !fits(hint_count, MIN_HINT_SIZE)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < hint_count; ++i) {
+        uint16_t name_len{};
+        Hint hint{};
+
+        if (!read(name_len) || !fits(name_len, 1)) {
+            return false;
+        }
+
+        std::string name(name_len, '\0');
+        uint32_t fingerprint_size{};
+
+        if (!f.read(name.data(), name_len) || !read(hint.rva) || !read(fingerprint_size) || !fits(fingerprint_size, 1)) {
+            return false;
+        }
+
+        hint.fingerprint.resize(fingerprint_size);
+
+        if (!f.read((char*)hint.fingerprint.data(), fingerprint_size)) {
+            return false;
+        }
+
+        hints[std::move(name)] = std::move(hint);
+    }
+
+    std::scoped_lock _{m_mutex};
+    m_modules = std::move(modules);
+    m_hints = std::move(hints);
+    m_dirty = false;
+
+    SPDLOG_INFO("[ScanCache] Loaded {} module(s) from {}", module_count, path.string());
+    return true;
+}
+
+bool ScanCache::save(const std::filesystem::path& path) {
+    std::scoped_lock _{m_mutex};
+
+    std::error_code ec{};
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Written next to the real file and renamed over it, so a crash or a full disk halfway through leaves the old cache intact.
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    std::ofstream f{temp_path, std::ios::binary | std::ios::trunc};
+
+    if (!f) {
+        SPDLOG_ERROR("[ScanCache] Failed to open {} for writing", temp_path.string());
+        return false;
+    }
+
+    const auto write = [&](const auto& in) {
+        f.write((const char*)&in, sizeof(in));
+    };
+
+    std::vector<uint8_t> modules{};
+    write_modules(modules);
+
+    write(MAGIC);
+    write(VERSION);
+    f.write((const char*)modules.data(), modules.size());
+
+    write((uint32_t)m_hints.size());
+
+    for (const auto& [name, hint] : m_hints) {
+        write((uint16_t)name.size());
+        f.write(name.data(), name.size());
+        write(hint.rva);
+        write((uint32_t)hint.fingerprint.size());
+        f.write((const char*)hint.fingerprint.data(), hint.fingerprint.size());
+    }
+
+    f.close();
+
+    if (!f) {
+        SPDLOG_ERROR("[ScanCache] Failed to write {}", temp_path.string());
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, path, ec);
+
+    if (ec) {
+        SPDLOG_ERROR("[ScanCache] Failed to replace {}: {}", path.string(), ec.message());
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+// Only keeps entries for modules that are actually loaded, stale builds just take up space.
+void ScanCache::write_modules(std::vector<uint8_t>& out) {
+    const auto write = [&](const void* data, size_t size) {
+        out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+    };
+
+    const auto write_value = [&](const auto& in) {
+        write(&in, sizeof(in));
+    };
+
+    const auto live = get_live_fingerprints();
+    write_value((uint32_t)live.size());
+
+    for (const auto fingerprint : live) {
+        const auto& entries = m_modules[fingerprint];
+
+        write_value(fingerprint);
+        write_value((uint32_t)entries.size());
+
+        for (const auto& [name, entry] : entries) {
+            write_value((uint16_t)name.size());
+            write(name.data(), name.size());
+            write_value(entry.value);
+            write_value(entry.prologue_hash);
+            write_value((uint32_t)entry.blob.size());
+            write(entry.blob.data(), entry.blob.size());
+        }
+    }
+}
+
+std::vector<uint8_t> ScanCache::serialize_modules() {
+    std::scoped_lock _{m_mutex};
+
+    std::vector<uint8_t> out{};
+    write_modules(out);
+
+    return out;
+}
+
+bool ScanCache::merge_modules(std::span<const uint8_t> data) {
+    size_t pos = 0;
+
+    const auto read = [&](void* out, size_t size) {
+        if (data.size() - pos < size) {
+            return false;
+        }
+
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+        return true;
+    };
+
+    const auto read_value = [&](auto& out) {
+        return read(&out, sizeof(out));
+    };
+
+    const auto fits = [&](uint64_t count, uint64_t size) {
+        return count * size <= data.size() - pos;
+    };
+
+    uint32_t module_count{};
+
+    if (!read_value(module_count) || !fits(module_count, MIN_MODULE_SIZE)) {
+        return false;
+    }
+
+    decltype(m_modules) modules{};
+
+    for (uint32_t i = 0; i < module_count; ++i) {
+        uint64_t fingerprint{};
+        uint32_t entry_count{};
+
+        if (!read_value(fingerprint) || !read_value(entry_count) || !fits(entry_count, MIN_ENTRY_SIZE)) {
+            return false;
+        }
+
+        auto& entries = modules[fingerprint];
+
+        for (uint32_t j = 0; j < entry_count; ++j) {
+            uint16_t name_len{};
+            uint32_t blob_size{};
+            Entry entry{};
+
+            if (!read_value(name_len) || !fits(name_len, 1)) {
+                return false;
+            }
+
+            std::string name(name_len, '\0');
+
+            if (!read(name.data(), name_len) || !read_value(entry.value) || !read_value(entry.prologue_hash) || !read_value(blob_size) || !fits(blob_size, 1)) {
+                return false;
+            }
+
+            entry.blob.resize(blob_size);
+
+            if (!read(entry.blob.data(), blob_size)) {
+                return false;
+            }
+
+            entries[std::move(name)] = std::move(entry);
+        }
+    }
+
+    std::scoped_lock _{m_mutex};
+
+    for (auto& [fingerprint, entries] : modules) {
+        auto& existing = m_modules[fingerprint];
+
+        for (auto& [name, entry] : entries) {
+            auto& slot = existing[name];
+
+            if (slot.value != entry.value || slot.prologue_hash != entry.prologue_hash || slot.blob != entry.blob) {
+                slot = std::move(entry);
+                m_dirty = true;
+            }
+        }
+    }
+
+    return true;
+}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace analysis {
+// Fast hash of the PE headers and section table of a mapped image.
+// Changes whenever the game (or D3D12Core.dll) gets updated.
+uint64_t fingerprint_module(uintptr_t module);
+
+// Persists the results of signature scans between launches.
+// Addresses are stored as RVAs per module fingerprint, along with a hash of the bytes
+// at the address so we can tell if something else has changed them since.
+// The last RVA (and fingerprint) of every address also survives game updates as a hint for where to rescan.
+class ScanCache {
+public:
+    static constexpr uint32_t MAGIC = 0x43374646; // FF7C
+    static constexpr uint32_t VERSION = 4;
+    static constexpr size_t PROLOGUE_SIZE = 16;
+
+    bool load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path);
+
+    // Entries of every module looked up so far, in the same layout as the module part of the file.
+    // merge() adds them back on top of whatever is already loaded, for handing results to another instance (see SharedScanState).
+    std::vector<uint8_t> serialize_modules();
+    bool merge_modules(std::span<const uint8_t> data);
+
+    // Only returns the address if the prologue hash still matches.
+    std::optional<uintptr_t> get_address(uintptr_t module, std::string_view name);
+    void set_address(uintptr_t module, std::string_view name, uintptr_t address);
+
+    // Derived values such as struct offsets. These are only validated against the module fingerprint.
+    std::optional<uint64_t> get_value(uintptr_t module, std::string_view name);
+    void set_value(uintptr_t module, std::string_view name, uint64_t value);
+
+    // Larger derived data such as whole tables, also only validated against the module fingerprint.
+    std::optional<std::vector<uint8_t>> get_blob(uintptr_t module, std::string_view name);
+    void set_blob(uintptr_t module, std::string_view name, std::vector<uint8_t> blob);
+
+    void invalidate(uintptr_t module, std::string_view name);
+
+    // Last RVA set_address saw for name in any build, kept across updates as a place to start looking.
+    std::optional<uint32_t> get_hint(std::string_view name) const;
+
+    // Serialized Fingerprint of the function name resolved to, kept across updates like the hints.
+    std::optional<std::vector<uint8_t>> get_function_fingerprint(std::string_view name) const;
+    void set_function_fingerprint(std::string_view name, std::vector<uint8_t> fingerprint);
+
+    bool is_dirty() const {
+        std::scoped_lock _{m_mutex};
+        return m_dirty;
+    }
+
+    size_t get_hits() const {
+        std::scoped_lock _{m_mutex};
+        return m_hits;
+    }
+
+    size_t get_misses() const {
+        std::scoped_lock _{m_mutex};
+        return m_misses;
+    }
+
+private:
+    // Smallest serialized module, entry and hint, for checking counts against what's left of the data
+    static constexpr size_t MIN_MODULE_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    static constexpr size_t MIN_ENTRY_SIZE = sizeof(uint16_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    static constexpr size_t MIN_HINT_SIZE = sizeof(uint16_t) + 2 * sizeof(uint32_t);
+
+    struct Entry {
+        uint64_t value{};
+        uint64_t prologue_hash{};
+        std::vector<uint8_t> blob{};
+    };
+
+    using Entries = std::unordered_map<std::string, Entry>;
+
+    struct Hint {
+        uint32_t rva{};
+        std::vector<uint8_t> fingerprint{};
+    };
+
+    uint64_t get_fingerprint(uintptr_t module);
+    std::vector<uint64_t> get_live_fingerprints() const;
+    void write_modules(std::vector<uint8_t>& out);
+    static std::optional<uint64_t> hash_prologue(uintptr_t module, uintptr_t address);
+
+    // Hook resolution runs on multiple threads.
+    mutable std::mutex m_mutex{};
+    std::unordered_map<uint64_t, Entries> m_modules{};
+    std::unordered_map<uintptr_t, uint64_t> m_fingerprints{};
+    std::unordered_map<std::string, Hint> m_hints{};
+    size_t m_hits{0};
+    size_t m_misses{0};
+    bool m_dirty{false};
+};
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Pe.hpp"
+#include "ScanRegion.hpp"
+
+namespace analysis {
+const char* to_string(RegionKind kind) {
+    switch (kind) {
+    case RegionKind::CODE:
+        return "code";
+    case RegionKind::READ_ONLY:
+        return "read-only";
+    case RegionKind::RDATA:
+        return ".rdata";
+    default:
+        return "unknown";
+    }
+}
+
+std::vector<ScanRegion> get_scan_regions(uintptr_t module, RegionKind kind) {
+    const auto base = (const uint8_t*)module;
+    const auto nt = pe::get_nt_headers(base);
+
+    if (nt == nullptr) {
+        return {};
+    }
+
+    const auto& opt = nt->optional_header;
+    const auto resources = opt.number_of_rva_and_sizes > pe::DIRECTORY_ENTRY_RESOURCE ? opt.data_directory[pe::DIRECTORY_ENTRY_RESOURCE] : pe::DataDirectory{};
+    const auto sections = pe::get_sections(base);
+
+    const auto has_rdata = std::any_of(sections.begin(), sections.end(), [](const pe::SectionHeader& s) {
+        return std::strncmp(s.name, ".rdata", sizeof(s.name)) == 0;
+    });
+
+    std::vector<ScanRegion> regions{};
+
+    for (const auto& section : sections) {
+        const auto c = section.characteristics;
+
+        if ((c & pe::SCN_MEM_READ) == 0 || section.virtual_size == 0) {
+            continue;
+        }
+
+        const auto is_code = (c & pe::SCN_MEM_EXECUTE) != 0;
+        const auto is_read_only = !is_code && (c & pe::SCN_MEM_WRITE) == 0 && (c & pe::SCN_CNT_INITIALIZED_DATA) != 0 && (c & pe::SCN_MEM_DISCARDABLE) == 0;
+        const auto is_resources = resources.virtual_address >= section.virtual_address && resources.virtual_address < section.virtual_address + section.virtual_size;
+
+        bool wanted = false;
+
+        switch (kind) {
+        case RegionKind::CODE:
+            wanted = is_code;
+            break;
+        case RegionKind::READ_ONLY:
+            wanted = is_read_only && !is_resources;
+            break;
+        case RegionKind::RDATA:
+            wanted = has_rdata ? std::strncmp(section.name, ".rdata", sizeof(section.name)) == 0 : is_read_only && !is_resources;
+            break;
+        }
+
+        if (!wanted) {
+            continue;
+        }
+
+        // Past the raw data the loader only hands out zero pages, nothing we look for can be there
+        auto size = (size_t)section.virtual_size;
+
+        if (section.size_of_raw_data != 0) {
+            size = std::min<size_t>(size, section.size_of_raw_data);
+        }
+
+        regions.push_back(ScanRegion{base + section.virtual_address, size});
+    }
+
+    return regions;
+}
+
+size_t get_total_size(std::span<const ScanRegion> regions) {
+    size_t total = 0;
+
+    for (const auto& region : regions) {
+        total += region.size;
+    }
+
+    return total;
+}
+
+uint64_t get_page_fault_count() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    counters.cb = sizeof(counters);
+
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+
+    return counters.PageFaultCount;
+#else
+    rusage usage{};
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+    return (uint64_t)usage.ru_minflt + (uint64_t)usage.ru_majflt;
+#endif
+}
+}
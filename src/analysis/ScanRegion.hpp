@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace analysis {
+// A contiguous range of a mapped image worth scanning.
+struct ScanRegion {
+    const uint8_t* begin{};
+    size_t size{};
+};
+
+enum class RegionKind : uint8_t {
+    CODE,      // executable sections
+    READ_ONLY, // non-writable initialized data: string literals, constants, vtables, .pdata
+    RDATA,     // just .rdata, where vtables live. Same as READ_ONLY if there is no section by that name
+};
+
+const char* to_string(RegionKind kind);
+
+// Regions of the given kind from the section table, so scans never touch .data, .bss, resources,
+// relocations or the zero filled tail past a section's raw data.
+std::vector<ScanRegion> get_scan_regions(uintptr_t module, RegionKind kind);
+
+size_t get_total_size(std::span<const ScanRegion> regions);
+
+// Page faults the process has taken so far (soft and hard).
+uint64_t get_page_fault_count();
+
+struct ScanStats {
+    size_t bytes_scanned{};
+    uint64_t page_faults{};
+    std::chrono::nanoseconds elapsed{};
+};
+
+// Measures the page faults and time between construction and stop().
+class ScanMeter {
+public:
+    ScanMeter()
+        : m_page_faults{get_page_fault_count()},
+        m_start{std::chrono::steady_clock::now()}
+    {
+    }
+
+    ScanStats stop(size_t bytes_scanned) const {
+        return ScanStats{bytes_scanned, get_page_fault_count() - m_page_faults, std::chrono::steady_clock::now() - m_start};
+    }
+
+private:
+    uint64_t m_page_faults{};
+    std::chrono::steady_clock::time_point m_start{};
+};
+}
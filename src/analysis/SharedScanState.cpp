@@ -0,0 +1,415 @@
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "ScanCache.hpp"
+#include "SharedScanState.hpp"
+
+namespace analysis {
+namespace detail {
+// Lives in its own small section, see SharedScanState.
+struct SharedDirectory {
+    uint32_t magic{};
+    uint32_t version{};
+    uint64_t generation{};
+    uint64_t size{};
+    uint64_t section{};   // handle of the current generation, kept open so the section outlives the instance that published it
+    uint64_t directory{}; // handle of the directory itself, same reason
+};
+
+struct SharedHeader {
+    uint32_t magic{};
+    uint32_t version{};
+    uint64_t fingerprint{};
+    uint64_t size{};
+    uint32_t blob_count{};
+    uint32_t reserved{};
+};
+
+// Offsets are from the start of the section.
+struct SharedBlob {
+    uint64_t name_offset{};
+    uint64_t offset{};
+    uint64_t size{};
+    uint32_t name_length{};
+    uint32_t reserved{};
+};
+
+constexpr size_t SHARED_ALIGNMENT = 16;
+
+size_t align_up(size_t value) {
+    return (value + SHARED_ALIGNMENT - 1) & ~(SHARED_ALIGNMENT - 1);
+}
+
+uint32_t get_pid() {
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+#ifdef _WIN32
+std::wstring get_section_name(std::optional<uint64_t> generation) {
+    auto name = L"Local\\FF7Plugin.ScanState." + std::to_wstring(get_pid());
+    return generation ? name + L"." + std::to_wstring(*generation) : name;
+}
+#else
+std::string get_section_name(std::optional<uint64_t> generation) {
+    auto name = "/ff7plugin.scanstate." + std::to_string(get_pid());
+    return generation ? name + "." + std::to_string(*generation) : name;
+}
+#endif
+
+// A mapped view of a named section, unmapped when it goes out of scope.
+// The section handle is only closed with it if release() wasn't called.
+class SharedSection {
+public:
+    enum class Mode {
+        OPEN_READ,
+        OPEN_WRITE,
+        CREATE_NEW,    // fails if the section already exists
+        OPEN_OR_CREATE,
+    };
+
+    SharedSection(std::optional<uint64_t> generation, Mode mode, size_t size = 0) {
+        const auto name = get_section_name(generation);
+        const auto writable = mode != Mode::OPEN_READ;
+#ifdef _WIN32
+        if (mode == Mode::OPEN_READ || mode == Mode::OPEN_WRITE) {
+            m_handle = OpenFileMappingW(writable ? FILE_MAP_WRITE : FILE_MAP_READ, FALSE, name.c_str());
+        } else {
+            m_handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name.c_str());
+            m_created = m_handle != nullptr && GetLastError() != ERROR_ALREADY_EXISTS;
+
+            if (mode == Mode::CREATE_NEW && m_handle != nullptr && !m_created) {
+                CloseHandle(m_handle);
+                m_handle = nullptr;
+            }
+        }
+
+        if (m_handle == nullptr) {
+            return;
+        }
+
+        m_data = (uint8_t*)MapViewOfFile(m_handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+
+        MEMORY_BASIC_INFORMATION mbi{};
+
+        if (m_data != nullptr && VirtualQuery(m_data, &mbi, sizeof(mbi)) != 0) {
+            m_size = mbi.RegionSize;
+        }
+#else
+        auto flags = writable ? O_RDWR : O_RDONLY;
+
+        if (mode == Mode::CREATE_NEW) {
+            flags |= O_CREAT | O_EXCL;
+        } else if (mode == Mode::OPEN_OR_CREATE) {
+            flags |= O_CREAT;
+        }
+
+        const auto fd = shm_open(name.c_str(), flags, 0600);
+
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat st{};
+        fstat(fd, &st);
+        m_created = mode == Mode::CREATE_NEW || (mode == Mode::OPEN_OR_CREATE && st.st_size == 0);
+
+        if (m_created && ftruncate(fd, (off_t)size) == 0) {
+            st.st_size = (off_t)size;
+        }
+
+        if (st.st_size > 0) {
+            const auto data = mmap(nullptr, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+
+            if (data != MAP_FAILED) {
+                m_data = (uint8_t*)data;
+                m_size = (size_t)st.st_size;
+            }
+        }
+
+        // The mapping keeps the object alive, the name keeps it around until shm_unlink
+        close(fd);
+#endif
+    }
+
+    ~SharedSection() {
+#ifdef _WIN32
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_handle != nullptr) {
+            CloseHandle(m_handle);
+        }
+#else
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    SharedSection(const SharedSection&) = delete;
+    SharedSection& operator=(const SharedSection&) = delete;
+
+    uint8_t* get_data() const {
+        return m_data;
+    }
+
+    // Rounded up to the page size.
+    size_t get_size() const {
+        return m_size;
+    }
+
+    bool was_created() const {
+        return m_created;
+    }
+
+    // Keeps the section alive after this object is gone, returns the handle to destroy it with later.
+    uint64_t release() {
+#ifdef _WIN32
+        return (uint64_t)std::exchange(m_handle, nullptr);
+#else
+        return 0;
+#endif
+    }
+
+    // Takes over the view, unmapping is up to the caller from now on.
+    uint8_t* release_view() {
+        return std::exchange(m_data, nullptr);
+    }
+
+    static void destroy([[maybe_unused]] uint64_t handle, [[maybe_unused]] std::optional<uint64_t> generation) {
+#ifdef _WIN32
+        if (handle != 0) {
+            CloseHandle((HANDLE)handle);
+        }
+#else
+        shm_unlink(get_section_name(generation).c_str());
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE m_handle{nullptr};
+#endif
+    uint8_t* m_data{nullptr};
+    size_t m_size{0};
+    bool m_created{false};
+};
+
+std::optional<SharedDirectory> read_directory() {
+    const SharedSection section{std::nullopt, SharedSection::Mode::OPEN_READ};
+
+    if (section.get_data() == nullptr || section.get_size() < sizeof(SharedDirectory)) {
+        return std::nullopt;
+    }
+
+    SharedDirectory directory{};
+    std::memcpy(&directory, section.get_data(), sizeof(directory));
+
+    if (directory.magic != SharedScanState::MAGIC || directory.version != SharedScanState::VERSION || directory.generation == 0) {
+        return std::nullopt;
+    }
+
+    return directory;
+}
+}
+
+std::unique_ptr<SharedScanState> SharedScanState::attach(uintptr_t module) {
+    const auto directory = detail::read_directory();
+
+    if (!directory) {
+        return nullptr;
+    }
+
+    detail::SharedSection section{directory->generation, detail::SharedSection::Mode::OPEN_READ};
+    const auto data = section.get_data();
+
+    if (data == nullptr || section.get_size() < sizeof(detail::SharedHeader)) {
+        SPDLOG_WARN("[SharedScanState] Generation {} is gone", directory->generation);
+        return nullptr;
+    }
+
+    detail::SharedHeader header{};
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != MAGIC || header.version != VERSION || header.size > section.get_size()) {
+        SPDLOG_WARN("[SharedScanState] Ignoring incompatible state from generation {}", directory->generation);
+        return nullptr;
+    }
+
+    if (header.fingerprint != fingerprint_module(module)) {
+        SPDLOG_WARN("[SharedScanState] Ignoring state from generation {}, it was published for a different build", directory->generation);
+        return nullptr;
+    }
+
+    if (sizeof(header) + (uint64_t)header.blob_count * sizeof(detail::SharedBlob) > header.size) {
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < header.blob_count; ++i) {
+        detail::SharedBlob blob{};
+        std::memcpy(&blob, data + sizeof(header) + i * sizeof(blob), sizeof(blob));
+
+        if (blob.name_offset > header.size || blob.name_length > header.size - blob.name_offset || blob.offset > header.size || blob.size > header.size - blob.offset) {
+            SPDLOG_WARN("[SharedScanState] Blob {} of generation {} is out of bounds", i, directory->generation);
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<SharedScanState> result{new SharedScanState{}};
+    result->m_size = section.get_size();
+    result->m_data = section.release_view();
+    result->m_generation = directory->generation;
+
+    SPDLOG_INFO("[SharedScanState] Attached to generation {}, {} blob(s), {:.1f} MiB", directory->generation, header.blob_count, header.size / (1024.0 * 1024.0));
+    return result;
+}
+
+bool SharedScanState::publish(uintptr_t module, std::span<const Blob> blobs) {
+    const auto fingerprint = fingerprint_module(module);
+
+    if (fingerprint == 0) {
+        return false;
+    }
+
+    // Directory first, creating it keeps its handle open for good.
+    detail::SharedSection directory_section{std::nullopt, detail::SharedSection::Mode::OPEN_OR_CREATE, sizeof(detail::SharedDirectory)};
+
+    if (directory_section.get_data() == nullptr) {
+        SPDLOG_ERROR("[SharedScanState] Failed to open the directory");
+        return false;
+    }
+
+    detail::SharedDirectory directory{};
+
+    if (!directory_section.was_created()) {
+        std::memcpy(&directory, directory_section.get_data(), sizeof(directory));
+
+        if (directory.magic != MAGIC || directory.version != VERSION) {
+            directory = {};
+        }
+    }
+
+    // Header, blob table, then names and data
+    size_t size = sizeof(detail::SharedHeader) + blobs.size() * sizeof(detail::SharedBlob);
+
+    for (const auto& blob : blobs) {
+        size = detail::align_up(size + blob.name.size()) + blob.data.size();
+    }
+
+    const auto generation = directory.generation + 1;
+    detail::SharedSection section{generation, detail::SharedSection::Mode::CREATE_NEW, size};
+    const auto data = section.get_data();
+
+    if (data == nullptr) {
+        SPDLOG_ERROR("[SharedScanState] Failed to create generation {} ({} bytes)", generation, size);
+        return false;
+    }
+
+    const detail::SharedHeader header{MAGIC, VERSION, fingerprint, size, (uint32_t)blobs.size()};
+    std::memcpy(data, &header, sizeof(header));
+
+    size_t pos = sizeof(header) + blobs.size() * sizeof(detail::SharedBlob);
+
+    for (size_t i = 0; i < blobs.size(); ++i) {
+        const auto& blob = blobs[i];
+
+        detail::SharedBlob entry{};
+        entry.name_offset = pos;
+        entry.name_length = (uint32_t)blob.name.size();
+        std::memcpy(data + pos, blob.name.data(), blob.name.size());
+
+        pos = detail::align_up(pos + blob.name.size());
+        entry.offset = pos;
+        entry.size = blob.data.size();
+        std::memcpy(data + pos, blob.data.data(), blob.data.size());
+
+        pos += blob.data.size();
+        std::memcpy(data + sizeof(header) + i * sizeof(entry), &entry, sizeof(entry));
+    }
+
+    const auto previous = directory;
+
+    directory.magic = MAGIC;
+    directory.version = VERSION;
+    directory.generation = generation;
+    directory.size = size;
+    directory.section = section.release();
+
+    if (directory_section.was_created()) {
+        directory.directory = directory_section.release();
+    }
+
+    std::memcpy(directory_section.get_data(), &directory, sizeof(directory));
+
+    if (previous.generation != 0) {
+        detail::SharedSection::destroy(previous.section, previous.generation);
+    }
+
+    SPDLOG_INFO("[SharedScanState] Published generation {}, {} blob(s), {:.1f} MiB", generation, blobs.size(), size / (1024.0 * 1024.0));
+    return true;
+}
+
+void SharedScanState::remove() {
+    const auto directory = detail::read_directory();
+
+    if (directory) {
+        detail::SharedSection::destroy(directory->section, directory->generation);
+    }
+
+    // Zeroed in case another handle to it is still open
+    {
+        const detail::SharedSection section{std::nullopt, detail::SharedSection::Mode::OPEN_WRITE};
+
+        if (section.get_data() != nullptr) {
+            std::memset(section.get_data(), 0, sizeof(detail::SharedDirectory));
+        }
+    }
+
+    detail::SharedSection::destroy(directory ? directory->directory : 0, std::nullopt);
+}
+
+SharedScanState::~SharedScanState() {
+    if (m_data == nullptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap((void*)m_data, m_size);
+#endif
+}
+
+std::optional<std::span<const uint8_t>> SharedScanState::get(std::string_view name) const {
+    detail::SharedHeader header{};
+    std::memcpy(&header, m_data, sizeof(header));
+
+    for (uint32_t i = 0; i < header.blob_count; ++i) {
+        detail::SharedBlob blob{};
+        std::memcpy(&blob, m_data + sizeof(header) + i * sizeof(blob), sizeof(blob));
+
+        if (std::string_view{(const char*)m_data + blob.name_offset, blob.name_length} == name) {
+            return std::span<const uint8_t>{m_data + blob.offset, blob.size};
+        }
+    }
+
+    return std::nullopt;
+}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace analysis {
+// Scan results published into named shared memory that lives as long as the process does,
+// so a plugin instance that gets hot reloaded can attach to what the previous one found instead of scanning again.
+//
+// The section only holds named blobs (ScanCache::serialize_modules, serialized indexes) at offsets from its start,
+// so nothing in it depends on where the section or the plugin DLL get mapped. It's tagged with the game module's
+// fingerprint, attaching to a section published for a different build of the game fails.
+//
+// Every publish writes a new generation and retires the previous one. A small directory section
+// (one per process, never closed) says which generation is current.
+class SharedScanState {
+public:
+    static constexpr uint32_t MAGIC = 0x53374646; // FF7S
+    static constexpr uint32_t VERSION = 1;
+
+    struct Blob {
+        std::string name{};
+        std::vector<uint8_t> data{};
+    };
+
+    // Maps the current generation read-only, nullptr if nothing was published or it doesn't match module.
+    static std::unique_ptr<SharedScanState> attach(uintptr_t module);
+
+    // Replaces whatever was published before in this process.
+    static bool publish(uintptr_t module, std::span<const Blob> blobs);
+
+    // Drops the published state. The game process exiting does the same on Windows, elsewhere it has to be explicit.
+    static void remove();
+
+    ~SharedScanState();
+
+    SharedScanState(const SharedScanState&) = delete;
+    SharedScanState& operator=(const SharedScanState&) = delete;
+
+    // Views into the mapping, valid for as long as this object is.
+    std::optional<std::span<const uint8_t>> get(std::string_view name) const;
+
+    uint64_t get_generation() const {
+        return m_generation;
+    }
+
+    size_t get_size() const {
+        return m_size;
+    }
+
+private:
+    SharedScanState() = default;
+
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+    uint64_t m_generation{0};
+};
+}
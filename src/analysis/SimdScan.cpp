@@ -0,0 +1,253 @@
+#include <bit>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include <immintrin.h>
+
+#include "SimdScan.hpp"
+
+// MSVC lets us use any intrinsic without changing the target of the whole translation unit,
+// GCC and Clang need it per function.
+#if defined(__GNUC__) || defined(__clang__)
+#define ANALYSIS_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#define ANALYSIS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,bmi")))
+#else
+#define ANALYSIS_TARGET_AVX2
+#define ANALYSIS_TARGET_AVX512
+#endif
+
+namespace analysis::simd {
+namespace detail {
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t (&out)[4]) {
+#if defined(_MSC_VER)
+    __cpuidex((int*)out, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, out[0], out[1], out[2], out[3]);
+#endif
+}
+
+uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax{}, edx{};
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+// Calls cb for every verified match until it returns false.
+template <typename T>
+void scan_scalar(const uint8_t* begin, const uint8_t* end, const CompiledPattern& cp, T&& cb) {
+    const auto size = cp.pattern.size();
+
+    if (size == 0 || (size_t)(end - begin) < size) {
+        return;
+    }
+
+    const auto last = end - size;
+
+    for (auto p = begin; p <= last; ++p) {
+        if (cp.pattern.matches(p) && !cb(p)) {
+            return;
+        }
+    }
+}
+
+template <typename T>
+ANALYSIS_TARGET_AVX2 void scan_avx2(const uint8_t* begin, const uint8_t* end, const CompiledPattern& cp, T&& cb) {
+    const auto size = cp.pattern.size();
+
+    if (size == 0 || (size_t)(end - begin) < size) {
+        return;
+    }
+
+    const auto last = end - size;
+
+    __m256i needles[CompiledPattern::MAX_VECTOR_BYTES]{};
+
+    for (size_t i = 0; i < cp.count; ++i) {
+        needles[i] = _mm256_set1_epi8((char)cp.values[i]);
+    }
+
+    auto p = begin;
+
+    // Every position in [p, p + 32) is a valid start, so loads at p + offset can't run past end.
+    for (; last - p >= 31; p += 32) {
+        uint32_t bits = 0xFFFFFFFF;
+
+        for (size_t i = 0; i < cp.count && bits != 0; ++i) {
+            const auto block = _mm256_loadu_si256((const __m256i*)(p + cp.offsets[i]));
+            bits &= (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needles[i]));
+        }
+
+        while (bits != 0) {
+            const auto candidate = p + std::countr_zero(bits);
+
+            if (cp.pattern.matches(candidate) && !cb(candidate)) {
+                return;
+            }
+
+            bits &= bits - 1;
+        }
+    }
+
+    scan_scalar(p, end, cp, cb);
+}
+
+template <typename T>
+ANALYSIS_TARGET_AVX512 void scan_avx512(const uint8_t* begin, const uint8_t* end, const CompiledPattern& cp, T&& cb) {
+    const auto size = cp.pattern.size();
+
+    if (size == 0 || (size_t)(end - begin) < size) {
+        return;
+    }
+
+    const auto last = end - size;
+
+    __m512i needles[CompiledPattern::MAX_VECTOR_BYTES]{};
+
+    for (size_t i = 0; i < cp.count; ++i) {
+        needles[i] = _mm512_set1_epi8((char)cp.values[i]);
+    }
+
+    auto p = begin;
+
+    for (; last - p >= 63; p += 64) {
+        uint64_t bits = ~0ULL;
+
+        for (size_t i = 0; i < cp.count && bits != 0; ++i) {
+            const auto block = _mm512_loadu_si512((const void*)(p + cp.offsets[i]));
+            bits &= _mm512_cmpeq_epi8_mask(block, needles[i]);
+        }
+
+        while (bits != 0) {
+            const auto candidate = p + std::countr_zero(bits);
+
+            if (cp.pattern.matches(candidate) && !cb(candidate)) {
+                return;
+            }
+
+            bits &= bits - 1;
+        }
+    }
+
+    scan_scalar(p, end, cp, cb);
+}
+
+template <typename T>
+void scan(const uint8_t* begin, size_t size, const CompiledPattern& cp, Isa isa, T&& cb) {
+    // Patterns that are nothing but wildcards can't be vectorized this way
+    if (cp.count == 0) {
+        isa = Isa::SCALAR;
+    }
+
+    switch (isa) {
+    case Isa::AVX512:
+        scan_avx512(begin, begin + size, cp, cb);
+        break;
+    case Isa::AVX2:
+        scan_avx2(begin, begin + size, cp, cb);
+        break;
+    default:
+        scan_scalar(begin, begin + size, cp, cb);
+        break;
+    }
+}
+}
+
+const char* to_string(Isa isa) {
+    switch (isa) {
+    case Isa::AVX512:
+        return "AVX-512";
+    case Isa::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+Isa detect_isa() {
+    uint32_t regs[4]{};
+    detail::cpuid(0, 0, regs);
+
+    const auto max_leaf = regs[0];
+
+    if (max_leaf < 7) {
+        return Isa::SCALAR;
+    }
+
+    detail::cpuid(1, 0, regs);
+
+    // OS has to support saving the extended state for us to use it
+    const auto osxsave = (regs[2] & (1u << 27)) != 0;
+
+    if (!osxsave) {
+        return Isa::SCALAR;
+    }
+
+    const auto xcr0 = detail::xgetbv0();
+
+    detail::cpuid(7, 0, regs);
+
+    const auto avx2 = (regs[1] & (1u << 5)) != 0;
+    const auto avx512f = (regs[1] & (1u << 16)) != 0;
+    const auto avx512bw = (regs[1] & (1u << 30)) != 0;
+    const auto bmi1 = (regs[1] & (1u << 3)) != 0;
+
+    const auto ymm_state = (xcr0 & 0x6) == 0x6;
+    const auto zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+    if (avx512f && avx512bw && bmi1 && zmm_state) {
+        return Isa::AVX512;
+    }
+
+    if (avx2 && bmi1 && ymm_state) {
+        return Isa::AVX2;
+    }
+
+    return Isa::SCALAR;
+}
+
+Isa get_isa() {
+    static const auto isa = detect_isa();
+    return isa;
+}
+
+CompiledPattern CompiledPattern::compile(Pattern pattern) {
+    CompiledPattern result{};
+
+    for (size_t i = 0; i < pattern.size() && result.count < MAX_VECTOR_BYTES; ++i) {
+        if (pattern.mask[i] == 0xFF) {
+            result.values[result.count] = pattern.bytes[i];
+            result.offsets[result.count] = (uint32_t)i;
+            ++result.count;
+        }
+    }
+
+    result.pattern = std::move(pattern);
+    return result;
+}
+
+std::optional<uintptr_t> find_first(const uint8_t* begin, size_t size, const CompiledPattern& pattern, Isa isa) {
+    std::optional<uintptr_t> result{};
+
+    detail::scan(begin, size, pattern, isa, [&](const uint8_t* p) {
+        result = (uintptr_t)p;
+        return false;
+    });
+
+    return result;
+}
+
+void find_all(const uint8_t* begin, size_t size, const CompiledPattern& pattern, std::vector<uintptr_t>& out, Isa isa) {
+    detail::scan(begin, size, pattern, isa, [&](const uint8_t* p) {
+        out.push_back((uintptr_t)p);
+        return true;
+    });
+}
+}
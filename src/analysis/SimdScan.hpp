@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Pattern.hpp"
+
+// Vectorized single pattern search.
+// Compares 32 (AVX2) or 64 (AVX-512BW) candidate positions per iteration against a handful of
+// broadcast pattern bytes, then verifies the surviving candidates against the full mask.
+// The widest instruction set the CPU supports is picked at runtime.
+namespace analysis::simd {
+enum class Isa : uint8_t {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+const char* to_string(Isa isa);
+
+// Widest ISA supported by both the CPU and the OS.
+Isa detect_isa();
+
+// detect_isa(), cached after the first call.
+Isa get_isa();
+
+struct CompiledPattern {
+    static constexpr size_t MAX_VECTOR_BYTES = 4;
+
+    Pattern pattern{};
+
+    // Fixed bytes that get compared for every candidate in the vector loop.
+    std::array<uint8_t, MAX_VECTOR_BYTES> values{};
+    std::array<uint32_t, MAX_VECTOR_BYTES> offsets{};
+    size_t count{0};
+
+    static CompiledPattern compile(Pattern pattern);
+};
+
+std::optional<uintptr_t> find_first(const uint8_t* begin, size_t size, const CompiledPattern& pattern, Isa isa = get_isa());
+void find_all(const uint8_t* begin, size_t size, const CompiledPattern& pattern, std::vector<uintptr_t>& out, Isa isa = get_isa());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "AnchorScan.hpp"
+#include "ByteFrequency.hpp"
+#include "Pattern.hpp"
+
+namespace analysis {
+// An IDA style signature parsed at compile time, e.g. StaticPattern{"48 8D 0D ? ? ? ? E8"}.
+// A malformed signature fails to compile instead of failing at runtime, and the anchor
+// (the rarest fixed byte according to X64_BYTE_FREQUENCY) is picked once up front.
+// N is the length of the string literal which is always enough room for the bytes.
+template <size_t N>
+struct StaticPattern {
+    std::array<uint8_t, N> bytes{};
+    std::array<uint8_t, N> mask{};
+    size_t size{};
+    size_t anchor{};
+
+    consteval StaticPattern(const char (&ida)[N]) {
+        constexpr auto hex = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+
+        for (size_t i = 0; i + 1 < N;) {
+            if (ida[i] == ' ') {
+                ++i;
+                continue;
+            }
+
+            if (ida[i] == '?') {
+                bytes[size] = 0;
+                mask[size] = 0;
+                ++size;
+                i += (i + 2 < N && ida[i + 1] == '?') ? 2 : 1;
+                continue;
+            }
+
+            const auto hi = hex(ida[i]);
+            const auto lo = i + 2 < N ? hex(ida[i + 1]) : -1;
+
+            if (hi < 0 || lo < 0) {
+                throw std::invalid_argument{"malformed signature"};
+            }
+
+            bytes[size] = (uint8_t)(hi << 4 | lo);
+            mask[size] = 0xFF;
+            ++size;
+            i += 2;
+        }
+
+        if (size == 0) {
+            throw std::invalid_argument{"empty signature"};
+        }
+
+        anchor = find_rarest_fixed_byte(bytes, mask, size);
+    }
+
+    AnchoredPattern anchored() const {
+        return AnchoredPattern{bytes.data(), mask.data(), size, anchor};
+    }
+
+    Pattern to_pattern() const {
+        Pattern result{};
+        result.bytes.assign(bytes.begin(), bytes.begin() + size);
+        result.mask.assign(mask.begin(), mask.begin() + size);
+        return result;
+    }
+};
+}
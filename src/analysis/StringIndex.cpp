@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "Hash.hpp"
+#include "Pe.hpp"
+#include "ScanRegion.hpp"
+#include "StringIndex.hpp"
+
+namespace analysis {
+namespace detail {
+bool is_printable(uint32_t c) {
+    return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Only the BMP matters for the literals we look up, anything else becomes U+FFFD.
+std::u16string utf8_to_utf16(std::string_view str) {
+    std::u16string result{};
+    result.reserve(str.size());
+
+    for (size_t i = 0; i < str.size();) {
+        const auto c = (uint8_t)str[i];
+
+        if (c < 0x80) {
+            result.push_back(c);
+            i += 1;
+        } else if ((c & 0xE0) == 0xC0 && i + 1 < str.size()) {
+            result.push_back((char16_t)(((c & 0x1F) << 6) | (str[i + 1] & 0x3F)));
+            i += 2;
+        } else if ((c & 0xF0) == 0xE0 && i + 2 < str.size()) {
+            result.push_back((char16_t)(((c & 0x0F) << 12) | ((str[i + 1] & 0x3F) << 6) | (str[i + 2] & 0x3F)));
+            i += 3;
+        } else {
+            result.push_back(0xFFFD);
+            i += 1;
+        }
+    }
+
+    return result;
+}
+}
+
+void StringIndex::build(uintptr_t module, size_t min_length) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto base = (const uint8_t*)module;
+
+    m_module = module;
+    m_entries.clear();
+
+    m_bytes_scanned = 0;
+
+    for (const auto& region : get_scan_regions(module, RegionKind::READ_ONLY)) {
+        const auto begin = region.begin;
+        const auto end = begin + region.size;
+
+        m_bytes_scanned += region.size;
+
+        // Narrow
+        for (auto p = begin; p < end;) {
+            const auto run_start = p;
+
+            while (p < end && detail::is_printable(*p)) {
+                ++p;
+            }
+
+            const auto length = (size_t)(p - run_start);
+
+            if (p < end && *p == 0 && length >= min_length) {
+                m_entries.push_back(Entry{fnv1a(run_start, length), (uint32_t)(run_start - base), (uint32_t)length, Encoding::NARROW});
+            }
+
+            ++p;
+        }
+
+        // UTF-16LE, MSVC always aligns these to 2 bytes
+        for (auto p = begin; p + 1 < end;) {
+            const auto run_start = p;
+
+            while (p + 1 < end && p[1] == 0 && detail::is_printable(p[0])) {
+                p += 2;
+            }
+
+            const auto length = (size_t)(p - run_start) / 2;
+
+            if (p + 1 < end && p[0] == 0 && p[1] == 0 && length >= min_length) {
+                m_entries.push_back(Entry{fnv1a(run_start, length * 2), (uint32_t)(run_start - base), (uint32_t)length, Encoding::UTF16});
+            }
+
+            p += 2;
+        }
+    }
+
+    std::sort(m_entries.begin(), m_entries.end());
+    m_entries.shrink_to_fit();
+
+    m_build_time = std::chrono::steady_clock::now() - start;
+}
+
+std::vector<uint8_t> StringIndex::serialize() const {
+    const auto count = (uint32_t)m_entries.size();
+    std::vector<uint8_t> data(sizeof(count) + m_entries.size() * sizeof(Entry));
+
+    std::memcpy(data.data(), &count, sizeof(count));
+    std::memcpy(data.data() + sizeof(count), m_entries.data(), m_entries.size() * sizeof(Entry));
+
+    return data;
+}
+
+bool StringIndex::deserialize(uintptr_t module, std::span<const uint8_t> data) {
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t count{};
+
+    if (data.size() < sizeof(count)) {
+        return false;
+    }
+
+    std::memcpy(&count, data.data(), sizeof(count));
+
+    if (data.size() != sizeof(count) + (size_t)count * sizeof(Entry)) {
+        return false;
+    }
+
+    std::vector<Entry> entries(count);
+    std::memcpy(entries.data(), data.data() + sizeof(count), count * sizeof(Entry));
+
+    // find() reads the literal itself to rule out hash collisions, so the whole string has to be inside the image
+    const auto image_size = pe::get_image_size((const uint8_t*)module);
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+        const auto char_size = e.encoding == Encoding::UTF16 ? sizeof(char16_t) : sizeof(char);
+
+        if (e.encoding > Encoding::UTF16 || (uint64_t)e.rva + (uint64_t)e.length * char_size > image_size || (i > 0 && e < entries[i - 1])) {
+            return false;
+        }
+    }
+
+    m_module = module;
+    m_entries = std::move(entries);
+    m_bytes_scanned = 0;
+    m_build_time = std::chrono::steady_clock::now() - start;
+
+    return true;
+}
+
+std::vector<uintptr_t> StringIndex::find(const void* bytes, size_t size, size_t length, Encoding encoding) const {
+    std::vector<uintptr_t> result{};
+    const auto hash = fnv1a(bytes, size);
+
+    const auto first = std::lower_bound(m_entries.begin(), m_entries.end(), Entry{hash, 0});
+
+    for (auto it = first; it != m_entries.end() && it->hash == hash; ++it) {
+        if (it->encoding != encoding || it->length != length) {
+            continue;
+        }
+
+        // Guard against hash collisions
+        const auto addr = m_module + it->rva;
+
+        if (std::memcmp((const void*)addr, bytes, size) == 0) {
+            result.push_back(addr);
+        }
+    }
+
+    return result;
+}
+
+std::vector<uintptr_t> StringIndex::find(std::string_view str, Encoding encoding) const {
+    if (encoding == Encoding::NARROW) {
+        return find(str.data(), str.size(), str.size(), encoding);
+    }
+
+    const auto wide = detail::utf8_to_utf16(str);
+    return find(wide.data(), wide.size() * sizeof(char16_t), wide.size(), encoding);
+}
+
+std::vector<uintptr_t> StringIndex::find(std::wstring_view str) const {
+    // wchar_t is 4 bytes outside of Windows
+    std::u16string wide(str.begin(), str.end());
+    return find(wide.data(), wide.size() * sizeof(char16_t), wide.size(), Encoding::UTF16);
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace analysis {
+// Hashed index of every printable, null terminated string literal in the read-only data sections of an image.
+// Both narrow (ASCII/UTF-8) and wide (UTF-16LE, 2 byte aligned) literals are extracted.
+class StringIndex {
+public:
+    enum class Encoding : uint8_t {
+        NARROW,
+        UTF16,
+    };
+
+    struct Entry {
+        uint64_t hash{};
+        uint32_t rva{};
+        uint32_t length{}; // in characters, excluding the terminator
+        Encoding encoding{};
+
+        bool operator<(const Entry& other) const {
+            return hash < other.hash || (hash == other.hash && rva < other.rva);
+        }
+    };
+
+    static constexpr size_t DEFAULT_MIN_LENGTH = 4;
+
+    void build(uintptr_t module, size_t min_length = DEFAULT_MIN_LENGTH);
+
+    // Same layout as FunctionTable::serialize, restores the index without rescanning (see SharedScanState).
+    bool deserialize(uintptr_t module, std::span<const uint8_t> data);
+    std::vector<uint8_t> serialize() const;
+
+    // Every address of the exact literal str (UTF-8), stored with the given encoding. Sorted by address.
+    std::vector<uintptr_t> find(std::string_view str, Encoding encoding) const;
+    std::vector<uintptr_t> find(std::wstring_view str) const;
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    size_t get_memory_usage() const {
+        return m_entries.capacity() * sizeof(Entry);
+    }
+
+    size_t get_bytes_scanned() const {
+        return m_bytes_scanned;
+    }
+
+    std::chrono::nanoseconds get_build_time() const {
+        return m_build_time;
+    }
+
+private:
+    std::vector<uintptr_t> find(const void* bytes, size_t size, size_t length, Encoding encoding) const;
+
+    uintptr_t m_module{};
+    std::vector<Entry> m_entries{};
+    size_t m_bytes_scanned{0};
+    std::chrono::nanoseconds m_build_time{};
+};
+}
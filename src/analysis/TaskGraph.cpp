@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "TaskGraph.hpp"
+#include "WorkPool.hpp"
+
+namespace analysis {
+size_t TaskGraph::add(std::string_view name, std::vector<std::string_view> dependencies, ResolveFn resolve, InstallFn install) {
+    Node node{};
+    node.name = name;
+    node.resolve = std::move(resolve);
+    node.install = std::move(install);
+
+    const auto index = m_nodes.size();
+
+    for (const auto dep : dependencies) {
+        const auto it = std::find_if(m_nodes.begin(), m_nodes.end(), [&](const Node& n) { return n.name == dep; });
+
+        if (it == m_nodes.end()) {
+            throw std::runtime_error("TaskGraph: unknown dependency " + std::string{dep} + " for " + node.name);
+        }
+
+        node.dependencies.push_back(std::distance(m_nodes.begin(), it));
+        it->dependents.push_back(index);
+    }
+
+    m_nodes.push_back(std::move(node));
+    return index;
+}
+
+void TaskGraph::resolve(WorkPool* pool) {
+    using clock = std::chrono::steady_clock;
+
+    std::mutex mtx{};
+    std::vector<size_t> pending(m_nodes.size());
+    std::vector<size_t> roots{};
+
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        pending[i] = m_nodes[i].dependencies.size();
+
+        if (pending[i] == 0) {
+            roots.push_back(i);
+        }
+    }
+
+    const auto start = clock::now();
+
+    // Resolves a batch of ready nodes, each one then runs whatever it unblocked as a nested batch.
+    // Nothing ever waits for a dependency, so no pool thread sits idle while there are scans to help with.
+    const auto run = [&](const auto& self, const std::vector<size_t>& batch) -> void {
+        const auto resolve_node = [&](size_t i) {
+            const auto index = batch[i];
+            auto& node = m_nodes[index];
+
+            // skipped was last written before the node became ready, under mtx
+            if (!node.skipped) {
+                const auto node_start = clock::now();
+                bool result = false;
+
+                try {
+                    result = node.resolve();
+                } catch (const std::exception& e) {
+                    SPDLOG_ERROR("[TaskGraph] {} threw: {}", node.name, e.what());
+                }
+
+                node.resolved = result;
+                node.start_time = node_start - start;
+                node.resolve_time = clock::now() - node_start;
+            }
+
+            std::vector<size_t> ready{};
+
+            {
+                std::scoped_lock _{mtx};
+
+                for (const auto dependent : node.dependents) {
+                    if (!node.resolved) {
+                        m_nodes[dependent].skipped = true;
+                    }
+
+                    if (--pending[dependent] == 0) {
+                        ready.push_back(dependent);
+                    }
+                }
+            }
+
+            if (!ready.empty()) {
+                self(self, ready);
+            }
+        };
+
+        if (pool != nullptr) {
+            pool->parallel_for(batch.size(), resolve_node);
+        } else {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                resolve_node(i);
+            }
+        }
+    };
+
+    run(run, roots);
+
+    m_resolve_wall_time = clock::now() - start;
+}
+
+void TaskGraph::install() {
+    using clock = std::chrono::steady_clock;
+
+    // Dependencies always precede their dependents in m_nodes, so insertion order is a valid topological order.
+    for (auto& node : m_nodes) {
+        if (!node.resolved || !node.install) {
+            continue;
+        }
+
+        const auto start = clock::now();
+        node.install();
+        node.install_time = clock::now() - start;
+    }
+}
+
+void TaskGraph::report() const {
+    using ms = std::chrono::duration<double, std::milli>;
+
+    ms total_resolve{};
+
+    for (const auto& node : m_nodes) {
+        const char* status = node.resolved ? "ok" : (node.skipped ? "skipped" : "failed");
+
+        SPDLOG_INFO("[TaskGraph] {:<48} {:<7} start {:>9.3f}ms resolve {:>9.3f}ms install {:>7.3f}ms",
+            node.name, status, ms{node.start_time}.count(), ms{node.resolve_time}.count(), ms{node.install_time}.count());
+
+        total_resolve += node.resolve_time;
+    }
+
+    const auto wall = ms{m_resolve_wall_time};
+
+    SPDLOG_INFO("[TaskGraph] Resolved {} node(s) in {:.3f}ms wall, {:.3f}ms serial ({:.2f}x)",
+        m_nodes.size(), wall.count(), total_resolve.count(), wall.count() > 0.0 ? total_resolve.count() / wall.count() : 0.0);
+}
+}
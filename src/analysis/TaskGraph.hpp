@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace analysis {
+class WorkPool;
+
+// Small dependency graph for hook resolution.
+// All resolve callbacks run concurrently as soon as their dependencies are resolved,
+// install callbacks run afterwards on the calling thread in dependency order.
+class TaskGraph {
+public:
+    using ResolveFn = std::function<bool()>;
+    using InstallFn = std::function<void()>;
+
+    struct Node {
+        std::string name{};
+        std::vector<size_t> dependencies{};
+        std::vector<size_t> dependents{};
+        ResolveFn resolve{};
+        InstallFn install{};
+
+        bool resolved{false};
+        bool skipped{false};
+        std::chrono::nanoseconds start_time{}; // relative to the start of resolve()
+        std::chrono::nanoseconds resolve_time{};
+        std::chrono::nanoseconds install_time{};
+    };
+
+    // Dependencies must already have been added.
+    size_t add(std::string_view name, std::vector<std::string_view> dependencies, ResolveFn resolve, InstallFn install = {});
+
+    // Runs every resolve callback on the pool, or one after another on the calling thread if it's nullptr.
+    // A node is skipped if any of its dependencies failed to resolve.
+    void resolve(WorkPool* pool = nullptr);
+
+    // Runs the install callbacks of resolved nodes in dependency (insertion) order.
+    void install();
+
+    void report() const;
+
+    const std::vector<Node>& get_nodes() const {
+        return m_nodes;
+    }
+
+    std::chrono::nanoseconds get_resolve_wall_time() const {
+        return m_resolve_wall_time;
+    }
+
+private:
+    std::vector<Node> m_nodes{};
+    std::chrono::nanoseconds m_resolve_wall_time{};
+};
+}
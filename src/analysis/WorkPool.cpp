@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "WorkPool.hpp"
+
+namespace analysis {
+namespace detail {
+// One parallel_for call. Shared with the helper tasks, some of which may only get to run after the call returned.
+struct WorkPoolJob {
+    void (*fn)(void*, size_t){};
+    void* ctx{};
+    size_t count{};
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+
+    // Runs indices until there are none left, fn isn't touched after the last one finished.
+    void drain() {
+        for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+            fn(ctx, i);
+            done.fetch_add(1, std::memory_order_release);
+        }
+    }
+};
+}
+
+WorkPool::WorkPool(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_threads.emplace_back([this, i]() { worker(i); });
+    }
+}
+
+WorkPool::~WorkPool() {
+    shutdown();
+}
+
+std::chrono::nanoseconds WorkPool::shutdown() {
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        std::scoped_lock _{m_wake_mutex};
+        m_stopping = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    return std::chrono::steady_clock::now() - start;
+}
+
+void WorkPool::run(size_t count, void (*fn)(void*, size_t), void* ctx) {
+    if (count == 0) {
+        return;
+    }
+
+    const auto job = std::make_shared<detail::WorkPoolJob>();
+    job->fn = fn;
+    job->ctx = ctx;
+    job->count = count;
+
+    // One helper per worker at most, each keeps taking indices until they run out
+    const auto helpers = std::min(count - 1, m_threads.size());
+
+    for (size_t i = 0; i < helpers; ++i) {
+        push([job]() { job->drain(); });
+    }
+
+    job->drain();
+
+    // The last indices might still be running elsewhere. Each of those is on a thread that isn't waiting
+    // for anything else, so this always finishes.
+    while (job->done.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
+
+void WorkPool::push(Task task) {
+    // Counted before it's visible, so whoever pops it never takes m_pending below zero
+    {
+        std::scoped_lock _{m_wake_mutex};
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Round robin, the workers steal from each other anyway
+    auto& queue = *m_queues[m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size()];
+
+    {
+        std::scoped_lock _{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+
+    m_wake.notify_one();
+}
+
+// Newest task of the home queue first, otherwise the oldest one of any other queue.
+bool WorkPool::try_run_one(size_t home) {
+    Task task{};
+
+    for (size_t n = 0; n < m_queues.size() && !task; ++n) {
+        auto& queue = *m_queues[(home + n) % m_queues.size()];
+        std::scoped_lock _{queue.mutex};
+
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        if (n == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+
+    m_pending.fetch_sub(1, std::memory_order_relaxed);
+    task();
+
+    return true;
+}
+
+void WorkPool::worker(size_t index) {
+    while (true) {
+        if (try_run_one(index)) {
+            continue;
+        }
+
+        std::unique_lock lock{m_wake_mutex};
+        m_wake.wait(lock, [this]() { return m_stopping || m_pending.load(std::memory_order_relaxed) > 0; });
+
+        if (m_stopping && m_pending.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+}
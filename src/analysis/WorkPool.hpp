@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace analysis {
+// Plain std::thread pool with one task queue per worker, idle workers steal from the others.
+// Unlike a ConcRT scheduler it leaves nothing behind once it's gone (no TLS, no detached threads),
+// so the plugin DLL can unload as soon as the pool has been destroyed.
+class WorkPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 = hardware concurrency. The thread calling parallel_for works as well, so 1 means two threads.
+    explicit WorkPool(size_t num_threads = 0);
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    // Lets the workers finish what's queued, then joins them. Returns how long that took.
+    // Tasks are expected to be short (a chunk of a scan), so this is quick.
+    std::chrono::nanoseconds shutdown();
+
+    size_t get_thread_count() const {
+        return m_threads.size();
+    }
+
+    // Calls fn(i) for every i in [0, count), on the workers and the calling thread, and returns once all calls did.
+    // Indices get handed out in ascending order. Safe to nest or call from several threads at once.
+    // A caller that runs out of indices only waits for the ones still running elsewhere, it doesn't pick up
+    // unrelated tasks: those could re-enter something it holds, like the call_once of an index being built.
+    template <typename T>
+    void parallel_for(size_t count, T&& fn) {
+        run(count, [](void* ctx, size_t i) { (*(std::remove_reference_t<T>*)ctx)(i); }, (void*)&fn);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+
+    void run(size_t count, void (*fn)(void*, size_t), void* ctx);
+    void push(Task task);
+    bool try_run_one(size_t home);
+    void worker(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues{};
+    std::vector<std::thread> m_threads{};
+    std::atomic<size_t> m_next_queue{0};
+
+    std::mutex m_wake_mutex{};
+    std::condition_variable m_wake{};
+    std::atomic<size_t> m_pending{0};
+    bool m_stopping{false};
+};
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Pe.hpp"
+#include "ScanRegion.hpp"
+#include "WorkPool.hpp"
+#include "XrefIndex.hpp"
+
+namespace analysis {
+namespace detail {
+bool is_rel32_site(const uint8_t* p) {
+    const auto prev = p[-1];
+
+    // call rel32, jmp rel32
+    if (prev == 0xE8 || prev == 0xE9) {
+        return true;
+    }
+
+    // jcc rel32
+    if ((prev & 0xF0) == 0x80 && p[-2] == 0x0F) {
+        return true;
+    }
+
+    // ModRM with mod = 00 and rm = 101, i.e. [rip+disp32]
+    return (prev & 0xC7) == 0x05;
+}
+}
+
+XrefIndex::Kind XrefIndex::get_kind(uintptr_t displacement) {
+    const auto p = (const uint8_t*)displacement;
+
+    switch (p[-1]) {
+    case 0xE8:
+        return Kind::CALL;
+    case 0xE9:
+        return Kind::JMP;
+    default:
+        break;
+    }
+
+    if ((p[-1] & 0xF0) == 0x80 && p[-2] == 0x0F) {
+        return Kind::JCC;
+    }
+
+    return Kind::RIP_RELATIVE;
+}
+
+void XrefIndex::build(uintptr_t module, WorkPool* pool) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto base = (const uint8_t*)module;
+    const auto image_size = pe::get_image_size(base);
+
+    m_module = module;
+    m_entries.clear();
+
+    // Split every executable section into roughly equal chunks, one per thread.
+    struct Chunk {
+        uint32_t begin{};
+        uint32_t end{};
+        std::vector<Entry> entries{};
+    };
+
+    const auto num_threads = pool != nullptr ? pool->get_thread_count() + 1 : 1;
+
+    std::vector<Chunk> chunks{};
+
+    m_bytes_scanned = 0;
+
+    for (const auto& region : get_scan_regions(module, RegionKind::CODE)) {
+        if (region.size < 6) {
+            continue;
+        }
+
+        m_bytes_scanned += region.size;
+
+        // Start at 2 so the opcode bytes in front of the displacement are always in the section
+        const auto begin = (uint32_t)(region.begin - base) + 2;
+        const auto end = (uint32_t)(region.begin - base + region.size) - 4;
+        const auto chunk_size = std::max<uint32_t>((end - begin) / (uint32_t)num_threads + 1, 1 << 16);
+
+        for (auto b = begin; b < end; b += chunk_size) {
+            chunks.push_back(Chunk{b, std::min(b + chunk_size, end)});
+        }
+    }
+
+    const auto process = [&](Chunk& chunk) {
+        for (auto rva = chunk.begin; rva < chunk.end; ++rva) {
+            const auto p = base + rva;
+
+            if (!detail::is_rel32_site(p)) {
+                continue;
+            }
+
+            int32_t disp{};
+            std::memcpy(&disp, p, sizeof(disp));
+
+            const auto target = (int64_t)rva + 4 + disp;
+
+            if (target < 0 || target >= (int64_t)image_size) {
+                continue;
+            }
+
+            chunk.entries.push_back(Entry{(uint32_t)target, rva});
+        }
+
+        std::sort(chunk.entries.begin(), chunk.entries.end());
+    };
+
+    if (pool != nullptr) {
+        pool->parallel_for(chunks.size(), [&](size_t i) { process(chunks[i]); });
+    } else {
+        for (auto& chunk : chunks) {
+            process(chunk);
+        }
+    }
+
+    // Each chunk is already sorted, merge them together.
+    size_t total = 0;
+
+    for (const auto& chunk : chunks) {
+        total += chunk.entries.size();
+    }
+
+    m_entries.reserve(total);
+
+    for (auto& chunk : chunks) {
+        const auto middle = m_entries.size();
+        m_entries.insert(m_entries.end(), chunk.entries.begin(), chunk.entries.end());
+        std::inplace_merge(m_entries.begin(), m_entries.begin() + middle, m_entries.end());
+
+        chunk.entries = {};
+    }
+
+    m_build_time = std::chrono::steady_clock::now() - start;
+}
+
+std::vector<uint8_t> XrefIndex::serialize() const {
+    const auto count = (uint32_t)m_entries.size();
+    std::vector<uint8_t> data(sizeof(count) + m_entries.size() * sizeof(Entry));
+
+    std::memcpy(data.data(), &count, sizeof(count));
+    std::memcpy(data.data() + sizeof(count), m_entries.data(), m_entries.size() * sizeof(Entry));
+
+    return data;
+}
+
+bool XrefIndex::deserialize(uintptr_t module, std::span<const uint8_t> data) {
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t count{};
+
+    if (data.size() < sizeof(count)) {
+        return false;
+    }
+
+    std::memcpy(&count, data.data(), sizeof(count));
+
+    if (data.size() != sizeof(count) + (size_t)count * sizeof(Entry)) {
+        return false;
+    }
+
+    std::vector<Entry> entries(count);
+    std::memcpy(entries.data(), data.data() + sizeof(count), count * sizeof(Entry));
+
+    // Lookups binary search, so anything out of order is as good as corrupt
+    const auto image_size = pe::get_image_size((const uint8_t*)module);
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+
+        if (e.target >= image_size || e.referrer >= image_size || (i > 0 && entries[i - 1] > e)) {
+            return false;
+        }
+    }
+
+    m_module = module;
+    m_entries = std::move(entries);
+    m_bytes_scanned = 0;
+    m_build_time = std::chrono::steady_clock::now() - start;
+
+    return true;
+}
+
+std::span<const XrefIndex::Entry> XrefIndex::get_references(uintptr_t target) const {
+    if (target < m_module || target - m_module > UINT32_MAX) {
+        return {};
+    }
+
+    const auto rva = (uint32_t)(target - m_module);
+
+    const auto first = std::lower_bound(m_entries.begin(), m_entries.end(), Entry{rva, 0});
+    const auto last = std::upper_bound(first, m_entries.end(), Entry{rva, UINT32_MAX});
+
+    return {first, last};
+}
+
+std::optional<uintptr_t> XrefIndex::find_call_target_before(uintptr_t addr, size_t max_distance) const {
+    if (addr < m_module || addr - m_module > UINT32_MAX) {
+        return std::nullopt;
+    }
+
+    const auto rva = (uint32_t)(addr - m_module);
+    const auto lowest = rva > max_distance ? rva - (uint32_t)max_distance : 0;
+
+    // Walk targets downwards from addr, the first one with a call referencing it wins.
+    for (auto it = std::upper_bound(m_entries.begin(), m_entries.end(), Entry{rva, UINT32_MAX}); it != m_entries.begin();) {
+        --it;
+
+        if (it->target < lowest) {
+            break;
+        }
+
+        if (get_kind(m_module + it->referrer) == Kind::CALL) {
+            return m_module + it->target;
+        }
+    }
+
+    return std::nullopt;
+}
+}
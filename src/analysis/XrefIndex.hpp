@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace analysis {
+class WorkPool;
+
+// Sorted target -> referrer index of every rel32 displacement in the executable sections of an image.
+// Built once, after which "who references X" is a binary search instead of a module-wide scan.
+//
+// Like utility::scan_displacement_reference, a referrer is the address of the 4 byte displacement itself
+// and its target is referrer + 4 + disp32. Only displacements that follow a call (E8), jmp (E9),
+// jcc (0F 8x) or a ModRM byte encoding [rip+disp32] are indexed, which is what keeps it small.
+class XrefIndex {
+public:
+    enum class Kind : uint8_t {
+        CALL,
+        JMP,
+        JCC,
+        RIP_RELATIVE,
+    };
+
+    struct Entry {
+        uint32_t target{};
+        uint32_t referrer{};
+
+        auto operator<=>(const Entry&) const = default;
+    };
+
+    // Sections are split into one chunk per pool thread (plus the caller), nullptr scans them on the calling thread.
+    void build(uintptr_t module, WorkPool* pool = nullptr);
+
+    // Same layout as FunctionTable::serialize, restores the index without rescanning (see SharedScanState).
+    bool deserialize(uintptr_t module, std::span<const uint8_t> data);
+    std::vector<uint8_t> serialize() const;
+
+    bool empty() const {
+        return m_entries.empty();
+    }
+
+    // RVAs of every displacement referencing target, in ascending order.
+    std::span<const Entry> get_references(uintptr_t target) const;
+
+    size_t count_references(uintptr_t target) const {
+        return get_references(target).size();
+    }
+
+    // First referrer (lowest address) accepted by pred, which receives the absolute address of the displacement.
+    template <typename T>
+    std::optional<uintptr_t> find_reference(uintptr_t target, T&& pred) const {
+        for (const auto& entry : get_references(target)) {
+            const auto addr = m_module + entry.referrer;
+
+            if (pred(addr)) {
+                return addr;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<uintptr_t> find_reference(uintptr_t target) const {
+        return find_reference(target, [](uintptr_t) { return true; });
+    }
+
+    std::optional<uintptr_t> find_reference(uintptr_t target, Kind kind) const {
+        return find_reference(target, [&](uintptr_t addr) { return get_kind(addr) == kind; });
+    }
+
+    // Closest address at or below addr that is the target of a call, at most max_distance bytes away.
+    // Stand-in for utility::find_function_start_with_call where there's no unwind info to go by.
+    std::optional<uintptr_t> find_call_target_before(uintptr_t addr, size_t max_distance = 0x10000) const;
+
+    // Classifies the instruction a displacement belongs to by the byte(s) preceding it.
+    static Kind get_kind(uintptr_t displacement);
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    size_t get_memory_usage() const {
+        return m_entries.capacity() * sizeof(Entry);
+    }
+
+    size_t get_bytes_scanned() const {
+        return m_bytes_scanned;
+    }
+
+    std::chrono::nanoseconds get_build_time() const {
+        return m_build_time;
+    }
+
+private:
+    uintptr_t m_module{};
+    std::vector<Entry> m_entries{};
+    size_t m_bytes_scanned{0};
+    std::chrono::nanoseconds m_build_time{};
+};
+}
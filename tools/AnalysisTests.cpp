@@ -0,0 +1,72 @@
+// Runs the self checking tools against the analysis library, registered with CTest one check at a time.
+// Without a check name, runs all of them with their defaults and exits with 1 if any failed.
+// Anything after the name goes to the check itself.
+//
+// > analysis_tests
+// > analysis_tests descriptor_heap_check --heaps 256
+// > ctest --test-dir build --output-on-failure
+
+#include <cstdio>
+#include <iterator>
+#include <string_view>
+
+#include "Checks.hpp"
+
+namespace {
+struct Check {
+    const char* name;
+    int (*main)(int argc, char** argv);
+};
+
+constexpr Check CHECKS[] = {
+    {"vtable_resolve", vtable_resolve_main},
+    {"descriptor_heap_check", descriptor_heap_check_main},
+    {"descriptor_coalesce_check", descriptor_coalesce_check_main},
+    {"trace_replay", trace_replay_main},
+};
+
+int run(const Check& check, int argc, char** argv) {
+    std::printf("== %s\n", check.name);
+    std::fflush(stdout);
+
+    const auto result = check.main(argc, argv);
+
+    std::printf("== %s: %s\n", check.name, result == 0 ? "passed" : "FAILED");
+    std::fflush(stdout);
+
+    return result;
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        size_t failed = 0;
+
+        for (const auto& check : CHECKS) {
+            char* check_argv[] = {const_cast<char*>(check.name), nullptr};
+
+            if (run(check, 1, check_argv) != 0) {
+                ++failed;
+            }
+        }
+
+        std::printf("%zu of %zu check(s) failed\n", failed, std::size(CHECKS));
+        return failed == 0 ? 0 : 1;
+    }
+
+    const std::string_view name{argv[1]};
+
+    for (const auto& check : CHECKS) {
+        if (name == check.name) {
+            return run(check, argc - 1, argv + 1);
+        }
+    }
+
+    std::fprintf(stderr, "usage: %s [check [args...]]\nchecks:\n", argv[0]);
+
+    for (const auto& check : CHECKS) {
+        std::fprintf(stderr, "  %s\n", check.name);
+    }
+
+    return 1;
+}
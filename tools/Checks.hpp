@@ -0,0 +1,8 @@
+#pragma once
+
+// Checks built into analysis_tests (tools/AnalysisTests.cpp). Every one takes its own command line, argv[0] being
+// the check's name, and returns 0 if everything it checked passed.
+int vtable_resolve_main(int argc, char** argv);
+int descriptor_heap_check_main(int argc, char** argv);
+int descriptor_coalesce_check_main(int argc, char** argv);
+int trace_replay_main(int argc, char** argv);
@@ -0,0 +1,186 @@
+// Per call cost of the CDevice::CopyDescriptors detour, before and after the fast path.
+// Both variants reproduce the plugin's hook body minus the SEH frame (which is table based on x64 and
+// costs nothing until it fires) in front of a stub original that does nothing:
+//   legacy: g_plugin through a unique_ptr, HookGate::get_original, std::find over the source handles
+//   fast:   one relaxed load of the cached trampoline, vectorized null handle scan (see NullHandleScan.hpp)
+// Source handle arrays have no nulls in them, which is the case that matters, every call goes through to the original.
+// A second pass puts a null in the last slot to check that both variants reject the same calls.
+//
+// > copy_descriptors_bench
+// > copy_descriptors_bench --calls 2000000
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <analysis/HookGate.hpp>
+#include <analysis/NullHandleScan.hpp>
+
+using namespace analysis;
+
+namespace {
+struct Handle {
+    uint64_t ptr;
+};
+
+using CopyDescriptorsFn = void* (*)(void* self, uint32_t num_dest, const Handle* dest_starts, const uint32_t* dest_sizes, uint32_t num_src, const Handle* src_starts, const uint32_t* src_sizes, int type);
+
+// Single threaded, a locked increment would cost more than everything being measured
+size_t g_original_calls{0};
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void* stub_original(void* self, uint32_t, const Handle*, const uint32_t*, uint32_t, const Handle*, const uint32_t*, int) {
+    ++g_original_calls;
+    return self;
+}
+
+struct Plugin {
+    HookGate<CopyDescriptorsFn> gate{};
+};
+
+std::unique_ptr<Plugin> g_plugin{};
+
+void* legacy_copy_descriptors(void* self, uint32_t num_dest, const Handle* dest_starts, const uint32_t* dest_sizes, uint32_t num_src, const Handle* src_starts, const uint32_t* src_sizes, int type) {
+    const auto orig = g_plugin->gate.get_original();
+
+    if (src_starts != nullptr && num_src > 0) {
+        const auto start = (const uint64_t*)src_starts;
+        const auto end = start + num_src;
+
+        if (std::find(start, end, 0) != end) {
+            return nullptr;
+        }
+    }
+
+    return orig(self, num_dest, dest_starts, dest_sizes, num_src, src_starts, src_sizes, type);
+}
+
+std::atomic<CopyDescriptorsFn> g_original{nullptr};
+const simd::FindNullHandleFn g_find_null_handle{simd::get_find_null_handle()};
+
+void* fast_copy_descriptors(void* self, uint32_t num_dest, const Handle* dest_starts, const uint32_t* dest_sizes, uint32_t num_src, const Handle* src_starts, const uint32_t* src_sizes, int type) {
+    auto orig = g_original.load(std::memory_order_relaxed);
+
+    if (orig == nullptr) [[unlikely]] {
+        orig = g_plugin->gate.get_original();
+        g_original.store(orig, std::memory_order_relaxed);
+    }
+
+    if (src_starts != nullptr && num_src > 0) {
+        const auto handles = (const uint64_t*)src_starts;
+
+        if (num_src < 4 ? simd::find_null_handle_short(handles, num_src) != num_src : g_find_null_handle(handles, num_src) != num_src) [[unlikely]] {
+            return nullptr;
+        }
+    }
+
+    return orig(self, num_dest, dest_starts, dest_sizes, num_src, src_starts, src_sizes, type);
+}
+
+// Called through a volatile pointer so the detour can't be inlined into the loop, same as the real thing
+double measure_ns(CopyDescriptorsFn detour, const std::vector<Handle>& handles, const std::vector<uint32_t>& sizes, size_t calls) {
+    CopyDescriptorsFn volatile fn = detour;
+    double best = 1e30;
+
+    for (size_t pass = 0; pass < 3; ++pass) {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < calls; ++i) {
+            fn((void*)&handles, (uint32_t)handles.size(), handles.data(), sizes.data(), (uint32_t)handles.size(), handles.data(), sizes.data(), 0);
+        }
+
+        const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, elapsed / calls);
+    }
+
+    return best;
+}
+}
+
+int main(int argc, char** argv) {
+    size_t calls = 500000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--calls" && i + 1 < argc) {
+            calls = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else {
+            std::fprintf(stderr, "usage: %s [--calls <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    g_plugin = std::make_unique<Plugin>();
+    *(CopyDescriptorsFn*)g_plugin->gate.get_original_slot() = &stub_original;
+    g_plugin->gate.set_state(HookState::LIVE);
+
+    std::printf("Null handle scan: %s\n", simd::to_string(simd::get_isa()));
+    std::printf("ranges,legacy_ns,fast_ns,speedup\n");
+
+    bool ok = true;
+
+    for (size_t ranges = 1; ranges <= 1024; ranges *= 2) {
+        // Spaced like descriptors in a CPU heap, never null
+        std::vector<Handle> handles(ranges);
+        std::vector<uint32_t> sizes(ranges, 1);
+
+        for (size_t i = 0; i < ranges; ++i) {
+            handles[i].ptr = 0x10000 + i * 32;
+        }
+
+        // Scale the number of calls down for large ranges so every row takes about as long
+        const auto n = std::max<size_t>(calls / std::max<size_t>(ranges / 16, 1), 1000);
+
+        const auto legacy = measure_ns(&legacy_copy_descriptors, handles, sizes, n);
+        const auto fast = measure_ns(&fast_copy_descriptors, handles, sizes, n);
+
+        std::printf("%zu,%.2f,%.2f,%.2f\n", ranges, legacy, fast, legacy / fast);
+
+        // A null in the last range has to be rejected by both without reaching the original
+        handles.back().ptr = 0;
+
+        const auto before = g_original_calls;
+        const auto legacy_result = legacy_copy_descriptors(nullptr, (uint32_t)ranges, handles.data(), sizes.data(), (uint32_t)ranges, handles.data(), sizes.data(), 0);
+        const auto fast_result = fast_copy_descriptors(nullptr, (uint32_t)ranges, handles.data(), sizes.data(), (uint32_t)ranges, handles.data(), sizes.data(), 0);
+
+        if (legacy_result != nullptr || fast_result != nullptr || g_original_calls != before) {
+            std::fprintf(stderr, "%zu range(s): null handle not rejected\n", ranges);
+            ok = false;
+        }
+    }
+
+    // Every ISA has to agree with the scalar path on where the first null is
+    for (const auto isa : {simd::Isa::AVX2, simd::Isa::AVX512}) {
+        if (isa > simd::get_isa()) {
+            continue;
+        }
+
+        for (size_t count = 0; count <= 40 && ok; ++count) {
+            for (size_t null_at = 0; null_at <= count; ++null_at) {
+                std::vector<uint64_t> handles(count, 1);
+
+                if (null_at < count) {
+                    handles[null_at] = 0;
+                }
+
+                if (simd::find_null_handle(handles.data(), count, isa) != simd::find_null_handle(handles.data(), count, simd::Isa::SCALAR)) {
+                    std::fprintf(stderr, "%s: mismatch with %zu handle(s), null at %zu\n", simd::to_string(isa), count, null_at);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}
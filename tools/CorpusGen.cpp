@@ -0,0 +1,845 @@
+// Synthetic game executable for benchmarking and checking the scanners without shipping the game.
+// Writes a valid PE32+ image of the requested size whose .text follows the byte statistics of x64 code
+// (see ByteFrequency.hpp) and has a .pdata entry for every function, with everything the plugin looks for
+// planted at known places:
+//   - wide string anchors referenced RIP-relative from functions, including a decoy reference
+//   - FScene and a few other classes with MSVC RTTI and vtables
+//   - FScene::StartFrame tail jumping into the fragment holding its magic constant, plus a decoy constant
+//   - the GFrameNumberRenderThread and FVelocityData::UpdateTransform signatures
+// Next to the image goes a ground truth manifest (see GroundTruth.hpp) that scan_harness and scan_bench check against.
+// Raw offsets equal RVAs, so the manifest applies to the file on disk as well as to the mapped image.
+//
+// > corpus_gen corpus.exe                    (256 MiB, manifest written to corpus.exe.manifest)
+// > corpus_gen corpus.exe --size 2047 --seed 7
+// > scan_harness corpus.exe --manifest corpus.exe.manifest
+// > scan_bench --file corpus.exe --manifest corpus.exe.manifest
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <analysis/ByteFrequency.hpp>
+#include <analysis/GroundTruth.hpp>
+#include <analysis/Pe.hpp>
+
+using namespace analysis;
+
+namespace {
+constexpr uint64_t IMAGE_BASE = 0x140000000;
+constexpr uint32_t PAGE_SIZE = 0x1000;
+constexpr uint32_t PLANTED_FUNCTION_SIZE = 0x100;
+constexpr uint32_t PLANTED_RDATA_SIZE = 0x10000;
+constexpr uint32_t DATA_SIZE = 0x10000;
+constexpr uint32_t RELOC_SIZE = 0x10000;
+
+constexpr uint64_t STARTFRAME_MAGIC = 0x47AE147AE147AE15;
+constexpr uint32_t STARTFRAME_SLOT = 52; // the plugin reads the slot 48 entries before StartFrame's
+constexpr uint32_t FRAME_COUNT_OFFSET = 0x1A8;
+constexpr uint32_t VELOCITY_DATA_OFFSET = 0x2F70;
+
+// Prologues MSVC emits all the time, the last one shares its first 14 bytes with UpdateTransform's signature
+// so that scanners have near misses to reject.
+constexpr std::array<std::string_view, 4> COMMON_PROLOGUES{
+    "\x48\x89\x5C\x24\x08",
+    "\x40\x53\x48\x83\xEC\x20",
+    "\x48\x83\xEC\x28",
+    "\x48\x89\x5C\x24\x10\x48\x89\x6C\x24\x18\x56\x57\x41\x56",
+};
+
+uint32_t align_up(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Maps 16 random bits to a byte distributed like X64_BYTE_FREQUENCY.
+class ByteSampler {
+public:
+    ByteSampler() {
+        uint64_t total = 0;
+
+        for (const auto f : X64_BYTE_FREQUENCY) {
+            total += f;
+        }
+
+        uint64_t cumulative = 0;
+        size_t i = 0;
+
+        for (size_t b = 0; b < X64_BYTE_FREQUENCY.size(); ++b) {
+            cumulative += X64_BYTE_FREQUENCY[b];
+
+            for (const auto end = (size_t)(cumulative * m_table.size() / total); i < end; ++i) {
+                m_table[i] = (uint8_t)b;
+            }
+        }
+
+        for (; i < m_table.size(); ++i) {
+            m_table[i] = 0xFF;
+        }
+    }
+
+    uint8_t operator()(uint16_t r) const {
+        return m_table[r];
+    }
+
+private:
+    std::array<uint8_t, 0x10000> m_table{};
+};
+
+class Image {
+public:
+    explicit Image(size_t size)
+        : m_bytes(size)
+    {
+    }
+
+    uint8_t* at(uint32_t rva) {
+        return m_bytes.data() + rva;
+    }
+
+    template <typename T>
+    void write(uint32_t rva, const T& value) {
+        std::memcpy(at(rva), &value, sizeof(value));
+    }
+
+    // Absolute pointer, gets a base relocation
+    void write_pointer(uint32_t rva, uint32_t target) {
+        write<uint64_t>(rva, IMAGE_BASE + target);
+        m_relocations.push_back(rva);
+    }
+
+    void write_wide_string(uint32_t rva, std::string_view str) {
+        for (size_t i = 0; i < str.size(); ++i) {
+            write<uint16_t>(rva + (uint32_t)(i * 2), (uint8_t)str[i]);
+        }
+
+        write<uint16_t>(rva + (uint32_t)(str.size() * 2), 0);
+    }
+
+    const std::vector<uint32_t>& get_relocations() const {
+        return m_relocations;
+    }
+
+    const std::vector<uint8_t>& get_bytes() const {
+        return m_bytes;
+    }
+
+    void resize(size_t size) {
+        m_bytes.resize(size);
+    }
+
+private:
+    std::vector<uint8_t> m_bytes{};
+    std::vector<uint32_t> m_relocations{};
+};
+
+// Writes a function at an RVA, displacements are computed from where they end up.
+// Its .pdata entry gets added once it's done.
+class Assembler {
+public:
+    Assembler(Image& image, uint32_t rva, std::vector<pe::RuntimeFunction>& functions)
+        : m_image{image},
+        m_functions{functions},
+        m_begin{rva},
+        m_rva{rva}
+    {
+    }
+
+    ~Assembler() {
+        m_functions.push_back(pe::RuntimeFunction{m_begin, m_rva, 0});
+    }
+
+    Assembler(const Assembler&) = delete;
+    Assembler& operator=(const Assembler&) = delete;
+
+    Assembler& bytes(std::initializer_list<uint8_t> bytes) {
+        for (const auto b : bytes) {
+            *m_image.at(m_rva++) = b;
+        }
+
+        return *this;
+    }
+
+    Assembler& u32(uint32_t value) {
+        m_image.write(m_rva, value);
+        m_rva += sizeof(value);
+        return *this;
+    }
+
+    Assembler& u64(uint64_t value) {
+        m_image.write(m_rva, value);
+        m_rva += sizeof(value);
+        return *this;
+    }
+
+    // disp32 relative to the end of the instruction, trailing is how many bytes of it follow the displacement
+    Assembler& rel32(uint32_t target, uint32_t trailing = 0) {
+        return u32(target - (m_rva + sizeof(uint32_t) + trailing));
+    }
+
+    uint32_t here() const {
+        return m_rva;
+    }
+
+private:
+    Image& m_image;
+    std::vector<pe::RuntimeFunction>& m_functions;
+    uint32_t m_begin{};
+    uint32_t m_rva{};
+};
+
+struct Layout {
+    uint32_t text{PAGE_SIZE};
+    uint32_t text_size{};
+    uint32_t rdata{};
+    uint32_t rdata_size{};
+    uint32_t data{};
+    uint32_t pdata{};
+    uint32_t pdata_size{};
+    uint32_t reloc{};
+    uint32_t image_size{};
+};
+
+// RVAs of the functions the plugin looks for, each gets PLANTED_FUNCTION_SIZE bytes of .text.
+struct Planted {
+    uint32_t post_process_decoy{};
+    std::array<uint32_t, 5> post_process_callers{};
+    uint32_t frame_number{};
+    uint32_t motion_blur{};
+    uint32_t motion_blur_caller{};
+    uint32_t render_composite_layer{};
+    uint32_t magic_decoy{};
+    uint32_t post_process_settings{};
+    uint32_t startframe{};
+    uint32_t get_frame_count{};
+    uint32_t startframe_tail{};
+    uint32_t update_all_primitive_scene_infos{};
+    uint32_t update_transform{};
+
+    std::vector<uint32_t> all() const {
+        std::vector<uint32_t> result{post_process_decoy};
+        result.insert(result.end(), post_process_callers.begin(), post_process_callers.end());
+        result.insert(result.end(), {frame_number, motion_blur, motion_blur_caller, render_composite_layer, magic_decoy,
+            post_process_settings, startframe, get_frame_count, startframe_tail, update_all_primitive_scene_infos, update_transform});
+        return result;
+    }
+};
+
+class Generator {
+public:
+    Generator(size_t size, uint64_t seed)
+        : m_image{size},
+        m_rng{seed}
+    {
+        m_layout.image_size = (uint32_t)size;
+        m_layout.text_size = (uint32_t)(size / 100 * 78) & ~(PAGE_SIZE - 1);
+        m_truth.set("corpus.seed", seed);
+        m_truth.set("corpus.size", size);
+    }
+
+    bool run() {
+        place_planted_functions();
+        fill_text();
+        layout_sections();
+
+        if (m_layout.rdata_size < PLANTED_RDATA_SIZE * 2) {
+            std::fprintf(stderr, "Image too small for its .pdata, use a larger --size\n");
+            return false;
+        }
+
+        fill_rdata();
+        plant_rdata();
+        plant_code();
+        write_pdata();
+
+        if (!write_relocations()) {
+            std::fprintf(stderr, "Too many relocations for .reloc\n");
+            return false;
+        }
+
+        write_headers();
+        return true;
+    }
+
+    const Image& get_image() const {
+        return m_image;
+    }
+
+    const GroundTruth& get_truth() const {
+        return m_truth;
+    }
+
+    size_t get_function_count() const {
+        return m_functions.size();
+    }
+
+private:
+    uint32_t text_at(double fraction) const {
+        return align_up(m_layout.text + (uint32_t)(m_layout.text_size * fraction), 16);
+    }
+
+    // Spread out over .text. UpdateTransform, which is found by signature alone, sits near the end
+    // so a scan for it can't get away with reading only a bit of .text.
+    void place_planted_functions() {
+        auto& p = m_planted;
+        p.post_process_decoy = text_at(0.05);
+
+        for (size_t i = 0; i < p.post_process_callers.size(); ++i) {
+            p.post_process_callers[i] = text_at(0.10 + i * 0.01);
+        }
+
+        p.frame_number = text_at(0.20);
+        p.motion_blur = text_at(0.27);
+        p.motion_blur_caller = text_at(0.31);
+        p.render_composite_layer = text_at(0.36);
+        p.magic_decoy = text_at(0.42);
+        p.post_process_settings = text_at(0.48);
+        p.startframe = text_at(0.55);
+        p.get_frame_count = text_at(0.58);
+        p.startframe_tail = text_at(0.63);
+        p.update_all_primitive_scene_infos = text_at(0.72);
+        p.update_transform = text_at(0.91);
+    }
+
+    // Filler functions between the planted ones: sampled bytes, sometimes behind a common prologue,
+    // ending in a ret and int3 padding like MSVC lays them out.
+    void fill_text() {
+        static const ByteSampler sampler{};
+
+        const auto begin = m_image.at(m_layout.text);
+        const auto end = begin + m_layout.text_size;
+
+        for (auto p = begin; p < end;) {
+            auto r = m_rng();
+
+            for (size_t i = 0; i < 4 && p < end; ++i, r >>= 16) {
+                *p++ = sampler((uint16_t)r);
+            }
+        }
+
+        auto planted = m_planted.all();
+        std::sort(planted.begin(), planted.end());
+
+        auto next_planted = planted.begin();
+        const auto text_end = m_layout.text + m_layout.text_size;
+
+        for (uint32_t rva = m_layout.text; rva < text_end;) {
+            if (next_planted != planted.end() && rva >= *next_planted) {
+                std::memset(m_image.at(*next_planted), 0xCC, PLANTED_FUNCTION_SIZE);
+                rva = *next_planted++ + PLANTED_FUNCTION_SIZE;
+                continue;
+            }
+
+            const auto r = m_rng();
+            auto size = (uint32_t)((r & 3) == 0 ? 64 + (r >> 8) % 4096 : 32 + (r >> 8) % 512);
+            auto limit = next_planted != planted.end() ? *next_planted : text_end;
+            size = std::min(size, limit - rva);
+
+            if (size < 32) {
+                std::memset(m_image.at(rva), 0xCC, size);
+                rva += size;
+                continue;
+            }
+
+            const auto padding = (uint32_t)((r >> 40) % 16);
+            const auto body = std::max<uint32_t>(size - padding, 16);
+
+            if ((r >> 48) & 1) {
+                const auto& prologue = COMMON_PROLOGUES[(r >> 49) % COMMON_PROLOGUES.size()];
+                std::memcpy(m_image.at(rva), prologue.data(), prologue.size());
+            }
+
+            *m_image.at(rva + body - 1) = 0xC3;
+            std::memset(m_image.at(rva + body), 0xCC, size - body);
+
+            m_functions.push_back(pe::RuntimeFunction{rva, rva + body, 0});
+            rva += size;
+        }
+    }
+
+    void layout_sections() {
+        auto& l = m_layout;
+        l.pdata_size = align_up((uint32_t)((m_functions.size() + m_planted.all().size()) * sizeof(pe::RuntimeFunction)), PAGE_SIZE);
+
+        const auto fixed = PAGE_SIZE + l.text_size + DATA_SIZE + l.pdata_size + RELOC_SIZE;
+        l.rdata_size = l.image_size > fixed ? (l.image_size - fixed) & ~(PAGE_SIZE - 1) : 0;
+        l.rdata = l.text + l.text_size;
+        l.data = l.rdata + l.rdata_size;
+        l.pdata = l.data + DATA_SIZE;
+        l.reloc = l.pdata + l.pdata_size;
+        l.image_size = l.reloc + RELOC_SIZE;
+
+        m_image.resize(l.image_size);
+    }
+
+    // Narrow strings, small integers and zeros, what .rdata mostly is
+    void fill_rdata() {
+        const auto begin = m_image.at(m_layout.rdata);
+        const auto end = begin + m_layout.rdata_size;
+
+        for (auto p = begin; p + 64 <= end; p += 64) {
+            const auto r = m_rng();
+
+            switch (r % 3) {
+            case 0: {
+                const auto length = 4 + (r >> 8) % 56;
+                auto letters = r;
+
+                for (size_t i = 0; i < length; ++i, letters = letters * 6364136223846793005ull + 1442695040888963407ull) {
+                    p[i] = (uint8_t)('a' + (letters >> 59) % 26);
+                }
+
+                break;
+            }
+            case 1:
+                for (size_t i = 0; i < 64; i += 4) {
+                    const auto value = (uint32_t)((r >> (i % 32)) & 0xFFFF);
+                    std::memcpy(p + i, &value, sizeof(value));
+                }
+
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    uint32_t allocate_rdata(uint32_t size, uint32_t alignment = 8) {
+        const auto rva = align_up(m_rdata_cursor, alignment);
+        m_rdata_cursor = rva + size;
+        return rva;
+    }
+
+    uint32_t allocate_data(uint32_t size, uint32_t alignment = 8) {
+        const auto rva = align_up(m_data_cursor, alignment);
+        m_data_cursor = rva + size;
+        return rva;
+    }
+
+    // Zero padded on both sides so the string index sees exactly these strings
+    uint32_t plant_wide_string(std::string_view str) {
+        const auto rva = allocate_rdata((uint32_t)(str.size() + 1) * 2 + 16, 16);
+        m_image.write_wide_string(rva, str);
+        return rva;
+    }
+
+    uint32_t random_function() {
+        return m_functions[m_rng() % m_functions.size()].begin_address;
+    }
+
+    struct Class {
+        std::string decorated{};
+        std::vector<size_t> bases{}; // indices into the class list, direct and indirect
+        uint32_t type_descriptor{};
+        uint32_t class_descriptor{};
+    };
+
+    // Type descriptors go in .data like MSVC puts them, the rest in .rdata.
+    // Returns the RVA of the first slot of each vtable.
+    std::vector<uint32_t> plant_rtti(std::vector<Class>& classes, const std::vector<std::vector<uint32_t>>& vtables) {
+        const auto type_info_vftable = allocate_rdata(3 * sizeof(uint64_t));
+
+        for (auto& cls : classes) {
+            cls.type_descriptor = allocate_data((uint32_t)(offsetof(pe::TypeDescriptor, name) + cls.decorated.size() + 1), 16);
+            m_image.write_pointer(cls.type_descriptor, type_info_vftable);
+            std::memcpy(m_image.at(cls.type_descriptor + offsetof(pe::TypeDescriptor, name)), cls.decorated.c_str(), cls.decorated.size() + 1);
+        }
+
+        for (auto& cls : classes) {
+            cls.class_descriptor = allocate_rdata(sizeof(pe::ClassHierarchyDescriptor));
+        }
+
+        for (auto& cls : classes) {
+            const auto count = (uint32_t)(cls.bases.size() + 1);
+            const auto array = allocate_rdata(count * sizeof(uint32_t));
+
+            m_image.write(cls.class_descriptor, pe::ClassHierarchyDescriptor{0, 0, count, array});
+
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto& base = i == 0 ? cls : classes[cls.bases[i - 1]];
+                const auto bcd = allocate_rdata(sizeof(pe::BaseClassDescriptor));
+
+                m_image.write(bcd, pe::BaseClassDescriptor{base.type_descriptor, (uint32_t)base.bases.size(), 0, -1, 0, 0x40, base.class_descriptor});
+                m_image.write(array + i * (uint32_t)sizeof(uint32_t), bcd);
+            }
+        }
+
+        std::vector<uint32_t> result{};
+
+        for (size_t i = 0; i < classes.size(); ++i) {
+            const auto col = allocate_rdata(sizeof(pe::CompleteObjectLocator));
+            m_image.write(col, pe::CompleteObjectLocator{pe::COL_SIGNATURE_X64, 0, 0, classes[i].type_descriptor, classes[i].class_descriptor, col});
+
+            // The locator pointer, the slots and a null so the vtable ends where it's supposed to
+            const auto meta = allocate_rdata((uint32_t)(vtables[i].size() + 2) * sizeof(uint64_t), 16);
+            m_image.write_pointer(meta, col);
+
+            for (size_t slot = 0; slot < vtables[i].size(); ++slot) {
+                m_image.write_pointer(meta + (uint32_t)((slot + 1) * sizeof(uint64_t)), vtables[i][slot]);
+            }
+
+            result.push_back(meta + sizeof(uint64_t));
+        }
+
+        return result;
+    }
+
+    std::vector<uint32_t> make_vtable(size_t size) {
+        std::vector<uint32_t> result(size);
+
+        for (auto& slot : result) {
+            slot = random_function();
+        }
+
+        return result;
+    }
+
+    void plant_rdata() {
+        // Somewhere in the middle, cleared so nothing from the filler runs into it
+        m_rdata_cursor = m_layout.rdata + (m_layout.rdata_size / 2 & ~(PAGE_SIZE - 1));
+        std::memset(m_image.at(m_rdata_cursor), 0, PLANTED_RDATA_SIZE);
+
+        m_data_cursor = m_layout.data;
+
+        m_render_composite_layer_str = plant_wide_string("FEndMenuRenderer::OnRenderCompositeLayerEx");
+        m_post_process_str = plant_wide_string("r.DefaultFeature.AutoExposure.Bias");
+        m_motion_blur_str = plant_wide_string("MotionBlurIntermediate");
+
+        // UNWIND_INFO v1 with a single UWOP_ALLOC_SMALL, shared by every function
+        m_unwind_info = allocate_rdata(8, 4);
+        m_image.write(m_unwind_info, pe::UnwindInfo{0x01, 4, 1, 0, {0x3204}});
+
+        m_frame_number_global = allocate_data(sizeof(uint32_t));
+        m_frame_number_lea_target = allocate_rdata(16);
+
+        std::vector<Class> classes{
+            {".?AVFSceneInterface@@"},
+            {".?AVFScene@@", {0}},
+            {".?AVFSceneRenderer@@"},
+            {".?AVFDeferredShadingSceneRenderer@@", {2}},
+            {".?AVFEndMenuRenderer@@"},
+        };
+
+        auto fscene = make_vtable(64);
+        fscene[STARTFRAME_SLOT] = m_planted.startframe;
+        fscene[STARTFRAME_SLOT + 1] = m_planted.get_frame_count;
+
+        auto end_menu_renderer = make_vtable(12);
+        end_menu_renderer[7] = m_planted.render_composite_layer;
+
+        const auto vtables = plant_rtti(classes, {make_vtable(40), fscene, make_vtable(30), make_vtable(34), end_menu_renderer});
+
+        m_truth.set("FScene::StartFrame.vtable", vtables[1] + STARTFRAME_SLOT * sizeof(uint64_t));
+        m_truth.set("FScene::FrameCount.offset", FRAME_COUNT_OFFSET);
+        m_truth.set("FScene::VelocityData.offset", VELOCITY_DATA_OFFSET);
+        m_truth.set("GFrameNumberRenderThread.global", m_frame_number_global);
+    }
+
+    // Everything is written in place over the int3 filled reservations from fill_text
+    void plant_code() {
+        const auto& p = m_planted;
+        const auto callee = random_function();
+
+        // Also references the cvar name, but hardly anything calls it so it's not the constructor
+        Assembler{m_image, p.post_process_decoy, m_functions}
+            .bytes({0x40, 0x53, 0x48, 0x83, 0xEC, 0x20})
+            .bytes({0x48, 0x8D, 0x15}).rel32(m_post_process_str)
+            .bytes({0xE8}).rel32(callee)
+            .bytes({0x48, 0x83, 0xC4, 0x20, 0x5B, 0xC3});
+
+        for (const auto caller : p.post_process_callers) {
+            Assembler{m_image, caller, m_functions}
+                .bytes({0x48, 0x83, 0xEC, 0x28})
+                .bytes({0xE8}).rel32(p.post_process_settings)
+                .bytes({0x48, 0x83, 0xC4, 0x28, 0xC3});
+        }
+
+        Assembler frame_number{m_image, p.frame_number, m_functions};
+        frame_number.bytes({0x40, 0x53, 0x48, 0x81, 0xEC, 0x90, 0x00, 0x00, 0x00});
+        m_truth.set("GFrameNumberRenderThread", frame_number.here());
+        frame_number
+            .bytes({0xFF, 0x05}).rel32(m_frame_number_global)
+            .bytes({0x48, 0x8D, 0x0D}).rel32(m_frame_number_lea_target)
+            .bytes({0x48, 0x89, 0x9C, 0x24, 0x88, 0x00, 0x00, 0x00})
+            .bytes({0x48, 0x81, 0xC4, 0x90, 0x00, 0x00, 0x00, 0x5B, 0xC3});
+
+        Assembler{m_image, p.motion_blur, m_functions}
+            .bytes({0x48, 0x83, 0xEC, 0x28})
+            .bytes({0x48, 0x8D, 0x15}).rel32(m_motion_blur_str)
+            .bytes({0xE8}).rel32(callee)
+            .bytes({0x48, 0x83, 0xC4, 0x28, 0xC3});
+
+        Assembler motion_blur_caller{m_image, p.motion_blur_caller, m_functions};
+        motion_blur_caller.bytes({0x48, 0x83, 0xEC, 0x28, 0x85, 0xC9});
+        m_truth.set("MotionBlurIntermediate.jmp", motion_blur_caller.here());
+        motion_blur_caller
+            .bytes({0x74, 0x05})
+            .bytes({0xE8}).rel32(p.motion_blur)
+            .bytes({0x48, 0x83, 0xC4, 0x28, 0xC3});
+
+        Assembler{m_image, p.render_composite_layer, m_functions}
+            .bytes({0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xD9})
+            .bytes({0x48, 0x8D, 0x15}).rel32(m_render_composite_layer_str)
+            .bytes({0x48, 0x8B, 0xCB})
+            .bytes({0xE8}).rel32(callee)
+            .bytes({0x48, 0x83, 0xC4, 0x20, 0x5B, 0xC3});
+        m_truth.set("FEndMenuRenderer::OnRenderCompositeLayerEx", p.render_composite_layer);
+
+        // Same constant, but nothing tail jumps here
+        Assembler{m_image, p.magic_decoy, m_functions}
+            .bytes({0x48, 0xB8}).u64(STARTFRAME_MAGIC)
+            .bytes({0x48, 0x89, 0x41, 0x40, 0xC3});
+
+        Assembler{m_image, p.post_process_settings, m_functions}
+            .bytes({0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xD9})
+            .bytes({0x48, 0x8D, 0x15}).rel32(m_post_process_str)
+            .bytes({0x33, 0xC0, 0x48, 0x89, 0x43, 0x10, 0x48, 0x8B, 0xC3})
+            .bytes({0x48, 0x83, 0xC4, 0x20, 0x5B, 0xC3});
+        m_truth.set("FPostProcessSettings::FPostProcessSettings", p.post_process_settings);
+
+        Assembler{m_image, p.startframe, m_functions}
+            .bytes({0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xD9})
+            .bytes({0x48, 0x81, 0xC1}).u32(VELOCITY_DATA_OFFSET)
+            .bytes({0xE8}).rel32(callee)
+            .bytes({0x48, 0x8B, 0xCB, 0x48, 0x83, 0xC4, 0x20, 0x5B})
+            .bytes({0xE9}).rel32(p.startframe_tail);
+        m_truth.set("FScene::StartFrame", p.startframe);
+
+        Assembler{m_image, p.get_frame_count, m_functions}
+            .bytes({0x8B, 0x81}).u32(FRAME_COUNT_OFFSET)
+            .bytes({0xC3});
+
+        Assembler{m_image, p.startframe_tail, m_functions}
+            .bytes({0x48, 0xB8}).u64(STARTFRAME_MAGIC)
+            .bytes({0x48, 0x89, 0x81}).u32(VELOCITY_DATA_OFFSET + 8)
+            .bytes({0xC3});
+
+        Assembler{m_image, p.update_all_primitive_scene_infos, m_functions}
+            .bytes({0x48, 0x83, 0xEC, 0x28})
+            .bytes({0xE8}).rel32(p.update_transform)
+            .bytes({0x48, 0x83, 0xC4, 0x28, 0xC3});
+        m_truth.set("FScene::UpdateAllPrimitiveSceneInfos", p.update_all_primitive_scene_infos);
+
+        Assembler{m_image, p.update_transform, m_functions}
+            .bytes({0x48, 0x89, 0x5C, 0x24, 0x10, 0x48, 0x89, 0x6C, 0x24, 0x18, 0x56, 0x57, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57})
+            .bytes({0xB8}).u32(0x1050)
+            .bytes({0xE8}).rel32(callee)
+            .bytes({0x48, 0x2B, 0xE0, 0x8B, 0x41, 0x10})
+            .bytes({0x48, 0x81, 0xC4, 0x50, 0x10, 0x00, 0x00, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x5F, 0x5E, 0xC3});
+        m_truth.set("FVelocityData::UpdateTransform", p.update_transform);
+    }
+
+    void write_pdata() {
+        std::sort(m_functions.begin(), m_functions.end(), [](const auto& a, const auto& b) {
+            return a.begin_address < b.begin_address;
+        });
+
+        auto rva = m_layout.pdata;
+
+        for (auto& fn : m_functions) {
+            fn.unwind_data = m_unwind_info;
+            m_image.write(rva, fn);
+            rva += sizeof(fn);
+        }
+
+        m_pdata_used = rva - m_layout.pdata;
+    }
+
+    bool write_relocations() {
+        auto relocations = m_image.get_relocations();
+        std::sort(relocations.begin(), relocations.end());
+
+        auto rva = m_layout.reloc;
+        const auto end = m_layout.reloc + RELOC_SIZE;
+
+        for (auto it = relocations.begin(); it != relocations.end();) {
+            const auto page = *it & ~(PAGE_SIZE - 1);
+            const auto block = rva;
+            rva += sizeof(pe::BaseRelocation);
+
+            for (; it != relocations.end() && (*it & ~(PAGE_SIZE - 1)) == page; ++it) {
+                if (rva + sizeof(uint16_t) * 2 > end) {
+                    return false;
+                }
+
+                m_image.write<uint16_t>(rva, (uint16_t)(pe::REL_BASED_DIR64 << 12 | (*it & (PAGE_SIZE - 1))));
+                rva += sizeof(uint16_t);
+            }
+
+            // Blocks are 4 byte aligned
+            if ((rva - block) % 4 != 0) {
+                m_image.write<uint16_t>(rva, pe::REL_BASED_ABSOLUTE);
+                rva += sizeof(uint16_t);
+            }
+
+            m_image.write(block, pe::BaseRelocation{page, rva - block});
+        }
+
+        m_reloc_used = rva - m_layout.reloc;
+        return true;
+    }
+
+    void write_headers() {
+        const auto& l = m_layout;
+
+        pe::DosHeader dos{};
+        dos.e_magic = pe::DOS_SIGNATURE;
+        dos.e_lfanew = 0x80;
+        m_image.write(0, dos);
+
+        struct SectionSpec {
+            const char* name;
+            uint32_t rva;
+            uint32_t size;
+            uint32_t characteristics;
+        };
+
+        const SectionSpec sections[] = {
+            {".text", l.text, l.text_size, pe::SCN_CNT_CODE | pe::SCN_MEM_EXECUTE | pe::SCN_MEM_READ},
+            {".rdata", l.rdata, l.rdata_size, pe::SCN_CNT_INITIALIZED_DATA | pe::SCN_MEM_READ},
+            {".data", l.data, DATA_SIZE, pe::SCN_CNT_INITIALIZED_DATA | pe::SCN_MEM_READ | pe::SCN_MEM_WRITE},
+            {".pdata", l.pdata, l.pdata_size, pe::SCN_CNT_INITIALIZED_DATA | pe::SCN_MEM_READ},
+            {".reloc", l.reloc, RELOC_SIZE, pe::SCN_CNT_INITIALIZED_DATA | pe::SCN_MEM_DISCARDABLE | pe::SCN_MEM_READ},
+        };
+
+        pe::NtHeaders64 nt{};
+        nt.signature = pe::NT_SIGNATURE;
+        nt.file_header.machine = 0x8664; // AMD64
+        nt.file_header.number_of_sections = (uint16_t)std::size(sections);
+        nt.file_header.size_of_optional_header = sizeof(pe::OptionalHeader64);
+        nt.file_header.characteristics = 0x22; // executable, large address aware
+
+        auto& opt = nt.optional_header;
+        opt.magic = pe::OPTIONAL_HDR64_MAGIC;
+        opt.major_linker_version = 14;
+        opt.size_of_code = l.text_size;
+        opt.size_of_initialized_data = l.image_size - l.text - l.text_size;
+        opt.address_of_entry_point = m_functions.front().begin_address;
+        opt.base_of_code = l.text;
+        opt.image_base = IMAGE_BASE;
+        opt.section_alignment = PAGE_SIZE;
+        opt.file_alignment = PAGE_SIZE;
+        opt.major_operating_system_version = 6;
+        opt.major_subsystem_version = 6;
+        opt.size_of_image = l.image_size;
+        opt.size_of_headers = PAGE_SIZE;
+        opt.subsystem = 2; // GUI
+        opt.dll_characteristics = 0x8160; // high entropy VA, dynamic base, NX compatible, terminal server aware
+        opt.size_of_stack_reserve = 0x100000;
+        opt.size_of_stack_commit = 0x1000;
+        opt.size_of_heap_reserve = 0x100000;
+        opt.size_of_heap_commit = 0x1000;
+        opt.number_of_rva_and_sizes = pe::NUMBER_OF_DIRECTORY_ENTRIES;
+        opt.data_directory[pe::DIRECTORY_ENTRY_EXCEPTION] = {l.pdata, m_pdata_used};
+        opt.data_directory[pe::DIRECTORY_ENTRY_BASERELOC] = {l.reloc, m_reloc_used};
+
+        m_image.write((uint32_t)dos.e_lfanew, nt);
+
+        auto header = (uint32_t)(dos.e_lfanew + sizeof(nt));
+
+        for (const auto& spec : sections) {
+            pe::SectionHeader section{};
+            std::memcpy(section.name, spec.name, std::min(std::strlen(spec.name), sizeof(section.name)));
+            section.virtual_size = spec.size;
+            section.virtual_address = spec.rva;
+            section.size_of_raw_data = spec.size;
+            section.pointer_to_raw_data = spec.rva;
+            section.characteristics = spec.characteristics;
+
+            m_image.write(header, section);
+            header += sizeof(section);
+        }
+    }
+
+    Image m_image;
+    std::mt19937_64 m_rng;
+    GroundTruth m_truth{};
+    Layout m_layout{};
+    Planted m_planted{};
+    std::vector<pe::RuntimeFunction> m_functions{};
+
+    uint32_t m_rdata_cursor{};
+    uint32_t m_data_cursor{};
+    uint32_t m_pdata_used{};
+    uint32_t m_reloc_used{};
+    uint32_t m_unwind_info{};
+    uint32_t m_render_composite_layer_str{};
+    uint32_t m_post_process_str{};
+    uint32_t m_motion_blur_str{};
+    uint32_t m_frame_number_global{};
+    uint32_t m_frame_number_lea_target{};
+};
+}
+
+int main(int argc, char** argv) {
+    std::string path{};
+    std::string manifest_path{};
+    size_t size_mib = 256;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--size" && i + 1 < argc) {
+            size_mib = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (path.empty() && !arg.starts_with("--")) {
+            path = argv[i];
+        } else {
+            path.clear();
+            break;
+        }
+    }
+
+    // Every rel32 has to be able to reach across the whole image
+    if (path.empty() || size_mib < 16 || size_mib > 2047) {
+        std::fprintf(stderr, "usage: %s <out.exe> [--size <MiB, 16 to 2047>] [--seed <n>] [--manifest <path>]\n", argv[0]);
+        return 1;
+    }
+
+    if (manifest_path.empty()) {
+        manifest_path = path + ".manifest";
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    Generator generator{size_mib * 1024 * 1024, seed};
+
+    if (!generator.run()) {
+        return 1;
+    }
+
+    const auto generate_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const auto& bytes = generator.get_image().get_bytes();
+
+    std::ofstream f{path, std::ios::binary | std::ios::trunc};
+
+    if (!f || !f.write((const char*)bytes.data(), bytes.size())) {
+        std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+        return 1;
+    }
+
+    f.close();
+
+    if (!generator.get_truth().save(manifest_path)) {
+        return 1;
+    }
+
+    std::printf("%s: %.1f MiB, %zu functions, generated in %.3fms\n", path.c_str(), bytes.size() / (1024.0 * 1024.0), generator.get_function_count(), generate_ms);
+    std::printf("%s: %zu ground truth entries\n", manifest_path.c_str(), generator.get_truth().get_entries().size());
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+// Checks that merging adjacent CopyDescriptors ranges (see DescriptorCoalesce.hpp) copies exactly the same descriptors,
+// then reports how much it reduces the range count on synthetic workloads.
+// Every call is carried out on a simulated heap, once with the original ranges and once with the merged ones:
+// the (destination slot, source slot) pairs both produce have to be identical, in the same order.
+//
+// > analysis_tests descriptor_coalesce_check
+// > analysis_tests descriptor_coalesce_check --calls 100000
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <analysis/DescriptorCoalesce.hpp>
+
+#include "Checks.hpp"
+
+using namespace analysis;
+
+namespace {
+constexpr uint64_t HEAP_BASE = 0x7FF000000000;
+constexpr uint32_t INCREMENT = 32;
+constexpr uint32_t HEAP_SIZE = 1 << 16;
+constexpr uint32_t CAPACITY = 64; // same as the plugin's on-stack buffers
+
+struct Side {
+    std::vector<uint64_t> starts{};
+    std::vector<uint32_t> sizes{};
+    bool null_sizes{}; // every range is one descriptor, like passing null for the sizes
+};
+
+struct Call {
+    Side dest{};
+    Side src{};
+};
+
+// Slot of every descriptor a side covers, in copy order
+std::vector<uint32_t> flatten(uint32_t num, const uint64_t* starts, const uint32_t* sizes) {
+    std::vector<uint32_t> slots{};
+
+    for (uint32_t i = 0; i < num; ++i) {
+        const auto size = sizes != nullptr ? sizes[i] : 1;
+
+        for (uint32_t j = 0; j < size; ++j) {
+            slots.push_back((uint32_t)((starts[i] - HEAP_BASE) / INCREMENT) + j);
+        }
+    }
+
+    return slots;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> copy(uint32_t num_dest, const uint64_t* dest_starts, const uint32_t* dest_sizes,
+    uint32_t num_src, const uint64_t* src_starts, const uint32_t* src_sizes)
+{
+    const auto dest = flatten(num_dest, dest_starts, dest_sizes);
+    const auto src = flatten(num_src, src_starts, src_sizes);
+    std::vector<std::pair<uint32_t, uint32_t>> pairs{};
+
+    for (size_t i = 0; i < std::min(dest.size(), src.size()); ++i) {
+        pairs.emplace_back(dest[i], src[i]);
+    }
+
+    return pairs;
+}
+
+// Runs of adjacent ranges with the given odds of the next range continuing the run, sometimes empty ranges in between
+Side make_side(std::mt19937_64& rng, uint32_t num, uint32_t descriptors, double adjacency, bool null_sizes) {
+    Side side{};
+    side.null_sizes = null_sizes;
+
+    std::bernoulli_distribution adjacent{adjacency};
+    uint32_t slot = (uint32_t)(rng() % (HEAP_SIZE - descriptors * 4));
+
+    for (uint32_t i = 0; i < num; ++i) {
+        const auto size = null_sizes ? 1 : (rng() % 16 == 0 ? 0 : 1 + (uint32_t)(rng() % 4));
+
+        if (i > 0 && !adjacent(rng)) {
+            slot = (uint32_t)(rng() % (HEAP_SIZE - 8));
+        }
+
+        side.starts.push_back(HEAP_BASE + (uint64_t)slot * INCREMENT);
+        side.sizes.push_back(size);
+        slot += size;
+    }
+
+    return side;
+}
+
+// Source side with the same total descriptor count as dest, the way CopyDescriptors requires
+Side make_matching_side(std::mt19937_64& rng, const Side& dest, double adjacency) {
+    uint32_t total = 0;
+
+    for (const auto size : dest.sizes) {
+        total += size;
+    }
+
+    Side side{};
+    std::bernoulli_distribution adjacent{adjacency};
+    uint32_t slot = (uint32_t)(rng() % (HEAP_SIZE - total - 8));
+
+    while (total > 0) {
+        const auto size = std::min<uint32_t>(total, 1 + (uint32_t)(rng() % 3));
+
+        if (!side.starts.empty() && !adjacent(rng)) {
+            slot = (uint32_t)(rng() % (HEAP_SIZE - size - 8));
+        }
+
+        side.starts.push_back(HEAP_BASE + (uint64_t)slot * INCREMENT);
+        side.sizes.push_back(size);
+        slot += size;
+        total -= size;
+    }
+
+    return side;
+}
+
+struct Merged {
+    bool ok{};
+    uint32_t dest_count{};
+    uint32_t src_count{};
+    uint64_t dest_starts[CAPACITY];
+    uint32_t dest_sizes[CAPACITY];
+    uint64_t src_starts[CAPACITY];
+    uint32_t src_sizes[CAPACITY];
+};
+
+void merge(const Call& call, Merged& m) {
+    CoalescedRanges dest{m.dest_starts, m.dest_sizes, CAPACITY};
+    CoalescedRanges src{m.src_starts, m.src_sizes, CAPACITY};
+
+    m.ok = coalesce_descriptor_ranges((uint32_t)call.dest.starts.size(), call.dest.starts.data(), call.dest.null_sizes ? nullptr : call.dest.sizes.data(), INCREMENT, dest) &&
+        coalesce_descriptor_ranges((uint32_t)call.src.starts.size(), call.src.starts.data(), call.src.null_sizes ? nullptr : call.src.sizes.data(), INCREMENT, src);
+    m.dest_count = dest.count;
+    m.src_count = src.count;
+}
+
+bool check_call(const Call& call, size_t n) {
+    Merged m{};
+    merge(call, m);
+
+    const auto dest_sizes = call.dest.null_sizes ? nullptr : call.dest.sizes.data();
+    const auto src_sizes = call.src.null_sizes ? nullptr : call.src.sizes.data();
+    const auto expected = copy((uint32_t)call.dest.starts.size(), call.dest.starts.data(), dest_sizes, (uint32_t)call.src.starts.size(), call.src.starts.data(), src_sizes);
+
+    if (!m.ok) {
+        // Only allowed when the merged ranges really don't fit
+        return call.dest.starts.size() > CAPACITY || call.src.starts.size() > CAPACITY;
+    }
+
+    const auto result = copy(m.dest_count, m.dest_starts, m.dest_sizes, m.src_count, m.src_starts, m.src_sizes);
+
+    if (result != expected) {
+        std::fprintf(stderr, "call %zu: merged copy touches different slots (%zu pair(s), expected %zu)\n", n, result.size(), expected.size());
+        return false;
+    }
+
+    if (m.dest_count > call.dest.starts.size() || m.src_count > call.src.starts.size()) {
+        std::fprintf(stderr, "call %zu: merging added ranges\n", n);
+        return false;
+    }
+
+    return true;
+}
+
+struct Workload {
+    const char* name{};
+    uint32_t min_ranges{};
+    uint32_t max_ranges{};
+    double adjacency{};
+    bool null_dest_sizes{};
+};
+}
+
+int descriptor_coalesce_check_main(int argc, char** argv) {
+    size_t calls = 20000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--calls" && i + 1 < argc) {
+            calls = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else {
+            std::fprintf(stderr, "usage: %s [--calls <n per workload>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Roughly what a renderer does: descriptor tables gathered one SRV at a time from a staging heap (mostly adjacent),
+    // scattered single descriptors, and big batches that won't fit on the stack
+    const Workload workloads[] = {
+        {"tables", 2, 32, 0.9, true},
+        {"mixed", 1, 48, 0.5, false},
+        {"scattered", 1, 32, 0.05, true},
+        {"oversized", 65, 512, 0.3, false},
+    };
+
+    std::mt19937_64 rng{1};
+    bool ok = true;
+
+    std::printf("workload,calls,ranges_before,ranges_after,reduction,merged_calls,passed_through,ns_per_call\n");
+
+    for (const auto& w : workloads) {
+        std::vector<Call> batch{};
+
+        for (size_t n = 0; n < calls; ++n) {
+            const auto num = w.min_ranges + (uint32_t)(rng() % (w.max_ranges - w.min_ranges + 1));
+
+            Call call{};
+            call.dest = make_side(rng, num, num * 4, w.adjacency, w.null_dest_sizes);
+            call.src = make_matching_side(rng, call.dest, w.adjacency);
+            batch.push_back(std::move(call));
+        }
+
+        size_t before = 0, after = 0, merged_calls = 0, passed = 0;
+
+        for (size_t n = 0; n < batch.size(); ++n) {
+            const auto& call = batch[n];
+
+            ok &= check_call(call, n);
+
+            Merged m{};
+            merge(call, m);
+
+            const auto original = call.dest.starts.size() + call.src.starts.size();
+            before += original;
+
+            // Same decision as the plugin: only forward merged ranges when they're actually fewer
+            if (m.ok && m.dest_count + m.src_count < original) {
+                after += m.dest_count + m.src_count;
+                ++merged_calls;
+            } else {
+                after += original;
+                ++passed;
+            }
+        }
+
+        // Uninitialized buffers like the plugin's, the sink keeps the merging from being optimized away
+        volatile uint32_t sink = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto& call : batch) {
+            Merged m;
+            merge(call, m);
+            sink = sink + m.dest_count;
+        }
+
+        const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / batch.size();
+
+        std::printf("%s,%zu,%zu,%zu,%.1f%%,%zu,%zu,%.1f\n", w.name, batch.size(), before, after, 100.0 * (1.0 - (double)after / before), merged_calls, passed, ns);
+    }
+
+    // Hand picked edge cases: empty lists, empty ranges in a run, a run broken by a gap, capacity exactly reached
+    {
+        uint64_t starts[CAPACITY + 1]{};
+        uint32_t sizes[CAPACITY + 1]{};
+        uint64_t out_starts[CAPACITY];
+        uint32_t out_sizes[CAPACITY];
+
+        for (uint32_t i = 0; i <= CAPACITY; ++i) {
+            starts[i] = HEAP_BASE + (uint64_t)i * 2 * INCREMENT; // every other slot, nothing merges
+            sizes[i] = 1;
+        }
+
+        CoalescedRanges out{out_starts, out_sizes, CAPACITY};
+
+        ok &= coalesce_descriptor_ranges(0, nullptr, nullptr, INCREMENT, out) && out.count == 0;
+        ok &= coalesce_descriptor_ranges(CAPACITY, starts, sizes, INCREMENT, out) && out.count == CAPACITY;
+        ok &= !coalesce_descriptor_ranges(CAPACITY + 1, starts, sizes, INCREMENT, out);
+
+        const uint64_t run[] = {HEAP_BASE, HEAP_BASE + INCREMENT, HEAP_BASE + 5 * INCREMENT, HEAP_BASE + 2 * INCREMENT, HEAP_BASE + 3 * INCREMENT};
+        const uint32_t run_sizes[] = {1, 0, 1, 1, 2};
+
+        ok &= coalesce_descriptor_ranges(5, run, run_sizes, INCREMENT, out) && out.count == 3 && out.sizes[0] == 1 && out.sizes[2] == 3;
+    }
+
+    std::printf("Correctness: %s\n", ok ? "ok" : "MISMATCH");
+
+    return ok ? 0 : 1;
+}
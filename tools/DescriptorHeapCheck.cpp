@@ -0,0 +1,325 @@
+// Checks DescriptorHeapIndex against a brute force reference on synthetic heap layouts, then measures lookup throughput.
+// Heaps get random sizes, types and increments (like the per type GetDescriptorHandleIncrementSize), some get destroyed
+// and some of their address space reused by new heaps. Every query's answer has to match a linear search over the
+// same layout. The throughput pass runs readers while a writer keeps creating and destroying heaps, so every
+// lookup races a snapshot swap.
+//
+// > analysis_tests descriptor_heap_check
+// > analysis_tests descriptor_heap_check --heaps 256 --queries 10000000 --readers 4
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <analysis/DescriptorHeapIndex.hpp>
+
+#include "Checks.hpp"
+
+using namespace analysis;
+
+namespace {
+constexpr uint32_t INCREMENTS[] = {32, 32, 32, 64}; // CBV_SRV_UAV, SAMPLER, RTV, DSV
+
+// Same rules as DescriptorHeapIndex, one range at a time
+DescriptorCheck reference_check(const std::vector<DescriptorHeapRange>& ranges, uint64_t handle, uint32_t count, uint32_t type) {
+    for (const auto& r : ranges) {
+        if (handle < r.base || handle >= r.end()) {
+            continue;
+        }
+
+        if (!r.live) {
+            return DescriptorCheck::STALE;
+        }
+
+        if (r.type != type) {
+            return DescriptorCheck::WRONG_TYPE;
+        }
+
+        if ((handle - r.base) % r.increment != 0) {
+            return DescriptorCheck::MISALIGNED;
+        }
+
+        return (handle - r.base) / r.increment + count > r.count ? DescriptorCheck::OUT_OF_BOUNDS : DescriptorCheck::OK;
+    }
+
+    return DescriptorCheck::UNKNOWN;
+}
+
+// Applies add/remove to the reference the way the index does: a new heap replaces whatever it overlaps
+void reference_add(std::vector<DescriptorHeapRange>& ranges, const DescriptorHeapRange& range) {
+    std::erase_if(ranges, [&](const DescriptorHeapRange& r) { return r.base < range.end() && range.base < r.end(); });
+    ranges.push_back(range);
+}
+
+DescriptorHeapRange make_heap(std::mt19937_64& rng, uint64_t base, size_t id) {
+    DescriptorHeapRange r{};
+    r.type = (uint32_t)(rng() % 4);
+    r.increment = INCREMENTS[r.type];
+    r.count = 1 + (uint32_t)(rng() % 4096);
+    r.base = base;
+    r.heap = (const void*)(uintptr_t)(0x1000 + id * 16);
+
+    return r;
+}
+
+uint64_t random_handle(std::mt19937_64& rng, const std::vector<DescriptorHeapRange>& ranges, uint64_t space) {
+    if (ranges.empty() || rng() % 8 == 0) {
+        return rng() % space;
+    }
+
+    // Mostly inside (or just past) some heap, occasionally off a descriptor boundary
+    const auto& r = ranges[rng() % ranges.size()];
+    auto handle = r.base + (rng() % (r.count + 4)) * r.increment;
+
+    if (rng() % 16 == 0) {
+        handle += 8;
+    }
+
+    return handle;
+}
+
+bool check_correctness(size_t num_heaps, uint32_t seed) {
+    std::mt19937_64 rng{seed};
+    DescriptorHeapIndex index{};
+    std::vector<DescriptorHeapRange> reference{};
+    std::vector<const void*> live{};
+    uint64_t next_base = 0x10000;
+    size_t next_id = 0;
+
+    for (size_t step = 0; step < num_heaps * 4; ++step) {
+        const auto action = rng() % 8;
+
+        if (action < 5 || live.empty()) {
+            // Either fresh address space, or reusing the start of an earlier heap's range
+            uint64_t base = next_base;
+
+            if (!reference.empty() && rng() % 4 == 0) {
+                base = reference[rng() % reference.size()].base;
+            }
+
+            const auto heap = make_heap(rng, base, next_id++);
+            next_base = std::max(next_base, heap.end() + (rng() % 4) * 0x1000);
+
+            index.add(heap);
+            reference_add(reference, heap);
+            std::erase_if(live, [&](const void* h) { return std::none_of(reference.begin(), reference.end(), [&](const DescriptorHeapRange& r) { return r.live && r.heap == h; }); });
+            live.push_back(heap.heap);
+        } else {
+            const auto i = rng() % live.size();
+            const auto heap = live[i];
+            live.erase(live.begin() + i);
+
+            if (!index.remove(heap)) {
+                std::fprintf(stderr, "step %zu: remove of a live heap failed\n", step);
+                return false;
+            }
+
+            for (auto& r : reference) {
+                if (r.live && r.heap == heap) {
+                    r.live = false;
+                    r.heap = nullptr;
+                }
+            }
+
+            // The index only remembers so many stale ranges, the lowest ones go first
+            std::sort(reference.begin(), reference.end(), [](const DescriptorHeapRange& a, const DescriptorHeapRange& b) { return a.base < b.base; });
+            auto dead = (size_t)std::count_if(reference.begin(), reference.end(), [](const DescriptorHeapRange& r) { return !r.live; });
+
+            std::erase_if(reference, [&](const DescriptorHeapRange& r) {
+                return !r.live && dead-- > DescriptorHeapIndex::MAX_DEAD_RANGES;
+            });
+        }
+
+        if (index.remove((const void*)(uintptr_t)0xdead)) {
+            std::fprintf(stderr, "step %zu: removed a heap that was never added\n", step);
+            return false;
+        }
+
+        for (size_t q = 0; q < 64; ++q) {
+            const auto handle = random_handle(rng, reference, next_base + 0x10000);
+            const auto count = 1 + (uint32_t)(rng() % 8);
+            const auto type = (uint32_t)(rng() % 4);
+
+            const auto expected = reference_check(reference, handle, count, type);
+            const auto result = index.check(handle, count, type);
+
+            if (expected != result) {
+                std::fprintf(stderr, "step %zu: 0x%llx x%u type %u is %s, expected %s\n",
+                    step, (unsigned long long)handle, count, type, to_string(result), to_string(expected));
+                return false;
+            }
+        }
+
+        if (index.get_heap_count() != live.size()) {
+            std::fprintf(stderr, "step %zu: %zu live heap(s), expected %zu\n", step, index.get_heap_count(), live.size());
+            return false;
+        }
+
+        // The filter may let through heaps that aren't tracked, but never leave out one that is
+        if (const auto missing = std::find_if(live.begin(), live.end(), [&](const void* h) { return !index.may_be_tracked(h); }); missing != live.end()) {
+            std::fprintf(stderr, "step %zu: live heap %p filtered out\n", step, *missing);
+            return false;
+        }
+    }
+
+    // A whole call, with one bad source range in the middle
+    const auto good = std::find_if(reference.begin(), reference.end(), [](const DescriptorHeapRange& r) { return r.live; });
+
+    if (good != reference.end()) {
+        const uint64_t starts[] = {good->base, good->base, good->end() - good->increment, good->base};
+        const uint32_t sizes[] = {1, good->count, 2, 1};
+        const auto copy = index.check_copy(1, starts, nullptr, 4, starts, sizes, good->type);
+
+        if (copy.result != DescriptorCheck::OUT_OF_BOUNDS || !copy.source || copy.index != 2) {
+            std::fprintf(stderr, "check_copy: %s on %s range %u, expected out of bounds on source range 2\n",
+                to_string(copy.result), copy.source ? "source" : "destination", copy.index);
+            return false;
+        }
+
+        index.remember_fault(good->base);
+
+        if (index.check(good->base, 1, good->type) != DescriptorCheck::FAULTED) {
+            std::fprintf(stderr, "remember_fault: 0x%llx still passes\n", (unsigned long long)good->base);
+            return false;
+        }
+
+        // Only recent faults count
+        const auto faulted_at = std::chrono::steady_clock::now() - DescriptorHeapIndex::FAULT_LIFETIME;
+        index.remember_fault(good->base + good->increment, faulted_at);
+
+        if (index.has_faulted(good->base + good->increment) || !index.has_faulted(good->base + good->increment, faulted_at)) {
+            std::fprintf(stderr, "remember_fault: 0x%llx doesn't expire after %llds\n", (unsigned long long)(good->base + good->increment),
+                (long long)DescriptorHeapIndex::FAULT_LIFETIME.count());
+            return false;
+        }
+
+        // The same object recreated at the same address: the old one's late removal must not touch it,
+        // and the new heap's descriptors haven't faulted yet
+        const auto old_serial = index.get_serial(good->heap);
+        index.remove(good->heap);
+        const auto new_serial = index.add(*good);
+
+        if (index.remove(good->heap, old_serial) || index.get_serial(good->heap) != new_serial || index.check(good->base, 1, good->type) != DescriptorCheck::OK) {
+            std::fprintf(stderr, "recreated heap at 0x%llx wasn't told apart from the old one\n", (unsigned long long)good->base);
+            return false;
+        }
+
+        // Same object pointer somewhere else without a Release in between, only the newest one is live
+        auto moved = *good;
+        moved.base = next_base;
+        const auto heap_count = index.get_heap_count();
+        const auto moved_serial = index.add(moved);
+
+        if (index.get_serial(good->heap) != moved_serial || index.get_heap_count() != heap_count || index.check(good->base, 1, good->type) != DescriptorCheck::STALE) {
+            std::fprintf(stderr, "heap %p moved to 0x%llx, old range still live\n", good->heap, (unsigned long long)moved.base);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void bench(size_t num_heaps, size_t queries, size_t num_readers) {
+    std::mt19937_64 rng{42};
+    DescriptorHeapIndex index{};
+    std::vector<DescriptorHeapRange> heaps{};
+    uint64_t base = 0x10000;
+
+    for (size_t i = 0; i < num_heaps; ++i) {
+        heaps.push_back(make_heap(rng, base, i));
+        base = heaps.back().end() + 0x1000;
+        index.add(heaps.back());
+    }
+
+    std::vector<uint64_t> handles(4096);
+
+    for (auto& h : handles) {
+        h = random_handle(rng, heaps, base);
+    }
+
+    std::atomic<bool> stop{false};
+
+    // Keeps swapping snapshots: destroys a heap and creates it again right away
+    std::thread writer{[&]() {
+        size_t i = 0;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            const auto& heap = heaps[i++ % heaps.size()];
+            index.remove(heap.heap);
+            index.add(heap);
+            std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+    }};
+
+    const auto generation = index.get_generation();
+    std::vector<std::thread> readers{};
+    std::atomic<size_t> ok_count{0};
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t t = 0; t < num_readers; ++t) {
+        readers.emplace_back([&, t]() {
+            size_t ok = 0;
+
+            for (size_t i = 0; i < queries; ++i) {
+                const auto handle = handles[(i + t * 997) % handles.size()];
+                ok += index.check(handle, 1, (uint32_t)(handle >> 5) & 3) == DescriptorCheck::OK;
+            }
+
+            ok_count += ok;
+        });
+    }
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stop = true;
+    writer.join();
+
+    std::printf("%zu heap(s), %zu reader(s): %.1f M lookups/s per reader, %.1f ns/lookup, %zu snapshot swap(s) meanwhile, %zu ok\n",
+        num_heaps, num_readers, queries / elapsed / 1e6, elapsed * 1e9 / queries, index.get_generation() - generation, ok_count.load());
+}
+}
+
+int descriptor_heap_check_main(int argc, char** argv) {
+    size_t num_heaps = 128;
+    size_t queries = 5000000;
+    size_t num_readers = 2;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--heaps" && i + 1 < argc) {
+            num_heaps = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--queries" && i + 1 < argc) {
+            queries = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--readers" && i + 1 < argc) {
+            num_readers = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else {
+            std::fprintf(stderr, "usage: %s [--heaps <n>] [--queries <n per reader>] [--readers <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bool ok = true;
+
+    for (uint32_t seed = 1; seed <= 8 && ok; ++seed) {
+        ok &= check_correctness(num_heaps, seed);
+    }
+
+    std::printf("Correctness: %s\n", ok ? "ok" : "MISMATCH");
+
+    for (const auto heaps : {size_t{8}, num_heaps}) {
+        bench(heaps, queries, num_readers);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Producer cost of EventLog::post under contention, against logging the same thing synchronously through spdlog.
+// Every thread hammers the same event type, like a burst of rejected CopyDescriptors calls from the driver's threads.
+// The synchronous loggers write to a null sink, so they only pay for formatting and the sink mutex, no actual I/O.
+// The event log gets polled from a thread of its own meanwhile, once per TICK like the plugin's drain timer does.
+// Afterwards the counts in the collapsed summaries have to add up to every post that wasn't dropped.
+//
+// > event_log_bench
+// > event_log_bench --threads 16 --events 200000
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <analysis/EventLog.hpp>
+
+using namespace analysis;
+
+namespace {
+constexpr std::chrono::milliseconds TICK{10};
+
+constexpr EventType REJECTED{
+    spdlog::level::critical,
+    "Bad read on pSrcDescriptorRangeStarts[{}], skipping",
+    "Rejected {} CopyDescriptors call(s) in last {}ms, first index {}",
+};
+
+// Adds up how many events the lines written by the event log stand for
+class CountingSink final : public spdlog::sinks::base_sink<std::mutex> {
+public:
+    size_t get_events() const {
+        return m_events.load();
+    }
+
+    size_t get_lines() const {
+        return m_lines.load();
+    }
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override {
+        const std::string payload{msg.payload.data(), msg.payload.size()};
+        size_t count{};
+
+        if (std::sscanf(payload.c_str(), "Rejected %zu", &count) == 1) {
+            m_events += count;
+        } else if (payload.starts_with("Bad read")) {
+            m_events += 1;
+        }
+
+        ++m_lines;
+    }
+
+    void flush_() override {}
+
+private:
+    std::atomic<size_t> m_events{0};
+    std::atomic<size_t> m_lines{0};
+};
+
+// Average cost of one call per thread, with every thread released at the same time.
+template <typename T>
+double measure_ns(size_t num_threads, size_t events, T&& produce) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads{};
+    std::vector<double> elapsed(num_threads);
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            ++ready;
+
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < events; ++i) {
+                produce(i);
+            }
+
+            elapsed[t] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
+
+    while (ready.load() < num_threads) {
+        std::this_thread::yield();
+    }
+
+    go = true;
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double total = 0.0;
+
+    for (const auto e : elapsed) {
+        total += e;
+    }
+
+    return total / (num_threads * events);
+}
+}
+
+int main(int argc, char** argv) {
+    size_t num_threads = 16;
+    size_t events = 100000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--threads" && i + 1 < argc) {
+            num_threads = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--events" && i + 1 < argc) {
+            events = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else {
+            std::fprintf(stderr, "usage: %s [--threads <n>] [--events <n per thread>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("%zu thread(s), %zu event(s) each\n", num_threads, events);
+
+    const auto sync_logger = std::make_shared<spdlog::logger>("sync", std::make_shared<spdlog::sinks::null_sink_mt>());
+    const auto sync_ns = measure_ns(num_threads, events, [&](size_t i) {
+        sync_logger->critical("Bad read on pSrcDescriptorRangeStarts[{}], skipping", i);
+    });
+
+    std::printf("  %-16s %8.1f ns/event\n", "spdlog (sync)", sync_ns);
+
+    // Same, but flushing every line like the plugin used to (flush_on(info)), a null sink makes that free though
+    sync_logger->flush_on(spdlog::level::info);
+    const auto flush_ns = measure_ns(num_threads, events, [&](size_t i) {
+        sync_logger->critical("Bad read on pSrcDescriptorRangeStarts[{}], skipping", i);
+    });
+
+    std::printf("  %-16s %8.1f ns/event\n", "spdlog (flush)", flush_ns);
+
+    const auto sink = std::make_shared<CountingSink>();
+    size_t dropped{};
+    double async_ns{};
+
+    {
+        EventLog log{std::make_shared<spdlog::logger>("async", sink)};
+        std::atomic<bool> stop{false};
+
+        std::thread ticker{[&]() {
+            while (!stop.load()) {
+                std::this_thread::sleep_for(TICK);
+                log.poll();
+            }
+        }};
+
+        async_ns = measure_ns(num_threads, events, [&](size_t i) {
+            log.post(REJECTED, (int64_t)i);
+        });
+
+        stop = true;
+        ticker.join();
+
+        dropped = log.get_dropped();
+    }
+
+    const auto posted = num_threads * events;
+    const auto ok = sink->get_events() + dropped == posted;
+
+    std::printf("  %-16s %8.1f ns/event  %.1fx\n", "EventLog", async_ns, sync_ns / async_ns);
+    std::printf("  %zu event(s) posted, %zu dropped, %zu collapsed into %zu line(s)  %s\n",
+        posted, dropped, sink->get_events(), sink->get_lines(), ok ? "ok" : "MISMATCH");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// Ports hook targets from one build of the game to another by function fingerprint.
+// Resolves every function target in the old executable, fingerprints it and looks it up in the
+// fingerprint index of the new one, printing the match and how confident it is. Where the signatures
+// still work on the new build, the match is checked against them too.
+//
+// > fingerprint_match ff7rebirth_old.exe ff7rebirth_.exe
+// > fingerprint_match ff7rebirth_old.exe ff7rebirth_.exe --rva FSceneRenderer::CreateSceneRenderer=0x1234560
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <analysis/Fingerprint.hpp>
+#include <analysis/GameResolver.hpp>
+#include <analysis/MappedImage.hpp>
+
+using namespace analysis;
+
+namespace {
+struct Target {
+    std::string name{};
+    std::function<std::optional<uintptr_t>(GameResolver&)> resolve{};
+};
+
+std::vector<Target> get_default_targets() {
+    return {
+        {"FEndMenuRenderer::OnRenderCompositeLayerEx", [](GameResolver& r) { return r.find_render_composite_layer(); }},
+        {"FPostProcessSettings::FPostProcessSettings", [](GameResolver& r) { return r.find_post_process_settings(); }},
+        {"FScene::StartFrame", [](GameResolver& r) -> std::optional<uintptr_t> {
+            const auto result = r.find_startframe();
+            return result ? std::optional<uintptr_t>{result->fn} : std::nullopt;
+        }},
+        {"FVelocityData::UpdateTransform", [](GameResolver& r) { return r.find_update_transform(); }},
+        {"FScene::UpdateAllPrimitiveSceneInfos", [](GameResolver& r) -> std::optional<uintptr_t> {
+            const auto update_transform = r.find_update_transform();
+            return update_transform ? r.find_update_all_primitive_scene_infos(*update_transform) : std::nullopt;
+        }},
+    };
+}
+
+// Custom targets only exist as an RVA in the old build, there's nothing to check the match against.
+Target make_rva_target(std::string name, uint32_t rva, uintptr_t old_base) {
+    return {std::move(name), [rva, old_base](GameResolver& r) -> std::optional<uintptr_t> {
+        if (r.get_module() != old_base) {
+            return std::nullopt;
+        }
+
+        return old_base + rva;
+    }};
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths{};
+    std::vector<std::pair<std::string, uint32_t>> rvas{};
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--rva" && i + 1 < argc) {
+            const std::string_view spec{argv[++i]};
+            const auto eq = spec.find('=');
+
+            if (eq == std::string_view::npos) {
+                paths.clear();
+                break;
+            }
+
+            rvas.emplace_back(std::string{spec.substr(0, eq)}, (uint32_t)std::strtoul(std::string{spec.substr(eq + 1)}.c_str(), nullptr, 0));
+        } else if (!arg.starts_with("--")) {
+            paths.push_back(argv[i]);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+
+    if (paths.size() != 2) {
+        std::fprintf(stderr, "usage: %s <old.exe> <new.exe> [--rva <name>=<rva>]... [--verbose]\n", argv[0]);
+        return 1;
+    }
+
+    spdlog::set_level(verbose ? spdlog::level::info : spdlog::level::warn);
+
+    const auto old_image = MappedImage::load(paths[0]);
+    const auto new_image = MappedImage::load(paths[1]);
+
+    if (old_image == nullptr || new_image == nullptr) {
+        return 1;
+    }
+
+    GameResolver old_resolver{old_image->get_base()};
+    GameResolver new_resolver{new_image->get_base()};
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto& index = new_resolver.get_fingerprints();
+    const auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Fingerprinted %zu functions of %s in %.3fms\n", index.size(), paths[1].c_str(), build_ms);
+    std::printf("  %-48s %-10s  %-10s  %10s  %6s  %10s  %s\n", "target", "old", "new", "confidence", "margin", "candidates", "signature");
+
+    auto targets = get_default_targets();
+
+    for (auto& [name, rva] : rvas) {
+        targets.push_back(make_rva_target(name, rva, old_image->get_base()));
+    }
+
+    bool ok = true;
+
+    for (const auto& target : targets) {
+        const auto old_fn = target.resolve(old_resolver);
+
+        if (!old_fn) {
+            std::printf("  %-48s %-10s\n", target.name.c_str(), "FAILED");
+            ok = false;
+            continue;
+        }
+
+        const auto old_rva = (unsigned long long)(*old_fn - old_image->get_base());
+        const auto fingerprint = old_resolver.fingerprint_function(*old_fn);
+        const auto match = fingerprint ? index.find(*fingerprint) : std::nullopt;
+
+        if (!match) {
+            std::printf("  %-48s 0x%08llx  no match\n", target.name.c_str(), old_rva);
+            ok = false;
+            continue;
+        }
+
+        const auto new_rva = (unsigned long long)(match->function - new_image->get_base());
+        const auto confident = match->confidence >= GameResolver::MIN_FINGERPRINT_CONFIDENCE && match->margin >= GameResolver::MIN_FINGERPRINT_MARGIN;
+
+        // Whatever the signatures say on the new build, if they still work there
+        const auto expected = target.resolve(new_resolver);
+        const char* check = !expected ? "n/a" : *expected == match->function ? "agrees" : "DIFFERS";
+
+        std::printf("  %-48s 0x%08llx  0x%08llx  %9.2f%s  %6.2f  %10zu  %s\n",
+            target.name.c_str(),
+            old_rva,
+            new_rva,
+            match->confidence,
+            confident ? " " : "?",
+            match->margin,
+            match->candidates,
+            check);
+
+        ok &= confident && (!expected || *expected == match->function);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+// Scanner throughput benchmark.
+// Runs every supported scan kernel over either a file loaded from disk or synthetic images,
+// checks that they all agree with the scalar path and prints the throughput.
+// The last row is the memchr skip over the pattern's rarest byte (see AnchorScan.hpp).
+//
+// > scan_bench                                   (256 MiB and 1 GiB synthetic images)
+// > scan_bench --size 512 --pattern "48 8B ? ? 90"
+// > scan_bench --file ff7rebirth_.exe
+// > scan_bench --file corpus.exe --manifest corpus.exe.manifest
+//   (the matches in the file must be exactly the manifest's FVelocityData::UpdateTransform, see corpus_gen)
+// > scan_bench --threads 16
+//   (also prints chunked WorkPool scan throughput against thread count as CSV, see ParallelScan.hpp)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <analysis/AnchorScan.hpp>
+#include <analysis/GroundTruth.hpp>
+#include <analysis/ParallelScan.hpp>
+#include <analysis/Pattern.hpp>
+#include <analysis/SimdScan.hpp>
+#include <analysis/StaticPattern.hpp>
+#include <analysis/WorkPool.hpp>
+
+using namespace analysis;
+
+namespace {
+constexpr std::string_view DEFAULT_PATTERN = "48 89 5C 24 10 48 89 6C 24 18 56 57 41 55 41 56 41 57 B8 ? ? ? ? E8 ? ? ? ? 48 2B E0 8B 41 10";
+constexpr StaticPattern DEFAULT_STATIC_PATTERN{"48 89 5C 24 10 48 89 6C 24 18 56 57 41 55 41 56 41 57 B8 ? ? ? ? E8 ? ? ? ? 48 2B E0 8B 41 10"};
+static_assert(DEFAULT_STATIC_PATTERN.size == 34 && DEFAULT_STATIC_PATTERN.mask[DEFAULT_STATIC_PATTERN.anchor] == 0xFF);
+constexpr size_t PLANTED_MATCHES = 16;
+constexpr std::string_view DEFAULT_EXPECTED = "FVelocityData::UpdateTransform";
+
+struct Image {
+    std::string name{};
+    std::vector<uint8_t> data{};
+};
+
+// Not a real instruction stream, but skewed towards the bytes that dominate x64 code
+// (REX prefixes, mov/lea opcodes, ModRM bytes for rsp/rbp based addressing, padding) so that
+// candidate filtering behaves closer to a real .text than uniform noise would.
+std::vector<uint8_t> make_synthetic_image(size_t size, uint32_t seed) {
+    static constexpr uint8_t common[] = {
+        0x00, 0x00, 0x00, 0x48, 0x48, 0x48, 0x89, 0x8B, 0x8D, 0x4C, 0x24, 0x44, 0x45, 0x0F,
+        0xE8, 0xFF, 0xCC, 0xC3, 0x83, 0xC4, 0x5C, 0x74, 0x75, 0x33, 0xC0, 0x41, 0x85, 0x90,
+    };
+
+    std::vector<uint8_t> data(size);
+    std::mt19937_64 rng{seed};
+
+    for (size_t i = 0; i < size; i += 8) {
+        auto r = rng();
+
+        for (size_t j = 0; j < 8 && i + j < size; ++j, r >>= 8) {
+            const auto b = (uint8_t)r;
+            data[i + j] = (b & 1) ? common[(b >> 1) % std::size(common)] : (uint8_t)(b ^ (r >> 11));
+        }
+    }
+
+    return data;
+}
+
+void plant(std::vector<uint8_t>& data, const Pattern& pattern, size_t count, uint32_t seed) {
+    std::mt19937_64 rng{seed};
+
+    for (size_t n = 0; n < count; ++n) {
+        const auto offset = rng() % (data.size() - pattern.size());
+
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (pattern.mask[i] == 0xFF) {
+                data[offset + i] = pattern.bytes[i];
+            }
+        }
+    }
+}
+
+std::optional<Image> load_file(const std::string& path) {
+    std::ifstream f{path, std::ios::binary | std::ios::ate};
+
+    if (!f) {
+        return std::nullopt;
+    }
+
+    Image image{};
+    image.name = path;
+    image.data.resize((size_t)f.tellg());
+    f.seekg(0);
+    f.read((char*)image.data.data(), image.data.size());
+
+    return image;
+}
+
+template <typename T>
+double measure(const Image& image, size_t iterations, std::vector<uintptr_t>& matches, T&& scan) {
+    double best = 0.0;
+
+    for (size_t i = 0; i < iterations; ++i) {
+        matches.clear();
+
+        const auto start = std::chrono::steady_clock::now();
+        scan(matches);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        best = std::max(best, image.data.size() / elapsed / 1e9);
+    }
+
+    return best;
+}
+
+// expected is where the pattern is known to match in image, checked against the scalar path.
+bool bench(const Image& image, const simd::CompiledPattern& pattern, const AnchoredPattern& anchored, size_t iterations, std::optional<uint64_t> expected) {
+    std::vector<uintptr_t> reference{};
+    bool all_identical = true;
+
+    std::printf("%s (%.1f MiB)\n", image.name.c_str(), image.data.size() / (1024.0 * 1024.0));
+
+    for (const auto isa : {simd::Isa::SCALAR, simd::Isa::AVX2, simd::Isa::AVX512}) {
+        if (isa > simd::get_isa()) {
+            std::printf("  %-8s unsupported\n", simd::to_string(isa));
+            continue;
+        }
+
+        std::vector<uintptr_t> matches{};
+        const auto best = measure(image, iterations, matches, [&](std::vector<uintptr_t>& out) {
+            simd::find_all(image.data.data(), image.data.size(), pattern, out, isa);
+        });
+
+        if (isa == simd::Isa::SCALAR) {
+            reference = matches;
+        }
+
+        const auto identical = matches == reference;
+        all_identical &= identical;
+
+        std::printf("  %-8s %8.2f GB/s  %zu match(es)  %s\n", simd::to_string(isa), best, matches.size(), identical ? "identical" : "MISMATCH");
+    }
+
+    std::vector<uintptr_t> matches{};
+    const auto best = measure(image, iterations, matches, [&](std::vector<uintptr_t>& out) {
+        find_all(image.data.data(), image.data.size(), anchored, out);
+    });
+
+    const auto identical = matches == reference;
+    all_identical &= identical;
+
+    std::printf("  %-8s %8.2f GB/s  %zu match(es)  %s\n", "anchor", best, matches.size(), identical ? "identical" : "MISMATCH");
+
+    if (expected) {
+        // Raw offsets are RVAs in a corpus_gen image
+        const auto found = reference.size() == 1 && reference[0] - (uintptr_t)image.data.data() == *expected;
+        all_identical &= found;
+
+        std::printf("  %-8s 0x%08llx  %s\n", "expected", (unsigned long long)*expected, found ? "ok" : "MISMATCH");
+    }
+
+    return all_identical;
+}
+
+// Thread counts 1, 2, 4, ... up to max_threads (always included). One thread is the plain anchored scan, no pool.
+bool bench_threads(const Image& image, const AnchoredPattern& anchored, size_t iterations, size_t max_threads) {
+    std::vector<size_t> counts{};
+
+    for (size_t n = 1; n < max_threads; n *= 2) {
+        counts.push_back(n);
+    }
+
+    counts.push_back(max_threads);
+
+    std::vector<uintptr_t> reference{};
+    const auto baseline = measure(image, iterations, reference, [&](std::vector<uintptr_t>& out) {
+        find_all(image.data.data(), image.data.size(), anchored, out);
+    });
+
+    const auto first = reference.empty() ? std::nullopt : std::optional<uintptr_t>{reference.front()};
+    bool all_identical = true;
+
+    std::printf("  threads,find_all_gbps,find_all_speedup,find_first_gbps,identical\n");
+
+    for (const auto threads : counts) {
+        // The calling thread takes part in the scan too
+        std::optional<WorkPool> pool{};
+
+        if (threads > 1) {
+            pool.emplace(threads - 1);
+        }
+
+        std::vector<uintptr_t> matches{};
+        const auto all = measure(image, iterations, matches, [&](std::vector<uintptr_t>& out) {
+            if (pool) {
+                parallel_find_all(*pool, image.data.data(), image.data.size(), anchored, out);
+            } else {
+                find_all(image.data.data(), image.data.size(), anchored, out);
+            }
+        });
+
+        std::optional<uintptr_t> found{};
+        std::vector<uintptr_t> unused{};
+        const auto first_gbps = measure(image, iterations, unused, [&](std::vector<uintptr_t>&) {
+            found = pool ? parallel_find_first(*pool, image.data.data(), image.data.size(), anchored) : find_first(image.data.data(), image.data.size(), anchored);
+        });
+
+        const auto identical = matches == reference && found == first;
+        all_identical &= identical;
+
+        std::printf("  %zu,%.2f,%.2f,%.2f,%s\n", threads, all, all / baseline, first_gbps, identical ? "yes" : "MISMATCH");
+    }
+
+    return all_identical;
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> files{};
+    std::vector<size_t> sizes_mib{};
+    std::string pattern_str{DEFAULT_PATTERN};
+    size_t iterations = 3;
+    std::optional<std::string> manifest_path{};
+    std::optional<std::string> expected_name{};
+    size_t max_threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--file" && i + 1 < argc) {
+            files.push_back(argv[++i]);
+        } else if (arg == "--size" && i + 1 < argc) {
+            sizes_mib.push_back(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--pattern" && i + 1 < argc) {
+            pattern_str = argv[++i];
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (arg == "--expect" && i + 1 < argc) {
+            expected_name = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            max_threads = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "usage: %s [--file <path>]... [--size <MiB>]... [--pattern \"<ida>\"] [--iterations <n>] [--manifest <path> [--expect <name>]] [--threads <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const auto pattern = Pattern::parse(pattern_str);
+
+    if (!pattern) {
+        std::fprintf(stderr, "Failed to parse pattern \"%s\"\n", pattern_str.c_str());
+        return 1;
+    }
+
+    // The manifest only describes the files, the synthetic images have their own planted matches
+    std::optional<uint64_t> expected{};
+
+    if (manifest_path) {
+        const auto truth = GroundTruth::load(*manifest_path);
+
+        if (!expected_name && pattern_str == DEFAULT_PATTERN) {
+            expected_name = DEFAULT_EXPECTED;
+        }
+
+        if (!truth || !expected_name || !(expected = truth->get(*expected_name))) {
+            std::fprintf(stderr, "No expected match for \"%s\" in %s\n", expected_name ? expected_name->c_str() : pattern_str.c_str(), manifest_path->c_str());
+            return 1;
+        }
+    }
+
+    if (files.empty() && sizes_mib.empty()) {
+        sizes_mib = {256, 1024};
+    }
+
+    const auto compiled = simd::CompiledPattern::compile(*pattern);
+    const AnchoredPattern anchored{pattern->bytes.data(), pattern->mask.data(), pattern->size(), pattern->rarest_fixed_byte()};
+    bool ok = true;
+
+    std::printf("Detected ISA: %s\n", simd::to_string(simd::get_isa()));
+
+    if (anchored.anchor < anchored.size) {
+        std::printf("Anchor: %02X at offset %zu\n", anchored.bytes[anchored.anchor], anchored.anchor);
+    }
+
+    for (const auto& path : files) {
+        const auto image = load_file(path);
+
+        if (!image) {
+            std::fprintf(stderr, "Failed to read %s\n", path.c_str());
+            ok = false;
+            continue;
+        }
+
+        ok &= bench(*image, compiled, anchored, iterations, expected);
+
+        if (max_threads != 0) {
+            ok &= bench_threads(*image, anchored, iterations, max_threads);
+        }
+    }
+
+    for (const auto size : sizes_mib) {
+        Image image{};
+        image.name = "synthetic " + std::to_string(size) + " MiB";
+        image.data = make_synthetic_image(size * 1024 * 1024, (uint32_t)size);
+        plant(image.data, *pattern, PLANTED_MATCHES, (uint32_t)size + 1);
+
+        ok &= bench(image, compiled, anchored, iterations, std::nullopt);
+
+        if (max_threads != 0) {
+            ok &= bench_threads(image, anchored, iterations, max_threads);
+        }
+    }
+
+    return ok ? 0 : 1;
+}
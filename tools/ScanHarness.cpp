@@ -0,0 +1,382 @@
+// Offline hook resolution.
+// Maps a game executable from disk and runs the same GameResolver the plugin uses on it,
+// printing the RVA of every target and how long each step took. Exits with 1 if anything failed to resolve.
+//
+// > scan_harness ff7rebirth_.exe
+// > scan_harness ff7rebirth_.exe --verbose
+// > scan_harness ff7rebirth_.exe --class FScene --class FSceneRenderer   (also dump what RTTI knows about these)
+// > scan_harness ff7rebirth_old.exe --cache hints.bin && scan_harness ff7rebirth_.exe --cache hints.bin
+//   (the second run starts looking where the first one found things, like the plugin after a game update)
+// > corpus_gen corpus.exe && scan_harness corpus.exe --manifest corpus.exe.manifest
+//   (every result is also compared against what corpus_gen planted, a mismatch counts as a failure)
+// > scan_harness ff7rebirth_.exe --reload
+//   (publishes the results to shared memory and resolves again from there, like the plugin after a hot reload)
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <analysis/GameResolver.hpp>
+#include <analysis/GroundTruth.hpp>
+#include <analysis/MappedImage.hpp>
+#include <analysis/Pe.hpp>
+#include <analysis/ScanCache.hpp>
+#include <analysis/ScanRegion.hpp>
+#include <analysis/SharedScanState.hpp>
+
+using namespace analysis;
+
+namespace {
+class Harness {
+public:
+    // With shared, this is the run after a hot reload: addresses come straight from cache like in the plugin.
+    Harness(const MappedImage& image, std::vector<std::string> classes, ScanCache* cache, const GroundTruth* truth, const SharedScanState* shared = nullptr)
+        : m_image{image},
+        m_resolver{image.get_base(), cache, shared},
+        m_classes{std::move(classes)},
+        m_cache{cache},
+        m_truth{truth},
+        m_shared{shared}
+    {
+    }
+
+    bool run() {
+        // Built up front so the timings below are just the lookups.
+        // Not with a cache though, the signatures with hints are supposed to get away without it.
+        if (m_cache == nullptr) {
+            build("MultiScanner", [&]() { return m_resolver.get_signatures().get_bytes_scanned(); });
+        }
+
+        build("XrefIndex", [&]() { return m_resolver.get_xrefs().get_bytes_scanned(); });
+        build("StringIndex", [&]() { return m_resolver.get_strings().get_bytes_scanned(); });
+        build("FunctionTable", [&]() { return m_resolver.get_functions().size() * sizeof(pe::RuntimeFunction); });
+        build("RttiIndex", [&]() { return m_resolver.get_rtti().get_bytes_scanned(); });
+
+        std::printf("  %-48s %zu classes, %zu vtables\n", "RTTI", m_resolver.get_rtti().size(), m_resolver.get_rtti().get_vtable_count());
+
+        for (const auto& name : m_classes) {
+            print_class(name);
+        }
+
+        const auto frame_number = step("GFrameNumberRenderThread", [&]() { return m_resolver.find_frame_number_increment(); });
+
+        if (frame_number) {
+            print("GFrameNumberRenderThread.global", GameResolver::calculate_absolute(*frame_number + 2));
+        }
+
+        step("FEndMenuRenderer::OnRenderCompositeLayerEx", [&]() { return m_resolver.find_render_composite_layer(); });
+        step("FPostProcessSettings::FPostProcessSettings", [&]() { return m_resolver.find_post_process_settings(); });
+        step("MotionBlurIntermediate.jmp", [&]() { return m_resolver.find_motion_blur_jcc(); });
+
+        std::optional<GameResolver::StartFrame> startframe{};
+        step("FScene::StartFrame", [&]() -> std::optional<uintptr_t> {
+            startframe = m_resolver.find_startframe();
+            return startframe ? std::optional<uintptr_t>{startframe->fn} : std::nullopt;
+        });
+
+        if (!startframe && m_shared != nullptr) {
+            startframe = load_startframe();
+        } else if (startframe && m_cache != nullptr) {
+            const auto base = m_image.get_base();
+            m_cache->set_value(base, "FScene::StartFrame.vtable", startframe->vtable - base);
+            m_cache->set_value(base, "FScene::FrameCount.offset", startframe->frame_count_offset);
+
+            if (startframe->velocity_data_offset) {
+                m_cache->set_value(base, "FScene::VelocityData.offset", *startframe->velocity_data_offset);
+            }
+        }
+
+        if (startframe) {
+            print("FScene::StartFrame.vtable", startframe->vtable);
+            print_offset("FScene::FrameCount.offset", startframe->frame_count_offset);
+
+            if (startframe->velocity_data_offset) {
+                print_offset("FScene::VelocityData.offset", *startframe->velocity_data_offset);
+            } else {
+                std::printf("  %-48s FAILED\n", "FScene::VelocityData.offset");
+                m_ok = false;
+            }
+        }
+
+        const auto update_transform = step("FVelocityData::UpdateTransform", [&]() { return m_resolver.find_update_transform(); });
+
+        if (update_transform) {
+            step("FScene::UpdateAllPrimitiveSceneInfos", [&]() { return m_resolver.find_update_all_primitive_scene_infos(*update_transform); });
+        }
+
+        for (const auto& hint : m_resolver.get_hint_results()) {
+            std::printf("  %-48s 0x%08x -> 0x%08x  %9.3fms  %s\n",
+                (hint.name + " hint").c_str(),
+                hint.hint,
+                hint.rva,
+                std::chrono::duration<double, std::milli>(hint.elapsed).count(),
+                to_string(hint.window));
+        }
+
+        const auto disasm = m_resolver.get_instructions().get_stats();
+        std::printf("Disassembly: %zu instruction(s) decoded in %.3fms, %zu served from cache (~%.3fms saved)\n",
+            disasm.decoded,
+            std::chrono::duration<double, std::milli>(disasm.decode_time).count(),
+            disasm.served,
+            std::chrono::duration<double, std::milli>(disasm.get_time_saved()).count());
+        std::printf("Total: %.3fms\n", m_total_ms);
+
+        if (m_truth != nullptr) {
+            std::printf("Ground truth: %zu/%zu matched\n", m_matched, m_checked);
+        }
+
+        return m_ok;
+    }
+
+    GameResolver& get_resolver() {
+        return m_resolver;
+    }
+
+private:
+    // fn returns the number of bytes it had to read, which gets compared against the whole image.
+    template <typename T>
+    void build(std::string_view name, T&& fn) {
+        const ScanMeter meter{};
+        const auto bytes_scanned = fn();
+        const auto stats = meter.stop(bytes_scanned);
+        const auto elapsed = std::chrono::duration<double, std::milli>(stats.elapsed).count();
+
+        m_total_ms += elapsed;
+        std::printf("  %-48s %-10s  %9.3fms  %8.1f of %.1f MiB  %6llu faults\n",
+            std::string{name}.c_str(),
+            "built",
+            elapsed,
+            bytes_scanned / (1024.0 * 1024.0),
+            m_image.get_size() / (1024.0 * 1024.0),
+            (unsigned long long)stats.page_faults);
+    }
+
+    template <typename T>
+    std::optional<uintptr_t> step(std::string_view name, T&& fn) {
+        const ScanMeter meter{};
+        auto result = m_shared != nullptr ? m_cache->get_address(m_image.get_base(), name) : std::nullopt;
+
+        if (!result) {
+            result = fn();
+        }
+
+        const auto stats = meter.stop(0);
+        const auto elapsed = std::chrono::duration<double, std::milli>(stats.elapsed).count();
+
+        m_total_ms += elapsed;
+
+        if (result && m_cache != nullptr) {
+            m_cache->set_address(m_image.get_base(), name, *result);
+        }
+
+        if (result) {
+            const auto rva = *result - m_image.get_base();
+            std::printf("  %-48s 0x%08llx  %9.3fms  %24s  %6llu faults%s\n", std::string{name}.c_str(), (unsigned long long)rva, elapsed, "", (unsigned long long)stats.page_faults, check(name, rva).c_str());
+        } else {
+            std::printf("  %-48s %-10s  %9.3fms  %24s  %6llu faults%s\n", std::string{name}.c_str(), "FAILED", elapsed, "", (unsigned long long)stats.page_faults, check(name, std::nullopt).c_str());
+            m_ok = false;
+        }
+
+        return result;
+    }
+
+    // The plugin's load_startframe_from_cache.
+    std::optional<GameResolver::StartFrame> load_startframe() {
+        const auto base = m_image.get_base();
+        const auto fn = m_cache->get_address(base, "FScene::StartFrame");
+        const auto vtable = m_cache->get_value(base, "FScene::StartFrame.vtable");
+        const auto frame_count_offset = m_cache->get_value(base, "FScene::FrameCount.offset");
+
+        if (!fn || !vtable || !frame_count_offset) {
+            return std::nullopt;
+        }
+
+        GameResolver::StartFrame result{*fn, base + *vtable, (uint32_t)*frame_count_offset};
+
+        if (const auto velocity_data_offset = m_cache->get_value(base, "FScene::VelocityData.offset")) {
+            result.velocity_data_offset = (uint32_t)*velocity_data_offset;
+        }
+
+        return result;
+    }
+
+    void print_class(const std::string& name) {
+        const auto cls = m_resolver.get_rtti().find(name);
+
+        if (cls == nullptr) {
+            std::printf("  %-48s FAILED\n", name.c_str());
+            m_ok = false;
+            return;
+        }
+
+        for (const auto& vtable : cls->vtables) {
+            std::printf("  %-48s 0x%08x  offset 0x%x, %u slot(s)\n", (name + " vtable").c_str(), vtable.rva, vtable.offset, vtable.size);
+        }
+
+        for (const auto& base : cls->bases) {
+            std::printf("  %-48s %s\n", (name + " base").c_str(), base.c_str());
+        }
+    }
+
+    void print(std::string_view name, uintptr_t addr) {
+        const auto rva = addr - m_image.get_base();
+        std::printf("  %-48s 0x%08llx%s\n", std::string{name}.c_str(), (unsigned long long)rva, check(name, rva).c_str());
+    }
+
+    void print_offset(std::string_view name, uint32_t offset) {
+        std::printf("  %-48s 0x%x%s\n", std::string{name}.c_str(), offset, check(name, offset).c_str());
+    }
+
+    // Suffix for the line printed for name, empty without a manifest or if the manifest doesn't know name.
+    std::string check(std::string_view name, std::optional<uint64_t> value) {
+        if (m_truth == nullptr) {
+            return {};
+        }
+
+        const auto expected = m_truth->get(name);
+
+        if (!expected) {
+            return {};
+        }
+
+        ++m_checked;
+
+        if (value == expected) {
+            ++m_matched;
+            return "  ok";
+        }
+
+        m_ok = false;
+
+        char buffer[64]{};
+        std::snprintf(buffer, sizeof(buffer), "  MISMATCH (expected 0x%llx)", (unsigned long long)*expected);
+        return buffer;
+    }
+
+    const MappedImage& m_image;
+    GameResolver m_resolver;
+    std::vector<std::string> m_classes{};
+    ScanCache* m_cache{nullptr};
+    const GroundTruth* m_truth{nullptr};
+    const SharedScanState* m_shared{nullptr};
+    size_t m_checked{0};
+    size_t m_matched{0};
+    double m_total_ms{0.0};
+    bool m_ok{true};
+};
+}
+
+int main(int argc, char** argv) {
+    std::optional<std::string> path{};
+    std::vector<std::string> classes{};
+    std::optional<std::string> cache_path{};
+    std::optional<std::string> manifest_path{};
+    bool verbose = false;
+    bool reload = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--reload") {
+            reload = true;
+        } else if (arg == "--class" && i + 1 < argc) {
+            classes.push_back(argv[++i]);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (!path && !arg.starts_with("--")) {
+            path = argv[i];
+        } else {
+            path.reset();
+            break;
+        }
+    }
+
+    if (!path) {
+        std::fprintf(stderr, "usage: %s <game.exe> [--verbose] [--class <name>]... [--cache <path>] [--manifest <path>] [--reload]\n", argv[0]);
+        return 1;
+    }
+
+    spdlog::set_level(verbose ? spdlog::level::info : spdlog::level::warn);
+
+    std::optional<GroundTruth> truth{};
+
+    if (manifest_path) {
+        truth = GroundTruth::load(*manifest_path);
+
+        if (!truth) {
+            return 1;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto image = MappedImage::load(*path);
+
+    if (image == nullptr) {
+        return 1;
+    }
+
+    const auto map_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%s (%.1f MiB on disk, %.1f MiB mapped, preferred base 0x%llx) mapped in %.3fms\n",
+        path->c_str(),
+        image->get_file_size() / (1024.0 * 1024.0),
+        image->get_size() / (1024.0 * 1024.0),
+        (unsigned long long)image->get_preferred_base(),
+        map_ms);
+
+    ScanCache cache{};
+
+    if (cache_path) {
+        cache.load(*cache_path);
+    }
+
+    // The reload needs somewhere to take the addresses from, even without a cache file
+    Harness harness{*image, std::move(classes), cache_path || reload ? &cache : nullptr, truth ? &*truth : nullptr};
+    auto ok = harness.run();
+
+    if (reload) {
+        auto blobs = harness.get_resolver().serialize_indexes();
+        blobs.push_back({"ScanCache", cache.serialize_modules()});
+
+        const auto publish_start = std::chrono::steady_clock::now();
+        const auto published = SharedScanState::publish(image->get_base(), blobs);
+        const auto publish_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - publish_start).count();
+
+        const auto attach_start = std::chrono::steady_clock::now();
+        const auto shared = published ? SharedScanState::attach(image->get_base()) : nullptr;
+        ScanCache reloaded_cache{};
+        const auto modules = shared != nullptr ? shared->get("ScanCache") : std::nullopt;
+        const auto attached = modules && reloaded_cache.merge_modules(*modules);
+        const auto attach_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - attach_start).count();
+
+        std::printf("Reload: published %.1f MiB in %.3fms, attached in %.3fms%s\n",
+            shared != nullptr ? shared->get_size() / (1024.0 * 1024.0) : 0.0,
+            publish_ms,
+            attach_ms,
+            attached ? "" : ", FAILED");
+
+        if (attached) {
+            Harness reloaded{*image, {}, &reloaded_cache, truth ? &*truth : nullptr, shared.get()};
+            ok &= reloaded.run();
+        } else {
+            ok = false;
+        }
+
+        SharedScanState::remove();
+    }
+
+    if (cache_path && cache.is_dirty()) {
+        cache.save(*cache_path);
+    }
+
+    return ok ? 0 : 1;
+}
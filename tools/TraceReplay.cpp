@@ -0,0 +1,656 @@
+// Replays hook traces recorded with FF7PLUGIN_TRACE=1 (see HookTrace.hpp) through the plugin's hook logic, against stub originals.
+// CopyDescriptors calls go through filter_copy_descriptors with a descriptor heap index rebuilt from the trace's heap records,
+// and in a second mode through the range coalescing too. The velocity hooks go through the ghosting fix decisions.
+// Reports what every filter decided and how fast the whole trace replays, best of a few passes.
+// Records are replayed frame by frame, and within a frame in the order their blocks got written.
+// Faults can't be replayed, so nothing ever gets rejected for having faulted before.
+//
+// Without a trace, records a synthetic one from a few threads first (into the temp dir) and checks that it reads back
+// exactly as it was recorded, then replays that.
+//
+// > analysis_tests trace_replay
+// > analysis_tests trace_replay ff7rebirth_hooks.trace --passes 5
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <analysis/CopyDescriptorsFilter.hpp>
+#include <analysis/DescriptorCoalesce.hpp>
+#include <analysis/GhostingFix.hpp>
+#include <analysis/HookTrace.hpp>
+
+#include "Checks.hpp"
+
+using namespace analysis;
+
+namespace {
+constexpr uint32_t NUM_HEAP_TYPES = 4;          // D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES
+constexpr uint32_t MAX_COALESCED_RANGES = 64;   // same as the plugin's on-stack buffers
+
+// Stub originals. The CopyDescriptors one walks its ranges like the driver would, so fewer ranges cost less.
+size_t g_descriptors_copied{0};
+size_t g_original_calls{0};
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void stub_copy_descriptors(uint32_t num_dest, const uint64_t*, const uint32_t* dest_sizes, uint32_t, const uint64_t*, const uint32_t*) {
+    for (uint32_t i = 0; i < num_dest; ++i) {
+        g_descriptors_copied += dest_sizes != nullptr ? dest_sizes[i] : 1;
+    }
+}
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void stub_original() {
+    ++g_original_calls;
+}
+
+struct Decisions {
+    size_t heaps_created{};
+    size_t heaps_released{};
+
+    size_t copy_calls{};
+    size_t forwarded{};
+    size_t null_handle{};
+    std::array<size_t, 7> invalid{}; // by DescriptorCheck
+    size_t coalesced{};
+    size_t ranges_before{};
+    size_t ranges_after{};
+
+    size_t start_frame_calls{};
+    size_t start_frame_run{};
+    size_t update_transform_calls{};
+    size_t update_transform_run{};
+    size_t primitive_calls{};
+};
+
+// One pass over the whole trace, the way the plugin's detours would have handled it
+Decisions replay(const std::vector<TraceRecord>& records, bool coalesce) {
+    Decisions d{};
+    DescriptorHeapIndex heaps{};
+    std::array<uint32_t, NUM_HEAP_TYPES> increments{};
+    const auto find_null = simd::get_find_null_handle();
+
+    uint64_t dest_starts[MAX_COALESCED_RANGES];
+    uint32_t dest_sizes[MAX_COALESCED_RANGES];
+    uint64_t src_starts[MAX_COALESCED_RANGES];
+    uint32_t src_sizes[MAX_COALESCED_RANGES];
+
+    for (const auto& r : records) {
+        switch (r.type) {
+        case TraceRecordType::DESCRIPTOR_HEAP_CREATED: {
+            DescriptorHeapRange range{};
+            range.base = r.heap_base;
+            range.count = r.heap_count;
+            range.increment = r.heap_increment;
+            range.type = r.heap_type;
+            range.heap = (const void*)r.self;
+
+            heaps.add(range);
+
+            if (r.heap_type < NUM_HEAP_TYPES) {
+                increments[r.heap_type] = r.heap_increment;
+            }
+
+            ++d.heaps_created;
+            break;
+        }
+
+        case TraceRecordType::DESCRIPTOR_HEAP_RELEASED:
+            heaps.remove((const void*)r.self);
+            ++d.heaps_released;
+            break;
+
+        case TraceRecordType::COPY_DESCRIPTORS: {
+            const auto dest = r.has_dest_starts ? r.dest_starts.data() : nullptr;
+            const auto dest_size = r.dest_sizes.empty() ? nullptr : r.dest_sizes.data();
+            const auto src = r.has_src_starts ? r.src_starts.data() : nullptr;
+            const auto src_size = r.src_sizes.empty() ? nullptr : r.src_sizes.data();
+
+            ++d.copy_calls;
+            d.ranges_before += r.num_dest + r.num_src;
+
+            const auto decision = filter_copy_descriptors(find_null, heaps, r.num_dest, dest, dest_size, r.num_src, src, src_size, r.heap_type);
+
+            if (decision.verdict == CopyDescriptorsVerdict::NULL_HANDLE) {
+                ++d.null_handle;
+                break;
+            }
+
+            if (decision.verdict == CopyDescriptorsVerdict::INVALID_RANGE) {
+                ++d.invalid[(size_t)decision.check.result];
+                break;
+            }
+
+            ++d.forwarded;
+
+            if (coalesce) {
+                const auto increment = r.heap_type < NUM_HEAP_TYPES ? increments[r.heap_type] : 0;
+                CoalescedRanges merged_dest{dest_starts, dest_sizes, MAX_COALESCED_RANGES};
+                CoalescedRanges merged_src{src_starts, src_sizes, MAX_COALESCED_RANGES};
+
+                if (coalesce_copy_descriptors(r.num_dest, dest, dest_size, r.num_src, src, src_size, increment, merged_dest, merged_src)) {
+                    ++d.coalesced;
+                    d.ranges_after += merged_dest.count + merged_src.count;
+                    stub_copy_descriptors(merged_dest.count, dest_starts, dest_sizes, merged_src.count, src_starts, src_sizes);
+                    break;
+                }
+            }
+
+            d.ranges_after += r.num_dest + r.num_src;
+            stub_copy_descriptors(r.num_dest, dest, dest_size, r.num_src, src, src_size);
+            break;
+        }
+
+        case TraceRecordType::START_FRAME:
+            ++d.start_frame_calls;
+
+            if (should_start_frame(r.frame.state, r.frame.number)) {
+                ++d.start_frame_run;
+                stub_original();
+            }
+
+            break;
+
+        case TraceRecordType::UPDATE_TRANSFORM:
+            ++d.update_transform_calls;
+
+            if (should_update_transform(r.frame.state, r.frame.number)) {
+                ++d.update_transform_run;
+                stub_original();
+            }
+
+            break;
+
+        case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+            // Always goes through for now
+            ++d.primitive_calls;
+            stub_original();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return d;
+}
+
+// What the same records would take up as plain structs, to compare the encoding against
+size_t get_raw_size(const TraceRecord& r) {
+    switch (r.type) {
+    case TraceRecordType::COPY_DESCRIPTORS:
+        return 8 + 3 * 4 + r.dest_starts.size() * 8 + r.dest_sizes.size() * 4 + r.src_starts.size() * 8 + r.src_sizes.size() * 4;
+    case TraceRecordType::START_FRAME:
+    case TraceRecordType::UPDATE_TRANSFORM:
+        return 4 * 8;
+    case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+        return 4 * 8 + 2 * 4;
+    case TraceRecordType::DESCRIPTOR_HEAP_CREATED:
+        return 2 * 8 + 3 * 4;
+    case TraceRecordType::DESCRIPTOR_HEAP_RELEASED:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+bool load(const std::filesystem::path& path, std::vector<TraceRecord>& records) {
+    TraceReader reader{path};
+
+    if (!reader.is_open()) {
+        std::fprintf(stderr, "%s: not a trace (or not this version of one)\n", path.string().c_str());
+        return false;
+    }
+
+    TraceRecord record{};
+    size_t raw_size = 0;
+    std::map<uint32_t, size_t> threads{};
+
+    while (reader.next(record)) {
+        raw_size += get_raw_size(record);
+        ++threads[record.thread];
+        records.push_back(record);
+    }
+
+    if (reader.is_corrupt()) {
+        std::fprintf(stderr, "%s: corrupt after %zu record(s), replaying those\n", path.string().c_str(), records.size());
+    }
+
+    // Blocks of different threads only line up per frame
+    std::stable_sort(records.begin(), records.end(), [](const TraceRecord& a, const TraceRecord& b) {
+        return a.frame.number < b.frame.number;
+    });
+
+    const auto file_size = (size_t)std::filesystem::file_size(path);
+
+    std::printf("%s: %zu record(s) from %zu thread(s) in %zu block(s), %zu bytes, %.2f bytes/record, %.1fx smaller than raw\n",
+        path.string().c_str(), records.size(), threads.size(), reader.get_blocks(), file_size,
+        records.empty() ? 0.0 : (double)file_size / records.size(), file_size == 0 ? 0.0 : (double)raw_size / file_size);
+
+    return true;
+}
+
+void report_calls(const std::vector<TraceRecord>& records) {
+    struct PerFrame {
+        size_t total{};
+        size_t max{};
+    };
+
+    std::map<TraceRecordType, PerFrame> calls{};
+    std::map<TraceRecordType, size_t> current{};
+    size_t frames = 0;
+
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (i == 0 || records[i].frame.number != records[i - 1].frame.number) {
+            ++frames;
+            current.clear();
+        }
+
+        auto& c = calls[records[i].type];
+        ++c.total;
+        c.max = std::max(c.max, ++current[records[i].type]);
+    }
+
+    std::printf("%zu frame(s)\n", frames);
+
+    for (const auto& [type, c] : calls) {
+        std::printf("  %-56s %10zu call(s), %8.1f/frame, max %zu\n", to_string(type), c.total, (double)c.total / std::max<size_t>(frames, 1), c.max);
+    }
+}
+
+void report_decisions(const Decisions& d) {
+    const auto percent = [](size_t n, size_t total) {
+        return total == 0 ? 0.0 : 100.0 * n / total;
+    };
+
+    std::printf("CopyDescriptors: %zu forwarded (%.2f%%), %zu null handle(s)", d.forwarded, percent(d.forwarded, d.copy_calls), d.null_handle);
+
+    for (size_t i = 0; i < d.invalid.size(); ++i) {
+        if (d.invalid[i] != 0) {
+            std::printf(", %zu %s", d.invalid[i], to_string((DescriptorCheck)i));
+        }
+    }
+
+    std::printf("\n");
+    std::printf("  coalescing: %zu call(s) merged, %zu -> %zu range(s) (%.1f%% fewer)\n",
+        d.coalesced, d.ranges_before, d.ranges_after, 100.0 - percent(d.ranges_after, d.ranges_before));
+    std::printf("  descriptor heaps: %zu created, %zu released\n", d.heaps_created, d.heaps_released);
+    std::printf("StartFrame: %zu of %zu ran\n", d.start_frame_run, d.start_frame_calls);
+    std::printf("UpdateTransform: %zu of %zu ran\n", d.update_transform_run, d.update_transform_calls);
+    std::printf("GetPrimitiveUniformShaderParameters_RenderThread: %zu ran\n", d.primitive_calls);
+}
+
+void bench(const std::vector<TraceRecord>& records, size_t passes) {
+    for (const auto coalesce : {false, true}) {
+        double best = 1e30;
+        Decisions d{};
+
+        for (size_t pass = 0; pass < passes; ++pass) {
+            const auto start = std::chrono::steady_clock::now();
+            d = replay(records, coalesce);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::printf("%-22s %8.2f M records/s, %7.1f ns/record\n", coalesce ? "filters + coalescing:" : "filters:",
+            records.size() / best / 1e6, best * 1e9 / std::max<size_t>(records.size(), 1));
+
+        if (coalesce) {
+            report_decisions(d);
+        }
+    }
+}
+
+// Synthetic trace
+
+bool same(const TraceRecord& a, const TraceRecord& b) {
+    if (a.type != b.type || a.self != b.self) {
+        return false;
+    }
+
+    switch (a.type) {
+    case TraceRecordType::COPY_DESCRIPTORS:
+        return a.num_dest == b.num_dest && a.num_src == b.num_src && a.heap_type == b.heap_type &&
+            a.has_dest_starts == b.has_dest_starts && a.has_src_starts == b.has_src_starts &&
+            a.dest_starts == b.dest_starts && a.dest_sizes == b.dest_sizes && a.src_starts == b.src_starts && a.src_sizes == b.src_sizes;
+    case TraceRecordType::START_FRAME:
+    case TraceRecordType::UPDATE_TRANSFORM:
+        return a.frame == b.frame && std::equal(std::begin(a.args), std::end(a.args), std::begin(b.args));
+    case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+        return a.frame == b.frame && std::equal(std::begin(a.args), std::end(a.args), std::begin(b.args)) &&
+            a.primitive_id == b.primitive_id && a.scene_frame_count == b.scene_frame_count;
+    case TraceRecordType::DESCRIPTOR_HEAP_CREATED:
+        return a.heap_base == b.heap_base && a.heap_count == b.heap_count && a.heap_increment == b.heap_increment && a.heap_type == b.heap_type;
+    default:
+        return true;
+    }
+}
+
+void record(TraceRecorder& recorder, const TraceRecord& r) {
+    const auto p = [](uint64_t v) { return (const void*)v; };
+
+    switch (r.type) {
+    case TraceRecordType::COPY_DESCRIPTORS:
+        recorder.record_copy_descriptors(p(r.self),
+            r.num_dest, r.has_dest_starts ? r.dest_starts.data() : nullptr, r.dest_sizes.empty() ? nullptr : r.dest_sizes.data(),
+            r.num_src, r.has_src_starts ? r.src_starts.data() : nullptr, r.src_sizes.empty() ? nullptr : r.src_sizes.data(), r.heap_type);
+        break;
+    case TraceRecordType::START_FRAME:
+        recorder.record_start_frame(r.frame, p(r.self), p(r.args[0]), p(r.args[1]), p(r.args[2]));
+        break;
+    case TraceRecordType::UPDATE_TRANSFORM:
+        recorder.record_update_transform(r.frame, p(r.self), p(r.args[0]), p(r.args[1]), p(r.args[2]));
+        break;
+    case TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS:
+        recorder.record_primitive_uniform_shader_parameters(r.frame, p(r.self), p(r.args[0]), p(r.args[1]), p(r.args[2]), r.primitive_id, r.scene_frame_count);
+        break;
+    case TraceRecordType::DESCRIPTOR_HEAP_CREATED: {
+        DescriptorHeapRange range{};
+        range.base = r.heap_base;
+        range.count = r.heap_count;
+        range.increment = r.heap_increment;
+        range.type = r.heap_type;
+        range.heap = p(r.self);
+        recorder.record_descriptor_heap_created(range);
+        break;
+    }
+    case TraceRecordType::DESCRIPTOR_HEAP_RELEASED:
+        recorder.record_descriptor_heap_released(p(r.self));
+        break;
+    default:
+        break;
+    }
+}
+
+constexpr uint64_t HEAP_BASE = 0x7FF000000000;
+constexpr uint64_t HEAP_STRIDE = 0x100000;
+constexpr uint32_t HEAP_COUNT = 4096;
+constexpr uint32_t INCREMENT = 32;
+constexpr size_t NUM_HEAPS = 8;
+
+// What a render thread does: heaps first, then per frame StartFrame, a burst of UpdateTransform and
+// GetPrimitiveUniformShaderParameters calls, and every now and then a heap getting destroyed and recreated
+std::vector<TraceRecord> make_render_thread(size_t frames) {
+    std::mt19937_64 rng{1};
+    std::vector<TraceRecord> out{};
+    const uint64_t scene = 0x2A0'0000'1000;
+    const GhostingFixState state{true, false, true};
+
+    const auto heap = [&](size_t k, bool created) {
+        TraceRecord r{};
+        r.type = created ? TraceRecordType::DESCRIPTOR_HEAP_CREATED : TraceRecordType::DESCRIPTOR_HEAP_RELEASED;
+        r.self = 0x1F0'0000'0000 + k * 0x100;
+        r.heap_base = HEAP_BASE + k * HEAP_STRIDE;
+        r.heap_count = HEAP_COUNT;
+        r.heap_increment = INCREMENT;
+        r.heap_type = (uint32_t)(k % 2);
+        out.push_back(r);
+    };
+
+    for (size_t k = 0; k < NUM_HEAPS; ++k) {
+        heap(k, true);
+    }
+
+    for (uint32_t frame = 1; frame <= frames; ++frame) {
+        TraceRecord r{};
+        r.frame = {frame, state};
+        r.type = TraceRecordType::START_FRAME;
+        r.self = scene;
+        r.args[0] = 0x2A0'0000'8000;
+        out.push_back(r);
+
+        const auto primitives = 200 + rng() % 100;
+
+        for (size_t i = 0; i < primitives; ++i) {
+            r.type = TraceRecordType::UPDATE_TRANSFORM;
+            r.self = scene + 0x5A0;
+            r.args[0] = 0x300'0000'0000 + i * 0x40;
+            r.args[1] = 0x310'0000'0000 + (rng() % 4096) * 0x40;
+            out.push_back(r);
+
+            r.type = TraceRecordType::PRIMITIVE_UNIFORM_SHADER_PARAMETERS;
+            r.self = scene;
+            r.args[0] = 0x320'0000'0000 + i * 0x1C0;
+            r.args[1] = 0;
+            r.args[2] = 0x00E'0000'F000;
+            r.primitive_id = (uint32_t)i;
+            r.scene_frame_count = frame;
+            out.push_back(r);
+        }
+
+        if (frame % 50 == 0) {
+            const auto k = (size_t)(rng() % NUM_HEAPS);
+            heap(k, false);
+            heap(k, true);
+        }
+    }
+
+    return out;
+}
+
+// A driver thread's CopyDescriptors calls: mostly runs of adjacent single descriptors into some heap,
+// once in a while a null source handle or a destination range running past the end of its heap.
+// frame is the render thread's frame the call has to wait for before it gets recorded.
+std::vector<TraceRecord> make_copy_thread(size_t t, size_t calls) {
+    std::mt19937_64 rng{100 + t};
+    std::vector<TraceRecord> out{};
+
+    const auto make_side = [&](TraceRecord& r, bool source, uint32_t num, uint32_t type) {
+        auto& starts = source ? r.src_starts : r.dest_starts;
+        auto& sizes = source ? r.src_sizes : r.dest_sizes;
+        const auto k = (size_t)type + 2 * (rng() % (NUM_HEAPS / 2));
+        uint64_t slot = rng() % (HEAP_COUNT - 2 * num);
+
+        for (uint32_t i = 0; i < num; ++i) {
+            if (rng() % 4 == 0) {
+                slot = rng() % (HEAP_COUNT - 2 * num);
+            }
+
+            starts.push_back(HEAP_BASE + k * HEAP_STRIDE + slot * INCREMENT);
+            slot += 1;
+        }
+
+        if (!source && rng() % 2 == 0) {
+            sizes.assign(num, 1);
+        }
+    };
+
+    for (size_t n = 0; n < calls; ++n) {
+        TraceRecord r{};
+        const auto num = 1 + (uint32_t)(rng() % 24);
+
+        r.type = TraceRecordType::COPY_DESCRIPTORS;
+        r.self = 0xD3D'0000'0000 + t;
+        r.heap_type = (uint32_t)(rng() % 2);
+        r.num_dest = num;
+        r.num_src = num;
+        r.has_dest_starts = true;
+        r.has_src_starts = true;
+        make_side(r, false, num, r.heap_type);
+        make_side(r, true, num, r.heap_type);
+
+        if (rng() % 1000 == 0) {
+            r.src_starts[rng() % num] = 0;
+        } else if (rng() % 1000 == 0 && !r.dest_sizes.empty()) {
+            r.dest_sizes.back() = HEAP_COUNT;
+        }
+
+        // Keeps pace with the render thread, about 100 calls per frame
+        r.frame.number = 1 + (uint32_t)(n / 100);
+
+        out.push_back(std::move(r));
+    }
+
+    return out;
+}
+
+// Records every thread's records from a thread of its own, then reads the file back and compares per thread.
+bool record_synthetic(const std::filesystem::path& path, size_t frames, size_t copy_threads) {
+    std::vector<std::vector<TraceRecord>> expected{};
+    expected.push_back(make_render_thread(frames));
+
+    for (size_t t = 0; t < copy_threads; ++t) {
+        expected.push_back(make_copy_thread(t, frames * 100));
+    }
+
+    size_t records = 0, dropped = 0, bytes = 0;
+    double seconds = 0.0;
+
+    {
+        TraceRecorder recorder{path};
+
+        if (!recorder.is_open()) {
+            std::fprintf(stderr, "%s: couldn't be opened for writing\n", path.string().c_str());
+            return false;
+        }
+
+        std::vector<std::thread> threads{};
+        std::atomic<uint32_t> frame{0};
+        std::atomic<bool> stop{false};
+        const auto start = std::chrono::steady_clock::now();
+
+        // Polls like the plugin's drain timer does
+        std::thread ticker{[&]() {
+            while (!stop.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                recorder.poll();
+            }
+        }};
+
+        for (const auto& thread_records : expected) {
+            threads.emplace_back([&recorder, &thread_records, &frame]() {
+                for (const auto& r : thread_records) {
+                    if (r.type == TraceRecordType::START_FRAME) {
+                        frame.store(r.frame.number);
+                    } else if (r.type == TraceRecordType::COPY_DESCRIPTORS) {
+                        while (frame.load() < r.frame.number) {
+                            std::this_thread::yield();
+                        }
+                    }
+
+                    record(recorder, r);
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stop = true;
+        ticker.join();
+        recorder.flush();
+
+        records = recorder.get_records();
+        dropped = recorder.get_dropped();
+        bytes = recorder.get_bytes_written();
+    }
+
+    size_t total = 0;
+
+    for (const auto& thread_records : expected) {
+        total += thread_records.size();
+    }
+
+    std::printf("Recorded %zu call(s) from %zu thread(s) in %.1fms (%.1f ns/call), %zu record(s) incl. frames, %zu bytes, %zu dropped\n",
+        total, expected.size(), seconds * 1e3, seconds * 1e9 / total, records, bytes, dropped);
+
+    // Writer slots get handed out in whatever order the threads got to their first record, tell them apart by content
+    std::map<uint32_t, std::vector<TraceRecord>> read{};
+    TraceReader reader{path};
+    TraceRecord r{};
+
+    while (reader.next(r)) {
+        read[r.thread].push_back(r);
+    }
+
+    if (reader.is_corrupt() || !reader.is_open()) {
+        std::fprintf(stderr, "synthetic trace didn't read back\n");
+        return false;
+    }
+
+    bool ok = dropped == 0 && read.size() == expected.size();
+
+    for (const auto& [thread, got] : read) {
+        const auto it = std::find_if(expected.begin(), expected.end(), [&](const std::vector<TraceRecord>& e) {
+            return !e.empty() && !got.empty() && same(e.front(), got.front());
+        });
+
+        if (it == expected.end() || it->size() != got.size()) {
+            std::fprintf(stderr, "thread slot %u: %zu record(s) that don't match any thread\n", thread, got.size());
+            ok = false;
+            continue;
+        }
+
+        for (size_t i = 0; i < got.size(); ++i) {
+            if (!same((*it)[i], got[i])) {
+                std::fprintf(stderr, "thread slot %u: record %zu (%s) reads back differently\n", thread, i, to_string(got[i].type));
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    std::printf("Round trip: %s\n", ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+}
+
+int trace_replay_main(int argc, char** argv) {
+    std::vector<std::filesystem::path> paths{};
+    size_t passes = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--passes" && i + 1 < argc) {
+            passes = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg.starts_with("--")) {
+            std::fprintf(stderr, "usage: %s [trace...] [--passes <n>]\n", argv[0]);
+            return 1;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+
+    bool ok = true;
+
+    if (paths.empty()) {
+        const auto path = std::filesystem::temp_directory_path() / "trace_replay_synthetic.trace";
+
+        ok = record_synthetic(path, 600, 3);
+        paths.push_back(path);
+    }
+
+    for (const auto& path : paths) {
+        std::vector<TraceRecord> records{};
+
+        if (!load(path, records)) {
+            ok = false;
+            continue;
+        }
+
+        report_calls(records);
+        bench(records, passes);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+// Checks resolving a function through a COM vtable slot and its forwarding stubs, the way the plugin
+// finds CDevice::CopyDescriptors from the ID3D12Device. Everything is synthetic: a mock device whose
+// vtable points at a chain of thunks in front of the real function, placed at the end of a fake module
+// that is as large as asked for. Resolution has to land on the function without looking at the module,
+// so its cost stays the same no matter how big the module gets, unlike the scan it replaces.
+//
+// > analysis_tests vtable_resolve
+// > analysis_tests vtable_resolve --size 256 --iterations 1000000
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <analysis/AnchorScan.hpp>
+#include <analysis/JumpStub.hpp>
+#include <analysis/ScanRegion.hpp>
+#include <analysis/StaticPattern.hpp>
+
+#include "Checks.hpp"
+
+using namespace analysis;
+
+namespace {
+constexpr uint32_t COPY_DESCRIPTORS_INDEX = 23;
+constexpr StaticPattern COPY_DESCRIPTORS{"48 89 5C 24 08 57 48 83 ec 40 48 8b d9 8b bc 24 88 00 00 00"};
+
+// Module filled with int3 except for the function at the very end, the worst case for a scan
+struct FakeModule {
+    std::vector<uint8_t> code{};
+    uintptr_t fn{};
+    uintptr_t stubs{};
+
+    explicit FakeModule(size_t size)
+        : code(size, 0xCC)
+    {
+        fn = (uintptr_t)code.data() + size - 0x100;
+        std::memcpy((void*)fn, COPY_DESCRIPTORS.bytes.data(), COPY_DESCRIPTORS.size);
+
+        stubs = (uintptr_t)code.data() + 0x100;
+        auto p = (uint8_t*)stubs;
+
+        // Adjustor thunk: sub rcx, 8; jmp rel32 to the import style thunk below
+        const auto import_thunk = stubs + 0x40;
+        p[0] = 0x48; p[1] = 0x83; p[2] = 0xE9; p[3] = 0x08;
+        p[4] = 0xE9;
+        write<int32_t>(stubs + 5, (int32_t)(import_thunk - (stubs + 9)));
+
+        // jmp [rip+disp32] through a pointer to the absolute jump
+        const auto slot = stubs + 0x80;
+        const auto absolute = stubs + 0xC0;
+        p = (uint8_t*)import_thunk;
+        p[0] = 0xFF; p[1] = 0x25;
+        write<int32_t>(import_thunk + 2, (int32_t)(slot - (import_thunk + 6)));
+        write<uintptr_t>(slot, absolute);
+
+        // mov rax, imm64; jmp rax
+        p = (uint8_t*)absolute;
+        p[0] = 0x48; p[1] = 0xB8;
+        write<uintptr_t>(absolute + 2, fn);
+        p[10] = 0xFF; p[11] = 0xE0;
+    }
+
+    template <typename T>
+    static void write(uintptr_t addr, T value) {
+        std::memcpy((void*)addr, &value, sizeof(value));
+    }
+};
+
+// Stands in for the ID3D12Device, all that matters is the vtable pointer up front
+struct MockDevice {
+    const uintptr_t* vtable{};
+};
+
+struct Timing {
+    double ns_per_call{};
+    uint64_t page_faults{};
+};
+
+template <typename T>
+Timing measure(size_t iterations, T&& fn) {
+    const ScanMeter meter{};
+
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+
+    const auto stats = meter.stop(0);
+    return Timing{std::chrono::duration<double, std::nano>(stats.elapsed).count() / iterations, stats.page_faults};
+}
+
+bool check(const char* what, bool ok) {
+    std::printf("  %-52s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+}
+
+int vtable_resolve_main(int argc, char** argv) {
+    size_t max_size_mb = 64;
+    size_t iterations = 100000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "--size" && i + 1 < argc) {
+            max_size_mb = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::strtoull(argv[++i], nullptr, 0);
+        } else {
+            max_size_mb = 0;
+            break;
+        }
+    }
+
+    if (max_size_mb == 0 || iterations == 0) {
+        std::fprintf(stderr, "usage: %s [--size <max module MiB>] [--iterations <n>]\n", argv[0]);
+        return 1;
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+
+    bool ok = true;
+    double smallest_ns = 0.0;
+    double largest_ns = 0.0;
+
+    for (size_t size_mb = 1; size_mb <= max_size_mb; size_mb *= 4) {
+        const FakeModule module{size_mb * 1024 * 1024};
+
+        std::vector<uintptr_t> vtable(32, 0);
+        vtable[COPY_DESCRIPTORS_INDEX] = module.stubs;
+        const MockDevice device{vtable.data()};
+
+        const auto chain = resolve_virtual(&device, COPY_DESCRIPTORS_INDEX);
+
+        if (size_mb == 1) {
+            ok &= check("resolves through the stubs to the function", chain && chain->target == module.fn);
+            ok &= check("follows all three stubs", chain && chain->hops == 3);
+            ok &= check("picks up the adjustor thunk's this adjustment", chain && chain->this_adjustment == -8);
+            ok &= check("target matches the CopyDescriptors signature", chain && COPY_DESCRIPTORS.anchored().matches((const uint8_t*)chain->target));
+            ok &= check("a function that isn't a stub resolves to itself", follow_jumps(module.fn) && follow_jumps(module.fn)->hops == 0);
+
+            // jmp $ forever
+            const uint8_t self_loop[] = {0xEB, 0xFE};
+            ok &= check("a stub loop gives up instead of hanging", !follow_jumps((uintptr_t)self_loop));
+
+            const MockDevice empty{};
+            ok &= check("a device without a vtable fails cleanly", !resolve_virtual(&empty, COPY_DESCRIPTORS_INDEX));
+
+            std::printf("%10s  %14s  %12s  %14s  %12s\n", "module", "vtable ns/call", "vtable faults", "scan ns/call", "scan faults");
+        }
+
+        uintptr_t sink = 0;
+
+        const auto resolve = measure(iterations, [&]() {
+            sink += resolve_virtual(&device, COPY_DESCRIPTORS_INDEX)->target;
+        });
+
+        // The scan is many orders of magnitude slower, no need to run it as often
+        const auto scan_iterations = std::max<size_t>(1, iterations / 10000);
+        const auto scan = measure(scan_iterations, [&]() {
+            sink += find_first(module.code.data(), module.code.size(), COPY_DESCRIPTORS.anchored()).value_or(0);
+        });
+
+        std::printf("%7zu MiB  %14.1f  %12llu  %14.1f  %12llu\n",
+            size_mb,
+            resolve.ns_per_call,
+            (unsigned long long)resolve.page_faults,
+            scan.ns_per_call,
+            (unsigned long long)scan.page_faults);
+
+        ok &= sink != 0;
+
+        if (size_mb == 1) {
+            smallest_ns = resolve.ns_per_call;
+        }
+
+        largest_ns = resolve.ns_per_call;
+    }
+
+    // Generous on purpose, a scan grows with the module by orders of magnitude more than this
+    ok &= check("vtable resolution doesn't grow with the module", largest_ns < smallest_ns * 4.0 + 50.0);
+
+    return ok ? 0 : 1;
+}